@@ -2,10 +2,11 @@
 #define MODULES_ACP_MESSENGER_GEP_STREAM_MESSENGER_INCLUDE_GEPSTREAM_MESSENGER_H_
 
 #include <acp/core.h>
+#include <acp/utils/buffer_pool/BufferPool.h>
 
 namespace acp_messenger_gep_stream {
 
-	template <int MESSENGER_ID, int MAX_MESSAGE_SIZE> class TGEPStreamMessenger;
+	template <int MESSENGER_ID, int MAX_MESSAGE_SIZE, bool POOLED_BUFFER = false> class TGEPStreamMessenger;
 
 	// Byte indicating start of a new message
 	const uint8_t MESSAGE_START_BYTE = 0x0C;
@@ -20,8 +21,8 @@ namespace acp_messenger_gep_stream {
 	 * Controller for a stream messenger using a GEP protocol: error checking protocol
 	 * based on http://www.gammon.com.au/forum/?id=11428
 	 ********************************************************************************/
-	template<int MESSENGER_ID, int MAX_MESSAGE_SIZE> class GEPStreamController {
-		friend class TGEPStreamMessenger<MESSENGER_ID, MAX_MESSAGE_SIZE>;
+	template<int MESSENGER_ID, int MAX_MESSAGE_SIZE, bool POOLED_BUFFER = false> class GEPStreamController {
+		friend class TGEPStreamMessenger<MESSENGER_ID, MAX_MESSAGE_SIZE, POOLED_BUFFER>;
 	private:
 		// Communication stream for sending and receiving messages
 		Stream* stream;
@@ -29,8 +30,14 @@ namespace acp_messenger_gep_stream {
 		// Destination ID of the received message
 		uint8_t messageDestinationId;
 
-		// Buffer for receiving messages
-		uint8_t message[MAX_MESSAGE_SIZE+2];
+		// Own buffer for receiving messages (not used, if the buffer is leased from a pool)
+		uint8_t messageBuffer[POOLED_BUFFER ? 1 : MAX_MESSAGE_SIZE+2];
+
+		// Buffer for receiving messages (a pooled buffer is leased only while a message is received)
+		uint8_t* message;
+
+		// Pool of buffers
+		acp_utils_buffer_pool::BufferPool* bufferPool;
 
 		// Number of received message bytes
 		int messageLength;
@@ -133,6 +140,17 @@ namespace acp_messenger_gep_stream {
 			messageReceivedEvent = NULL;
 			state = WAIT_START;
 			messageLength = 0;
+			message = POOLED_BUFFER ? NULL : messageBuffer;
+			bufferPool = NULL;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns a pooled buffer to the pool
+		void releaseBuffer() {
+			if (POOLED_BUFFER && (message != NULL)) {
+				bufferPool->release(message);
+				message = NULL;
+			}
 		}
 
 		//--------------------------------------------------------------------------------
@@ -202,6 +220,18 @@ namespace acp_messenger_gep_stream {
 						}
 					}
 
+					// Lease a pooled buffer for the message (if not available, the message is ignored)
+					if (message == NULL) {
+						if (bufferPool != NULL) {
+							message = bufferPool->lease(MAX_MESSAGE_SIZE+2);
+						}
+
+						if (message == NULL) {
+							state = WAIT_START;
+							continue;
+						}
+					}
+
 					state = WAIT_MESSAGE_BYTE_HIGH;
 					messageLength = 0;
 					continue;
@@ -276,20 +306,25 @@ namespace acp_messenger_gep_stream {
 				}
 				state = WAIT_START;
 			}
+
+			// Pooled buffer is returned after the message is processed or discarded
+			if (state == WAIT_START) {
+				releaseBuffer();
+			}
 		}
 	};
 
 	/********************************************************************************
 	 * View for a stream messenger using a GEP protocol
 	 ********************************************************************************/
-	template<int MESSENGER_ID, int MAX_MESSAGE_SIZE> class TGEPStreamMessenger {
+	template<int MESSENGER_ID, int MAX_MESSAGE_SIZE, bool POOLED_BUFFER> class TGEPStreamMessenger {
 	private:
 		// The controller
-		GEPStreamController<MESSENGER_ID, MAX_MESSAGE_SIZE>& controller;
+		GEPStreamController<MESSENGER_ID, MAX_MESSAGE_SIZE, POOLED_BUFFER>& controller;
 	public:
 		//--------------------------------------------------------------------------------
 		// Constructs view associated with a controller
-		inline TGEPStreamMessenger(GEPStreamController<MESSENGER_ID, MAX_MESSAGE_SIZE>& controller): controller(controller) {
+		inline TGEPStreamMessenger(GEPStreamController<MESSENGER_ID, MAX_MESSAGE_SIZE, POOLED_BUFFER>& controller): controller(controller) {
 			// Nothing to do
 		}
 
@@ -305,6 +340,15 @@ namespace acp_messenger_gep_stream {
 			controller.stream = NULL;
 		}
 
+		//--------------------------------------------------------------------------------
+		// Sets pool for leasing the buffer of received messages (if the messenger uses
+		// a pooled buffer)
+		inline void setBufferPool(acp_utils_buffer_pool::BufferPool* pool) {
+			controller.releaseBuffer();
+			controller.state = GEPStreamController<MESSENGER_ID, MAX_MESSAGE_SIZE, POOLED_BUFFER>::WAIT_START;
+			controller.bufferPool = pool;
+		}
+
 		//--------------------------------------------------------------------------------
 		// Sends a message without a tag
 		inline void sendMessage(uint8_t destinationId, const char* message, int messageLength) {
@@ -0,0 +1,155 @@
+/********************************************************************************
+ * Benchmark of TRegistryAccessProtocol::handleRequest. For each request mix,
+ * it reports the number of handled requests per second.
+ ********************************************************************************/
+
+#include <acp/messenger/registry_access_protocol/RegistryProtocol.h>
+#include <HostCore.h>
+#include <stdio.h>
+
+using namespace acp_messenger_registry_msg_protocol;
+
+//--------------------------------------------------------------------------------
+// Registers emulated by the controller handlers
+
+static long intRegisters[256];
+static char binRegister[256];
+
+static bool writeInt(unsigned int registerId, long value) {
+	intRegisters[registerId % 256] = value;
+	return true;
+}
+
+static long readInt(unsigned int registerId, bool&) {
+	return intRegisters[registerId % 256];
+}
+
+static bool prepareWriteInt(unsigned int, long) {
+	return true;
+}
+
+static int readBinChunk(unsigned int, long offset, char* dstBuffer,
+		int dstBufferSize) {
+	if ((offset < 0) || (offset > (long) sizeof(binRegister))) {
+		return -1;
+	}
+
+	int length = sizeof(binRegister) - offset;
+	if (length > dstBufferSize) {
+		length = dstBufferSize;
+	}
+	memcpy(dstBuffer, binRegister + offset, length);
+	return length;
+}
+
+static int64_t readInt64(unsigned int registerId, bool&) {
+	return (int64_t) intRegisters[registerId % 256] << 24;
+}
+
+static float readFloat(unsigned int registerId, bool&) {
+	return intRegisters[registerId % 256] / 100.0f;
+}
+
+static RegistryAccessProtocolController controller;
+static TRegistryAccessProtocol<256, true> protocol(controller);
+
+/********************************************************************************
+ * Mix of requests sent in a round robin order.
+ ********************************************************************************/
+struct RequestMix {
+	const char* name;
+	char requests[16][24];
+	int requestSizes[16];
+	int count;
+
+	RequestMix(const char* name) :
+			name(name), count(0) {
+	}
+
+	void add(const char* request, int requestSize, int weight = 1) {
+		for (int i = 0; (i < weight) && (count < 16); i++) {
+			memcpy(requests[count], request, requestSize);
+			requestSizes[count] = requestSize;
+			count++;
+		}
+	}
+};
+
+// Number of requests in each measurement
+static const long REQUESTS = 5000000;
+
+//--------------------------------------------------------------------------------
+// Measures requests per second for a mix of requests.
+static void measure(const RequestMix& mix) {
+	char response[64];
+	long failed = 0;
+	const uint64_t start = hostNanos();
+	for (long i = 0; i < REQUESTS; i++) {
+		const int idx = i % mix.count;
+		int responseSize = sizeof(response);
+		protocol.handleRequest(mix.requests[idx], mix.requestSizes[idx],
+				response, responseSize);
+		if (response[0] == REQUEST_FAILED_RESPONSE) {
+			failed++;
+		}
+	}
+	const double seconds = (hostNanos() - start) / 1e9;
+
+	printf("%-28s %12.0f %8.1f %8ld\n", mix.name, REQUESTS / seconds,
+			seconds * 1e9 / REQUESTS, failed);
+}
+
+int main() {
+	controller.writeIntRegisterEvent = writeInt;
+	controller.readIntRegisterEvent = readInt;
+	controller.prepareWriteIntRegisterEvent = prepareWriteInt;
+	controller.readBinRegisterChunkEvent = readBinChunk;
+	controller.readInt64RegisterEvent = readInt64;
+	controller.readFloatRegisterEvent = readFloat;
+
+	for (int i = 0; i < 256; i++) {
+		intRegisters[i] = i * 1001L;
+		binRegister[i] = i;
+	}
+
+	const char readInt[] = { READ_INT_REGISTRY_REQUEST, 10 };
+	const char readIntLongId[] = { READ_INT_REGISTRY_REQUEST, (char) 0x80, (char) 200 };
+	const char writeInt[] = { WRITE_INT_REGISTRY_REQUEST, 11, (char) 0x83, 0x10 };
+	const char changeHint[] = { GET_CHANGE_HINT_REQUEST };
+	const char changeHintConfirm[] = { GET_CHANGE_HINT_REQUEST, 11 };
+	const char readInt64[] = { READ_INT64_REGISTRY_REQUEST, 12 };
+	const char readFloat[] = { READ_FLOAT_REGISTRY_REQUEST, 13 };
+	const char readChunk[] = { READ_BIN_REGISTRY_CHUNK_REQUEST, 1, 0x01, 32 };
+	const char batchWrite[] = { WRITE_INT_REGISTRY_BATCH_REQUEST, 1, 1, 2, 2,
+			3, 3, 4, 4, 5, (char) 0x81, 0x00, 6, (char) 0x81, 0x01, 7, 0x47,
+			8, 0x48 };
+
+	RequestMix reads("read int");
+	reads.add(readInt, sizeof(readInt), 3);
+	reads.add(readIntLongId, sizeof(readIntLongId), 1);
+
+	RequestMix polling("poll (hint + read + write)");
+	polling.add(changeHint, sizeof(changeHint), 4);
+	polling.add(changeHintConfirm, sizeof(changeHintConfirm), 2);
+	polling.add(readInt, sizeof(readInt), 4);
+	polling.add(writeInt, sizeof(writeInt), 2);
+
+	RequestMix typed("typed reads (int/int64/float)");
+	typed.add(readInt, sizeof(readInt), 2);
+	typed.add(readInt64, sizeof(readInt64), 1);
+	typed.add(readFloat, sizeof(readFloat), 1);
+
+	RequestMix chunks("binary chunk read (32 B)");
+	chunks.add(readChunk, sizeof(readChunk));
+
+	RequestMix batches("batch write (8 registers)");
+	batches.add(batchWrite, sizeof(batchWrite));
+
+	printf("%-28s %12s %8s %8s\n", "mix", "requests/s", "ns/req", "failed");
+	measure(reads);
+	measure(polling);
+	measure(typed);
+	measure(chunks);
+	measure(batches);
+	return 0;
+}
@@ -0,0 +1,130 @@
+/********************************************************************************
+ * Benchmark of value codecs of the registry access protocol. For each codec
+ * and value magnitude, it measures read requests (encoding of the value) and
+ * write requests (decoding of the value) handled by TRegistryAccessProtocol.
+ ********************************************************************************/
+
+#include <acp/messenger/registry_access_protocol/RegistryProtocol.h>
+#include <HostCore.h>
+#include <stdio.h>
+
+using namespace acp_messenger_registry_msg_protocol;
+
+//--------------------------------------------------------------------------------
+// Register emulated by the controller handlers
+
+static int64_t registerValue;
+static float floatValue;
+
+static bool writeInt(unsigned int, long value) {
+	registerValue = value;
+	return true;
+}
+
+static long readInt(unsigned int, bool&) {
+	return (long) registerValue;
+}
+
+static bool writeInt64(unsigned int, int64_t value) {
+	registerValue = value;
+	return true;
+}
+
+static int64_t readInt64(unsigned int, bool&) {
+	return registerValue;
+}
+
+static bool writeFloat(unsigned int, float value) {
+	floatValue = value;
+	return true;
+}
+
+static float readFloat(unsigned int, bool&) {
+	return floatValue;
+}
+
+static bool writeFixed(unsigned int, long mantissa, uint8_t) {
+	registerValue = mantissa;
+	return true;
+}
+
+static long readFixed(unsigned int, uint8_t& outDecimals, bool&) {
+	outDecimals = 2;
+	return (long) registerValue;
+}
+
+static RegistryAccessProtocolController controller;
+static TRegistryAccessProtocol<8, false> protocol(controller);
+
+// Number of requests in each measurement
+static const long REQUESTS = 2000000;
+
+//--------------------------------------------------------------------------------
+// Measures a read request and a write request of the value returned by the read.
+static void measure(const char* name, uint8_t readCode, uint8_t writeCode,
+		int64_t value, float fValue) {
+	registerValue = value;
+	floatValue = fValue;
+
+	// Read request
+	const char readRequest[2] = { (char) readCode, 1 };
+	char response[32];
+	int responseSize = 0;
+	uint64_t start = hostNanos();
+	for (long i = 0; i < REQUESTS; i++) {
+		responseSize = sizeof(response);
+		protocol.handleRequest(readRequest, 2, response, responseSize);
+	}
+	const double readNanos = (double) (hostNanos() - start) / REQUESTS;
+
+	// Write request with the encoded value
+	char writeRequest[32];
+	writeRequest[0] = writeCode;
+	writeRequest[1] = 1;
+	memcpy(writeRequest + 2, response + 1, responseSize - 1);
+	const int writeRequestSize = 2 + responseSize - 1;
+	char writeResponse[4];
+	start = hostNanos();
+	for (long i = 0; i < REQUESTS; i++) {
+		int writeResponseSize = sizeof(writeResponse);
+		protocol.handleRequest(writeRequest, writeRequestSize, writeResponse,
+				writeResponseSize);
+	}
+	const double writeNanos = (double) (hostNanos() - start) / REQUESTS;
+
+	printf("%-22s %6d %10.1f %10.1f\n", name, responseSize - 1, readNanos,
+			writeNanos);
+}
+
+int main() {
+	controller.writeIntRegisterEvent = writeInt;
+	controller.readIntRegisterEvent = readInt;
+	controller.writeInt64RegisterEvent = writeInt64;
+	controller.readInt64RegisterEvent = readInt64;
+	controller.writeFloatRegisterEvent = writeFloat;
+	controller.readFloatRegisterEvent = readFloat;
+	controller.writeFixedRegisterEvent = writeFixed;
+	controller.readFixedRegisterEvent = readFixed;
+
+	printf("%-22s %6s %10s %10s\n", "codec/value", "bytes", "read ns",
+			"write ns");
+	measure("long 42", READ_INT_REGISTRY_REQUEST, WRITE_INT_REGISTRY_REQUEST,
+			42, 0);
+	measure("long -1000000", READ_INT_REGISTRY_REQUEST,
+			WRITE_INT_REGISTRY_REQUEST, -1000000, 0);
+	measure("long 2^31-1", READ_INT_REGISTRY_REQUEST,
+			WRITE_INT_REGISTRY_REQUEST, 2147483647L, 0);
+	measure("int64 42", READ_INT64_REGISTRY_REQUEST,
+			WRITE_INT64_REGISTRY_REQUEST, 42, 0);
+	measure("int64 -1000000", READ_INT64_REGISTRY_REQUEST,
+			WRITE_INT64_REGISTRY_REQUEST, -1000000, 0);
+	measure("int64 2^40", READ_INT64_REGISTRY_REQUEST,
+			WRITE_INT64_REGISTRY_REQUEST, 1LL << 40, 0);
+	measure("int64 min", READ_INT64_REGISTRY_REQUEST,
+			WRITE_INT64_REGISTRY_REQUEST, INT64_MIN, 0);
+	measure("float 21.5", READ_FLOAT_REGISTRY_REQUEST,
+			WRITE_FLOAT_REGISTRY_REQUEST, 0, 21.5f);
+	measure("fixed 2150/10^2", READ_FIXED_REGISTRY_REQUEST,
+			WRITE_FIXED_REGISTRY_REQUEST, 2150, 0);
+	return 0;
+}
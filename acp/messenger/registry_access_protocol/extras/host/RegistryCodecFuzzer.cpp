@@ -0,0 +1,217 @@
+/********************************************************************************
+ * Fuzz target for value codecs of the registry access protocol (encoded long,
+ * zigzag varint, float and fixed-point).
+ *
+ * The first input byte selects a codec. The rest of input is used twice:
+ * - as a value that is read from a register and then written back using
+ *   the received response; the written value must be equal to the read value,
+ * - as an encoded value of a write request; if it is accepted, the decoded
+ *   value is read back and written again and it must not change.
+ ********************************************************************************/
+
+#include <acp/messenger/registry_access_protocol/RegistryProtocol.h>
+#include <stdio.h>
+
+using namespace acp_messenger_registry_msg_protocol;
+
+//--------------------------------------------------------------------------------
+// Register emulated by the controller handlers
+
+static long intValue;
+static int64_t int64Value;
+static float floatValue;
+static long fixedMantissa;
+static uint8_t fixedDecimals;
+
+static bool writeInt(unsigned int, long value) {
+	intValue = value;
+	return true;
+}
+
+static long readInt(unsigned int, bool&) {
+	return intValue;
+}
+
+static bool writeInt64(unsigned int, int64_t value) {
+	int64Value = value;
+	return true;
+}
+
+static int64_t readInt64(unsigned int, bool&) {
+	return int64Value;
+}
+
+static bool writeFloat(unsigned int, float value) {
+	floatValue = value;
+	return true;
+}
+
+static float readFloat(unsigned int, bool&) {
+	return floatValue;
+}
+
+static bool writeFixed(unsigned int, long mantissa, uint8_t decimals) {
+	fixedMantissa = mantissa;
+	fixedDecimals = decimals;
+	return true;
+}
+
+static long readFixed(unsigned int, uint8_t& outDecimals, bool&) {
+	outDecimals = fixedDecimals;
+	return fixedMantissa;
+}
+
+static RegistryAccessProtocolController controller;
+static TRegistryAccessProtocol<8, false> protocol(controller);
+
+//--------------------------------------------------------------------------------
+// Request codes of supported codecs: read and write request
+static const uint8_t codecRequests[4][2] = {
+		{ READ_INT_REGISTRY_REQUEST, WRITE_INT_REGISTRY_REQUEST },
+		{ READ_INT64_REGISTRY_REQUEST, WRITE_INT64_REGISTRY_REQUEST },
+		{ READ_FLOAT_REGISTRY_REQUEST, WRITE_FLOAT_REGISTRY_REQUEST },
+		{ READ_FIXED_REGISTRY_REQUEST, WRITE_FIXED_REGISTRY_REQUEST } };
+
+//--------------------------------------------------------------------------------
+// Sends a request with given code and payload to the register 1.
+static int sendRequest(uint8_t requestCode, const uint8_t* payload,
+		int payloadSize, char* response, int responseBufferSize) {
+	char request[64];
+	request[0] = requestCode;
+	request[1] = 1;
+	if (payloadSize > 0) {
+		memcpy(request + 2, payload, payloadSize);
+	}
+
+	int responseSize = responseBufferSize;
+	protocol.handleRequest(request, 2 + payloadSize, response, responseSize);
+	if ((responseSize < 1) || (responseSize > responseBufferSize)) {
+		fprintf(stderr, "Invalid response size %d (buffer %d)\n", responseSize,
+				responseBufferSize);
+		abort();
+	}
+
+	return responseSize;
+}
+
+//--------------------------------------------------------------------------------
+// Reads the register and writes the received value back.
+static bool readAndWriteBack(int codec) {
+	char response[32];
+	const int responseSize = sendRequest(codecRequests[codec][0], NULL, 0,
+			response, sizeof(response));
+	if (response[0] != REQUEST_OK_RESPONSE) {
+		return false;
+	}
+
+	char writeResponse[4];
+	sendRequest(codecRequests[codec][1], (const uint8_t*) response + 1,
+			responseSize - 1, writeResponse, sizeof(writeResponse));
+	return writeResponse[0] == REQUEST_OK_RESPONSE;
+}
+
+//--------------------------------------------------------------------------------
+// Stores value given by bytes to the register of the codec.
+static void setRegister(int codec, const uint8_t* data, size_t size) {
+	uint8_t raw[9];
+	memset(raw, 0, sizeof(raw));
+	memcpy(raw, data, (size < sizeof(raw)) ? size : sizeof(raw));
+
+	int32_t int32;
+	memcpy(&int32, raw, sizeof(int32));
+	switch (codec) {
+	case 0:
+		// The encoded long is defined for 32-bit long of Arduino boards
+		intValue = int32;
+		break;
+	case 1:
+		memcpy(&int64Value, raw, sizeof(int64Value));
+		break;
+	case 2:
+		memcpy(&floatValue, raw, sizeof(floatValue));
+		break;
+	default:
+		fixedMantissa = int32;
+		fixedDecimals = raw[8];
+	}
+}
+
+//--------------------------------------------------------------------------------
+// Checks that the register of the codec has an expected value.
+static void checkRegister(int codec, long expectedInt, int64_t expectedInt64,
+		float expectedFloat, long expectedMantissa, uint8_t expectedDecimals) {
+	bool equal;
+	switch (codec) {
+	case 0:
+		equal = (intValue == expectedInt);
+		break;
+	case 1:
+		equal = (int64Value == expectedInt64);
+		break;
+	case 2:
+		equal = (memcmp(&floatValue, &expectedFloat, sizeof(float)) == 0);
+		break;
+	default:
+		equal = (fixedMantissa == expectedMantissa)
+				&& (fixedDecimals == expectedDecimals);
+	}
+
+	if (!equal) {
+		fprintf(stderr, "Round trip of codec %d changed the value\n", codec);
+		abort();
+	}
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+	if ((size < 1) || (size > 40)) {
+		return 0;
+	}
+
+	controller.writeIntRegisterEvent = writeInt;
+	controller.readIntRegisterEvent = readInt;
+	controller.writeInt64RegisterEvent = writeInt64;
+	controller.readInt64RegisterEvent = readInt64;
+	controller.writeFloatRegisterEvent = writeFloat;
+	controller.readFloatRegisterEvent = readFloat;
+	controller.writeFixedRegisterEvent = writeFixed;
+	controller.readFixedRegisterEvent = readFixed;
+
+	const int codec = data[0] % 4;
+	data++;
+	size--;
+
+	// Value -> encoded value -> value
+	setRegister(codec, data, size);
+	long savedInt = intValue;
+	int64_t savedInt64 = int64Value;
+	float savedFloat = floatValue;
+	long savedMantissa = fixedMantissa;
+	uint8_t savedDecimals = fixedDecimals;
+	if (!readAndWriteBack(codec)) {
+		fprintf(stderr, "Codec %d failed to transfer a valid value\n", codec);
+		abort();
+	}
+	checkRegister(codec, savedInt, savedInt64, savedFloat, savedMantissa,
+			savedDecimals);
+
+	// Encoded value -> value -> encoded value -> value
+	char response[4];
+	sendRequest(codecRequests[codec][1], data, size, response, sizeof(response));
+	if (response[0] != REQUEST_OK_RESPONSE) {
+		return 0;
+	}
+
+	savedInt = intValue;
+	savedInt64 = int64Value;
+	savedFloat = floatValue;
+	savedMantissa = fixedMantissa;
+	savedDecimals = fixedDecimals;
+	if (!readAndWriteBack(codec)) {
+		fprintf(stderr, "Codec %d failed to transfer a decoded value\n", codec);
+		abort();
+	}
+	checkRegister(codec, savedInt, savedInt64, savedFloat, savedMantissa,
+			savedDecimals);
+
+	return 0;
+}
@@ -0,0 +1,189 @@
+/********************************************************************************
+ * Fuzz target for TRegistryAccessProtocol::handleRequest.
+ *
+ * The first input byte gives size of the response buffer (0-31 bytes), the rest
+ * of input is the request. Both buffers are allocated with the exact size, so
+ * that the address sanitizer detects any access beyond them. The target checks:
+ * - the response size is in range 1 ... buffer size (0 only for empty buffer),
+ * - a 64-bit integer write is accepted exactly if its zigzag varint encodes
+ *   a value that fits in 64 bits (compared with a reference decoder),
+ * - a chunk of a binary register write never exceeds the total length.
+ ********************************************************************************/
+
+#include <acp/messenger/registry_access_protocol/RegistryProtocol.h>
+#include <stdio.h>
+
+using namespace acp_messenger_registry_msg_protocol;
+
+//--------------------------------------------------------------------------------
+// Controller handlers (with deterministic, input dependent results)
+
+static bool writeInt(unsigned int registerId, long) {
+	return registerId % 7 != 3;
+}
+
+static long readInt(unsigned int registerId, bool& outValid) {
+	outValid = (registerId != 13);
+	return (registerId % 2) ? LONG_MIN : (long) registerId * 100003L;
+}
+
+static bool prepareWriteInt(unsigned int registerId, long) {
+	return registerId % 5 != 0;
+}
+
+static bool writeBin(unsigned int, const char* data, int dataLength) {
+	volatile char sum = 0;
+	for (int i = 0; i < dataLength; i++) {
+		sum ^= data[i];
+	}
+	return dataLength % 2 == 0;
+}
+
+static int readBin(unsigned int registerId, char* dstBuffer,
+		int dstBufferSize) {
+	const int length = (registerId < (unsigned int) dstBufferSize) ?
+			registerId : dstBufferSize;
+	memset(dstBuffer, 'b', length);
+	return length;
+}
+
+static bool writeBinChunk(unsigned int, long offset, const char* data,
+		int dataLength, long totalLength) {
+	// A chunk is never passed beyond the total length of the written content
+	if ((offset < 0) || (dataLength < 0) || (dataLength > totalLength - offset)) {
+		fprintf(stderr, "Chunk %ld+%d exceeds total length %ld\n", offset,
+				dataLength, totalLength);
+		abort();
+	}
+
+	volatile char sum = 0;
+	for (int i = 0; i < dataLength; i++) {
+		sum ^= data[i];
+	}
+	return true;
+}
+
+static int readBinChunk(unsigned int, long offset, char* dstBuffer,
+		int dstBufferSize) {
+	if (offset < 0) {
+		return -1;
+	}
+
+	memset(dstBuffer, 'c', dstBufferSize);
+	return (offset % 3 == 0) ? dstBufferSize : 0;
+}
+
+static long getBinSize(unsigned int registerId) {
+	return (registerId == 9) ? -1 : (long) registerId * 1000L;
+}
+
+static int64_t lastInt64;
+static bool lastInt64Written;
+
+static bool writeInt64(unsigned int, int64_t value) {
+	lastInt64 = value;
+	lastInt64Written = true;
+	return true;
+}
+
+static int64_t readInt64(unsigned int, bool&) {
+	return INT64_MIN;
+}
+
+static bool writeFloat(unsigned int, float value) {
+	return value == value;
+}
+
+static float readFloat(unsigned int registerId, bool&) {
+	return registerId * 0.5f;
+}
+
+static bool writeFixed(unsigned int, long, uint8_t decimals) {
+	return decimals < 10;
+}
+
+static long readFixed(unsigned int registerId, uint8_t& outDecimals, bool&) {
+	outDecimals = registerId % 4;
+	return -(long) registerId;
+}
+
+static RegistryAccessProtocolController controller;
+static TRegistryAccessProtocol<77, true> protocol(controller);
+
+//--------------------------------------------------------------------------------
+// Reference decoder of zigzag varints. Returns whether the varint at the start
+// of data encodes a value of at most 64 bits and stores it to output.
+static bool referenceZigZagVarint(const uint8_t* data, size_t size,
+		int64_t& output) {
+	unsigned __int128 rawValue = 0;
+	for (size_t i = 0; (i < size) && (i < 10); i++) {
+		rawValue |= ((unsigned __int128) (data[i] & 0x7F)) << (7 * i);
+		if ((data[i] & 0x80) == 0) {
+			if (rawValue >> 64) {
+				return false;
+			}
+
+			const uint64_t value = (uint64_t) rawValue;
+			output = (int64_t) (value >> 1) ^ -((int64_t) (value & 1));
+			return true;
+		}
+	}
+
+	return false;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+	if (size < 1) {
+		return 0;
+	}
+
+	controller.writeIntRegisterEvent = writeInt;
+	controller.readIntRegisterEvent = readInt;
+	controller.prepareWriteIntRegisterEvent = prepareWriteInt;
+	controller.writeBinRegisterEvent = writeBin;
+	controller.readBinRegisterEvent = readBin;
+	controller.writeBinRegisterChunkEvent = writeBinChunk;
+	controller.readBinRegisterChunkEvent = readBinChunk;
+	controller.getBinRegisterSizeEvent = getBinSize;
+	controller.writeInt64RegisterEvent = writeInt64;
+	controller.readInt64RegisterEvent = readInt64;
+	controller.writeFloatRegisterEvent = writeFloat;
+	controller.readFloatRegisterEvent = readFloat;
+	controller.writeFixedRegisterEvent = writeFixed;
+	controller.readFixedRegisterEvent = readFixed;
+
+	const int responseBufferSize = data[0] % 32;
+	const int requestSize = size - 1;
+	char* request = new char[requestSize];
+	memcpy(request, data + 1, requestSize);
+	char* response = new char[responseBufferSize];
+
+	int responseSize = responseBufferSize;
+	lastInt64Written = false;
+	protocol.handleRequest(request, requestSize, response, responseSize);
+
+	if ((responseSize < ((responseBufferSize > 0) ? 1 : 0))
+			|| (responseSize > responseBufferSize)) {
+		fprintf(stderr, "Invalid response size %d (buffer %d)\n", responseSize,
+				responseBufferSize);
+		abort();
+	}
+
+	// Compare decoding of 64-bit integer writes with the reference decoder
+	if ((responseBufferSize > 0) && (requestSize >= 2)
+			&& ((uint8_t) request[0] == WRITE_INT64_REGISTRY_REQUEST)) {
+		const int idSize = ((uint8_t) request[1] < 128) ? 1 : 2;
+		int64_t expected = 0;
+		const bool valid = (requestSize > 1 + idSize)
+				&& referenceZigZagVarint(data + 1 + 1 + idSize,
+						requestSize - 1 - idSize, expected);
+		if ((valid != lastInt64Written) || (valid && (expected != lastInt64))) {
+			fprintf(stderr, "Zigzag varint decoded differently than the reference\n");
+			abort();
+		}
+	}
+
+	delete[] request;
+	delete[] response;
+	return 0;
+}
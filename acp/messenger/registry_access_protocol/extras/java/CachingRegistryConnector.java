@@ -0,0 +1,344 @@
+package net.acprog.modules.messenger;
+
+import java.math.BigDecimal;
+import java.util.HashMap;
+import java.util.Map;
+
+/**
+ * Connector to a remote registry that caches values of integer registers.
+ * Cached values are invalidated by a background refresher that retrieves
+ * change hints from the registry. Only changes of watched registers are
+ * reported by change hints, hence each cached value is used at most for
+ * the configured staleness bound. Registers of other types are not cached.
+ */
+public class CachingRegistryConnector implements RegistryConnector {
+
+	/**
+	 * Cached value of a register.
+	 */
+	private static final class CacheEntry {
+		/**
+		 * Value of the register.
+		 */
+		final int value;
+
+		/**
+		 * Time when the value was retrieved from the registry.
+		 */
+		final long timestamp;
+
+		/**
+		 * Constructs a cache entry.
+		 * 
+		 * @param value
+		 *            the value of register.
+		 * @param timestamp
+		 *            the time when the value was retrieved.
+		 */
+		CacheEntry(int value, long timestamp) {
+			this.value = value;
+			this.timestamp = timestamp;
+		}
+	}
+
+	/**
+	 * Maximal number of change hints processed in a single refresh pass
+	 * (registry watches at most 256 registers).
+	 */
+	private final static int MAX_HINTS_PER_REFRESH = 256;
+
+	/**
+	 * Connector to the remote registry.
+	 */
+	private final GEPRegistryConnector connector;
+
+	/**
+	 * Cached values of integer registers.
+	 */
+	private final Map<Integer, CacheEntry> cache = new HashMap<Integer, CacheEntry>();
+
+	/**
+	 * Maximal age of a cached value in milliseconds.
+	 */
+	private final long maxStaleness;
+
+	/**
+	 * Interval in milliseconds between two refresh passes.
+	 */
+	private final long refreshInterval;
+
+	/**
+	 * Number of reads answered from the cache.
+	 */
+	private long hitCount;
+
+	/**
+	 * Number of reads forwarded to the registry.
+	 */
+	private long missCount;
+
+	/**
+	 * Number of cached values invalidated due to change hints.
+	 */
+	private long invalidationCount;
+
+	/**
+	 * Thread that refreshes the cache.
+	 */
+	private Thread refreshThread;
+
+	/**
+	 * Constructs a caching connector.
+	 * 
+	 * @param connector
+	 *            the connector to the remote registry.
+	 * @param refreshInterval
+	 *            the interval in milliseconds between two retrievals of
+	 *            change hints.
+	 * @param maxStaleness
+	 *            the maximal age of a cached value in milliseconds.
+	 */
+	public CachingRegistryConnector(GEPRegistryConnector connector, long refreshInterval, long maxStaleness) {
+		this.connector = connector;
+		this.refreshInterval = Math.max(1, refreshInterval);
+		this.maxStaleness = maxStaleness;
+	}
+
+	/**
+	 * Starts the background refresher of the cache.
+	 */
+	public synchronized void start() {
+		if (refreshThread != null) {
+			return;
+		}
+
+		refreshThread = new Thread(new Runnable() {
+			@Override
+			public void run() {
+				refreshLoop();
+			}
+		});
+
+		refreshThread.setDaemon(true);
+		refreshThread.setName("CachingRegistryConnector - Refresh thread");
+		refreshThread.start();
+	}
+
+	/**
+	 * Stops the background refresher of the cache and clears the cache.
+	 */
+	public void stop() {
+		Thread stoppingThread;
+		synchronized (this) {
+			stoppingThread = refreshThread;
+			refreshThread = null;
+		}
+
+		if (stoppingThread != null) {
+			stoppingThread.interrupt();
+			try {
+				stoppingThread.join();
+			} catch (InterruptedException e) {
+				Thread.currentThread().interrupt();
+			}
+		}
+
+		invalidateAll();
+	}
+
+	@Override
+	public int readRegister(int registerId) throws RuntimeException {
+		synchronized (cache) {
+			CacheEntry entry = cache.get(registerId);
+			if ((entry != null) && (System.currentTimeMillis() - entry.timestamp <= maxStaleness)) {
+				hitCount++;
+				return entry.value;
+			}
+
+			missCount++;
+		}
+
+		long timestamp = System.currentTimeMillis();
+		int value = connector.readRegister(registerId);
+		synchronized (cache) {
+			cache.put(registerId, new CacheEntry(value, timestamp));
+		}
+
+		return value;
+	}
+
+	@Override
+	public void writeRegister(int registerId, int value) throws RuntimeException {
+		invalidate(registerId);
+		connector.writeRegister(registerId, value);
+	}
+
+	@Override
+	public void writeRegisters(int[] registerIds, int[] values) throws RuntimeException {
+		for (int registerId : registerIds) {
+			invalidate(registerId);
+		}
+
+		connector.writeRegisters(registerIds, values);
+	}
+
+	@Override
+	public byte[] readBinaryRegister(int registerId) throws RuntimeException {
+		return connector.readBinaryRegister(registerId);
+	}
+
+	@Override
+	public void writeBinaryRegister(int registerId, byte[] data) throws RuntimeException {
+		connector.writeBinaryRegister(registerId, data);
+	}
+
+	@Override
+	public long readLongRegister(int registerId) throws RuntimeException {
+		return connector.readLongRegister(registerId);
+	}
+
+	@Override
+	public void writeLongRegister(int registerId, long value) throws RuntimeException {
+		connector.writeLongRegister(registerId, value);
+	}
+
+	@Override
+	public float readFloatRegister(int registerId) throws RuntimeException {
+		return connector.readFloatRegister(registerId);
+	}
+
+	@Override
+	public void writeFloatRegister(int registerId, float value) throws RuntimeException {
+		connector.writeFloatRegister(registerId, value);
+	}
+
+	@Override
+	public BigDecimal readFixedRegister(int registerId) throws RuntimeException {
+		return connector.readFixedRegister(registerId);
+	}
+
+	@Override
+	public void writeFixedRegister(int registerId, BigDecimal value) throws RuntimeException {
+		connector.writeFixedRegister(registerId, value);
+	}
+
+	/**
+	 * Removes cached value of a register.
+	 * 
+	 * @param registerId
+	 *            the identifier of the register.
+	 */
+	public void invalidate(int registerId) {
+		synchronized (cache) {
+			cache.remove(registerId);
+		}
+	}
+
+	/**
+	 * Removes all cached values.
+	 */
+	public void invalidateAll() {
+		synchronized (cache) {
+			cache.clear();
+		}
+	}
+
+	/**
+	 * Returns the number of reads answered from the cache.
+	 * 
+	 * @return the number of cache hits.
+	 */
+	public long getHitCount() {
+		synchronized (cache) {
+			return hitCount;
+		}
+	}
+
+	/**
+	 * Returns the number of reads forwarded to the registry.
+	 * 
+	 * @return the number of cache misses.
+	 */
+	public long getMissCount() {
+		synchronized (cache) {
+			return missCount;
+		}
+	}
+
+	/**
+	 * Returns the number of cached values invalidated due to change hints.
+	 * 
+	 * @return the number of invalidations.
+	 */
+	public long getInvalidationCount() {
+		synchronized (cache) {
+			return invalidationCount;
+		}
+	}
+
+	/**
+	 * Resets the cache statistics.
+	 */
+	public void resetStatistics() {
+		synchronized (cache) {
+			hitCount = 0;
+			missCount = 0;
+			invalidationCount = 0;
+		}
+	}
+
+	/**
+	 * Invalidates cached value of a register reported by a change hint.
+	 * 
+	 * @param registerId
+	 *            the identifier of the changed register.
+	 */
+	private void invalidateChanged(int registerId) {
+		synchronized (cache) {
+			if (cache.remove(registerId) != null) {
+				invalidationCount++;
+			}
+		}
+	}
+
+	/**
+	 * Returns whether the current thread is the active refresh thread.
+	 * 
+	 * @return true, if the current thread should continue refreshing.
+	 */
+	private synchronized boolean isRefreshThread() {
+		return refreshThread == Thread.currentThread();
+	}
+
+	/**
+	 * Loop of the refresh thread: retrieves all change hints and invalidates
+	 * related cache entries.
+	 */
+	private void refreshLoop() {
+		while (isRefreshThread()) {
+			try {
+				// Retrieve all changed registers (each hint is confirmed by the
+				// next request)
+				int hint = connector.getChangeHint(-1);
+				int hintCount = 0;
+				while ((hint >= 0) && (hintCount < MAX_HINTS_PER_REFRESH)) {
+					hintCount++;
+					invalidateChanged(hint);
+					int nextHint = connector.getChangeHint(hint);
+					// Value could be cached between hint and its confirmation
+					invalidateChanged(hint);
+					hint = nextHint;
+				}
+			} catch (RuntimeException e) {
+				// Changes are unknown, hence no cached value can be trusted
+				invalidateAll();
+			}
+
+			try {
+				Thread.sleep(refreshInterval);
+			} catch (InterruptedException e) {
+				break;
+			}
+		}
+	}
+}
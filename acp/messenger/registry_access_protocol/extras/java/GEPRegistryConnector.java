@@ -1,5 +1,8 @@
 package net.acprog.modules.messenger;
 
+import java.io.ByteArrayOutputStream;
+import java.math.BigDecimal;
+
 import net.acprog.modules.messenger.GEPMessenger.MessageListener;
 import net.acprog.modules.messenger.GEPMessenger.SendRequest;
 
@@ -18,6 +21,62 @@ public class GEPRegistryConnector implements RegistryConnector {
 	 */
 	private final static int WRITE_REGISTRY_REQUEST = 0x02;
 
+	/**
+	 * Code of request for getting change hint.
+	 */
+	private final static int GET_CHANGE_HINT_REQUEST = 0x05;
+
+	/**
+	 * Code of request for reading a chunk of a binary register.
+	 */
+	private final static int READ_BIN_REGISTRY_CHUNK_REQUEST = 0x06;
+
+	/**
+	 * Code of request for writing a chunk of a binary register.
+	 */
+	private final static int WRITE_BIN_REGISTRY_CHUNK_REQUEST = 0x07;
+
+	/**
+	 * Code of request for getting size of a binary register.
+	 */
+	private final static int GET_BIN_REGISTRY_SIZE_REQUEST = 0x08;
+
+	/**
+	 * Code of request for reading value of a 64-bit integer register.
+	 */
+	private final static int READ_INT64_REGISTRY_REQUEST = 0x09;
+
+	/**
+	 * Code of request for writing value of a 64-bit integer register.
+	 */
+	private final static int WRITE_INT64_REGISTRY_REQUEST = 0x0A;
+
+	/**
+	 * Code of request for reading value of a float register.
+	 */
+	private final static int READ_FLOAT_REGISTRY_REQUEST = 0x0B;
+
+	/**
+	 * Code of request for writing value of a float register.
+	 */
+	private final static int WRITE_FLOAT_REGISTRY_REQUEST = 0x0C;
+
+	/**
+	 * Code of request for reading value of a fixed-point register.
+	 */
+	private final static int READ_FIXED_REGISTRY_REQUEST = 0x0D;
+
+	/**
+	 * Code of request for writing value of a fixed-point register.
+	 */
+	private final static int WRITE_FIXED_REGISTRY_REQUEST = 0x0E;
+
+	/**
+	 * Code of request for writing values of several integer registers in a
+	 * single transaction.
+	 */
+	private final static int WRITE_INT_REGISTRY_BATCH_REQUEST = 0x0F;
+
 	/**
 	 * Code of response indicating an unknown request or failed request.
 	 */
@@ -47,6 +106,17 @@ public class GEPRegistryConnector implements RegistryConnector {
 	 */
 	private long operationTimeout = 2000;
 
+	/**
+	 * Maximal length of a received message (response).
+	 */
+	private final static int MAX_MESSAGE_LENGTH = 30;
+
+	/**
+	 * Maximal number of bytes transferred in a single chunk of a binary
+	 * register.
+	 */
+	private int binaryChunkSize = MAX_MESSAGE_LENGTH - 1;
+
 	/**
 	 * Counter to generate "unique" request tags.
 	 */
@@ -76,7 +146,7 @@ public class GEPRegistryConnector implements RegistryConnector {
 	 *            the baud rate.
 	 */
 	public GEPRegistryConnector(String portName, int baudRate) {
-		messenger = new GEPMessenger(portName, baudRate, 30, new MessageListener() {
+		messenger = new GEPMessenger(portName, baudRate, MAX_MESSAGE_LENGTH, new MessageListener() {
 
 			@Override
 			public void onMessageReceived(int tag, byte[] message) {
@@ -93,6 +163,33 @@ public class GEPRegistryConnector implements RegistryConnector {
 		messenger.stop(true);
 	}
 
+	/**
+	 * Returns the maximal number of bytes transferred in a single chunk of a
+	 * binary register.
+	 * 
+	 * @return the size of chunk in bytes.
+	 */
+	public synchronized int getBinaryChunkSize() {
+		return binaryChunkSize;
+	}
+
+	/**
+	 * Sets the maximal number of bytes transferred in a single chunk of a
+	 * binary register. The chunk must fit the message buffer of the remote
+	 * messenger and the response (chunk with status byte) must fit the
+	 * message buffer of the local messenger.
+	 * 
+	 * @param binaryChunkSize
+	 *            the size of chunk in bytes.
+	 */
+	public synchronized void setBinaryChunkSize(int binaryChunkSize) {
+		if ((binaryChunkSize < 1) || (binaryChunkSize > MAX_MESSAGE_LENGTH - 1)) {
+			throw new IllegalArgumentException("Size of chunk is out of range.");
+		}
+
+		this.binaryChunkSize = binaryChunkSize;
+	}
+
 	@Override
 	public synchronized int readRegister(int registerId) throws RuntimeException {
 		if ((registerId < 0) || (registerId >= 128 * 256)) {
@@ -166,6 +263,332 @@ public class GEPRegistryConnector implements RegistryConnector {
 		}
 	}
 
+	@Override
+	public synchronized void writeRegisters(int[] registerIds, int[] values) throws RuntimeException {
+		if (registerIds.length != values.length) {
+			throw new IllegalArgumentException("Number of register identifiers and values differ.");
+		}
+
+		if (registerIds.length == 0) {
+			return;
+		}
+
+		// Prepare message with request: pairs (register id, value)
+		ByteArrayOutputStream requestStream = new ByteArrayOutputStream();
+		requestStream.write(WRITE_INT_REGISTRY_BATCH_REQUEST);
+		for (int i = 0; i < registerIds.length; i++) {
+			byte[] encodedPair = createRequest(0, registerIds[i], encodeNumber(values[i]));
+			requestStream.write(encodedPair, 1, encodedPair.length - 1);
+		}
+
+		// Send request and process response
+		byte[] response;
+		try {
+			response = sendRequest(requestStream.toByteArray());
+		} catch (Exception e) {
+			throw new RuntimeException("Write operation failed.", e);
+		}
+
+		if (response == null) {
+			throw new RuntimeException("Write operation failed: no response from registry.");
+		}
+
+		if (response.length != 1 + registerIds.length) {
+			throw new RuntimeException("Write operation failed: request failed on registry.");
+		}
+
+		StringBuilder rejectedIds = new StringBuilder();
+		for (int i = 0; i < registerIds.length; i++) {
+			if (response[1 + i] != REQUEST_OK_RESPONSE) {
+				if (rejectedIds.length() > 0) {
+					rejectedIds.append(", ");
+				}
+				rejectedIds.append(registerIds[i]);
+			}
+		}
+
+		if (response[0] == UNWRITABLE_REGISTER_RESPONSE) {
+			throw new RuntimeException("Write operation rejected, no register written (rejected registers: "
+					+ rejectedIds + ").");
+		}
+
+		if ((response[0] != REQUEST_OK_RESPONSE) || (rejectedIds.length() > 0)) {
+			throw new RuntimeException("Write operation partially failed, registers not written: " + rejectedIds
+					+ ".");
+		}
+	}
+
+	/**
+	 * Returns change hint - identifier of a watched register whose value has
+	 * been changed but not read. Reading of a register (or confirming the
+	 * register in a next change hint request) clears the change flag of the
+	 * register.
+	 * 
+	 * @param confirmedRegisterId
+	 *            the identifier of register that should be marked as read or a
+	 *            negative number, if no register should be marked as read.
+	 * @return the identifier of a changed register or -1, if there is no
+	 *         changed register.
+	 * @throws RuntimeException
+	 *             if the operation failed.
+	 */
+	public synchronized int getChangeHint(int confirmedRegisterId) throws RuntimeException {
+		byte[] request;
+		if (confirmedRegisterId < 0) {
+			request = new byte[] { (byte) GET_CHANGE_HINT_REQUEST };
+		} else {
+			request = createRequest(GET_CHANGE_HINT_REQUEST, confirmedRegisterId, new byte[0]);
+		}
+
+		byte[] response = sendCheckedRequest(request, "Change hint operation failed.");
+		return decodeNumber(response, 1);
+	}
+
+	/**
+	 * Returns size of a binary register in bytes.
+	 * 
+	 * @param registerId
+	 *            the identifier of the register.
+	 * @return the size of register.
+	 * @throws RuntimeException
+	 *             if the operation failed.
+	 */
+	public synchronized int getBinaryRegisterSize(int registerId) throws RuntimeException {
+		byte[] request = createRequest(GET_BIN_REGISTRY_SIZE_REQUEST, registerId, new byte[0]);
+
+		byte[] response = sendCheckedRequest(request, "Size operation failed.");
+		return decodeNumber(response, 1);
+	}
+
+	/**
+	 * Reads a chunk of a binary register.
+	 * 
+	 * @param registerId
+	 *            the identifier of the register.
+	 * @param offset
+	 *            the offset of the first byte of the chunk.
+	 * @param length
+	 *            the maximal length of the chunk.
+	 * @return the received bytes (empty array, if offset is at the end of the
+	 *         register).
+	 * @throws RuntimeException
+	 *             if the operation failed.
+	 */
+	public synchronized byte[] readBinaryRegisterChunk(int registerId, int offset, int length)
+			throws RuntimeException {
+		byte[] encodedOffset = encodeNumber(offset);
+		byte[] encodedLength = encodeNumber(length);
+		byte[] parameters = new byte[encodedOffset.length + encodedLength.length];
+		System.arraycopy(encodedOffset, 0, parameters, 0, encodedOffset.length);
+		System.arraycopy(encodedLength, 0, parameters, encodedOffset.length, encodedLength.length);
+		byte[] request = createRequest(READ_BIN_REGISTRY_CHUNK_REQUEST, registerId, parameters);
+
+		byte[] response = sendCheckedRequest(request, "Read operation failed.");
+		byte[] result = new byte[response.length - 1];
+		System.arraycopy(response, 1, result, 0, result.length);
+		return result;
+	}
+
+	/**
+	 * Writes a chunk of a binary register. The chunk that ends at the total
+	 * length is the last one and the size of the register becomes the total
+	 * length.
+	 * 
+	 * @param registerId
+	 *            the identifier of the register.
+	 * @param offset
+	 *            the offset of the first byte of the chunk.
+	 * @param data
+	 *            the content of the chunk.
+	 * @param totalLength
+	 *            the length of the whole written content.
+	 * @throws RuntimeException
+	 *             if the operation failed.
+	 */
+	public synchronized void writeBinaryRegisterChunk(int registerId, int offset, byte[] data, int totalLength)
+			throws RuntimeException {
+		byte[] encodedOffset = encodeNumber(offset);
+		byte[] encodedTotalLength = encodeNumber(totalLength);
+		byte[] parameters = new byte[encodedOffset.length + encodedTotalLength.length + data.length];
+		System.arraycopy(encodedOffset, 0, parameters, 0, encodedOffset.length);
+		System.arraycopy(encodedTotalLength, 0, parameters, encodedOffset.length, encodedTotalLength.length);
+		System.arraycopy(data, 0, parameters, encodedOffset.length + encodedTotalLength.length, data.length);
+		byte[] request = createRequest(WRITE_BIN_REGISTRY_CHUNK_REQUEST, registerId, parameters);
+		sendCheckedRequest(request, "Write operation failed.");
+	}
+
+	@Override
+	public synchronized byte[] readBinaryRegister(int registerId) throws RuntimeException {
+		int size = getBinaryRegisterSize(registerId);
+		byte[] result = new byte[size];
+		int offset = 0;
+		while (offset < size) {
+			byte[] chunk = readBinaryRegisterChunk(registerId, offset, Math.min(binaryChunkSize, size - offset));
+			if (chunk.length == 0) {
+				throw new RuntimeException("Binary register is shorter than its announced size.");
+			}
+
+			System.arraycopy(chunk, 0, result, offset, chunk.length);
+			offset += chunk.length;
+		}
+
+		return result;
+	}
+
+	@Override
+	public synchronized void writeBinaryRegister(int registerId, byte[] data) throws RuntimeException {
+		int offset = 0;
+		do {
+			int length = Math.min(binaryChunkSize, data.length - offset);
+			byte[] chunk = new byte[length];
+			System.arraycopy(data, offset, chunk, 0, length);
+			writeBinaryRegisterChunk(registerId, offset, chunk, data.length);
+			offset += length;
+		} while (offset < data.length);
+	}
+
+	@Override
+	public synchronized long readLongRegister(int registerId) throws RuntimeException {
+		byte[] request = createRequest(READ_INT64_REGISTRY_REQUEST, registerId, new byte[0]);
+		byte[] response = sendCheckedRequest(request, "Read operation failed.");
+		return decodeZigZagVarint(response, 1);
+	}
+
+	@Override
+	public synchronized void writeLongRegister(int registerId, long value) throws RuntimeException {
+		byte[] request = createRequest(WRITE_INT64_REGISTRY_REQUEST, registerId, encodeZigZagVarint(value));
+		sendCheckedRequest(request, "Write operation failed.");
+	}
+
+	@Override
+	public synchronized float readFloatRegister(int registerId) throws RuntimeException {
+		byte[] request = createRequest(READ_FLOAT_REGISTRY_REQUEST, registerId, new byte[0]);
+		byte[] response = sendCheckedRequest(request, "Read operation failed.");
+		if (response.length < 5) {
+			throw new RuntimeException("Invalid message format.");
+		}
+
+		int bits = 0;
+		for (int i = 4; i >= 1; i--) {
+			bits = (bits << 8) | (response[i] & 0xFF);
+		}
+
+		return Float.intBitsToFloat(bits);
+	}
+
+	@Override
+	public synchronized void writeFloatRegister(int registerId, float value) throws RuntimeException {
+		int bits = Float.floatToIntBits(value);
+		byte[] encodedValue = new byte[4];
+		for (int i = 0; i < 4; i++) {
+			encodedValue[i] = (byte) bits;
+			bits = bits >>> 8;
+		}
+
+		byte[] request = createRequest(WRITE_FLOAT_REGISTRY_REQUEST, registerId, encodedValue);
+		sendCheckedRequest(request, "Write operation failed.");
+	}
+
+	@Override
+	public synchronized BigDecimal readFixedRegister(int registerId) throws RuntimeException {
+		byte[] request = createRequest(READ_FIXED_REGISTRY_REQUEST, registerId, new byte[0]);
+		byte[] response = sendCheckedRequest(request, "Read operation failed.");
+		if (response.length < 3) {
+			throw new RuntimeException("Invalid message format.");
+		}
+
+		int decimals = response[1] & 0xFF;
+		return BigDecimal.valueOf(decodeZigZagVarint(response, 2), decimals);
+	}
+
+	@Override
+	public synchronized void writeFixedRegister(int registerId, BigDecimal value) throws RuntimeException {
+		if (value.scale() < 0) {
+			value = value.setScale(0);
+		}
+
+		if (value.scale() > 255) {
+			throw new RuntimeException("Too many decimal places of a fixed-point value.");
+		}
+
+		long mantissa;
+		try {
+			mantissa = value.unscaledValue().longValueExact();
+		} catch (ArithmeticException e) {
+			throw new RuntimeException("Fixed-point value is out of range.", e);
+		}
+
+		byte[] encodedMantissa = encodeZigZagVarint(mantissa);
+		byte[] parameters = new byte[1 + encodedMantissa.length];
+		parameters[0] = (byte) value.scale();
+		System.arraycopy(encodedMantissa, 0, parameters, 1, encodedMantissa.length);
+
+		byte[] request = createRequest(WRITE_FIXED_REGISTRY_REQUEST, registerId, parameters);
+		sendCheckedRequest(request, "Write operation failed.");
+	}
+
+	/**
+	 * Sends a request and verifies that registry completed the request.
+	 * 
+	 * @param request
+	 *            the encoded request.
+	 * @param failMessage
+	 *            the message of exception thrown when the request failed.
+	 * @return the encoded response.
+	 * @throws RuntimeException
+	 *             if the request failed.
+	 */
+	private byte[] sendCheckedRequest(byte[] request, String failMessage) throws RuntimeException {
+		try {
+			byte[] response = sendRequest(request);
+
+			if (response == null) {
+				throw new RuntimeException("No response from registry.");
+			}
+
+			if (response[0] != REQUEST_OK_RESPONSE) {
+				throw new RuntimeException("Request failed on registry.");
+			}
+
+			return response;
+		} catch (Exception e) {
+			throw new RuntimeException(failMessage, e);
+		}
+	}
+
+	/**
+	 * Creates a request with encoded identifier of register followed by
+	 * request parameters.
+	 * 
+	 * @param requestCode
+	 *            the code of request.
+	 * @param registerId
+	 *            the identifier of the register.
+	 * @param parameters
+	 *            the encoded parameters of the request.
+	 * @return the encoded request.
+	 */
+	private static byte[] createRequest(int requestCode, int registerId, byte[] parameters) {
+		if ((registerId < 0) || (registerId >= 128 * 256)) {
+			throw new RuntimeException("ID (" + registerId + ") of register is out of range.");
+		}
+
+		byte[] request;
+		if (registerId < 128) {
+			request = new byte[2 + parameters.length];
+			request[1] = (byte) registerId;
+			System.arraycopy(parameters, 0, request, 2, parameters.length);
+		} else {
+			request = new byte[3 + parameters.length];
+			request[1] = (byte) ((registerId / 256) | 0x80);
+			request[2] = (byte) (registerId % 256);
+			System.arraycopy(parameters, 0, request, 3, parameters.length);
+		}
+		request[0] = (byte) requestCode;
+
+		return request;
+	}
+
 	/**
 	 * Sends a request and waits for response.
 	 * 
@@ -328,4 +751,63 @@ public class GEPRegistryConnector implements RegistryConnector {
 			throw new RuntimeException("Invalid message format.", e);
 		}
 	}
+
+	/**
+	 * Encodes a 64-bit integer using zigzag varint encoding.
+	 * 
+	 * @param value
+	 *            the value
+	 * @return the value encoded as variable-length sequence of bytes (7 bits
+	 *         per byte, least significant group first).
+	 */
+	private static byte[] encodeZigZagVarint(long value) {
+		long rawValue = (value << 1) ^ (value >> 63);
+		byte[] buffer = new byte[10];
+		int length = 0;
+		while ((rawValue & ~0x7FL) != 0) {
+			buffer[length] = (byte) ((rawValue & 0x7F) | 0x80);
+			rawValue = rawValue >>> 7;
+			length++;
+		}
+		buffer[length] = (byte) rawValue;
+		length++;
+
+		byte[] result = new byte[length];
+		System.arraycopy(buffer, 0, result, 0, length);
+		return result;
+	}
+
+	/**
+	 * Decodes a 64-bit integer encoded using zigzag varint encoding.
+	 * 
+	 * @param data
+	 *            the array of bytes.
+	 * @param offset
+	 *            the offset in data array where encoded value starts.
+	 * @return the decoded value.
+	 */
+	private static long decodeZigZagVarint(byte[] data, int offset) {
+		try {
+			long rawValue = 0;
+			int shift = 0;
+			while (true) {
+				if (shift > 63) {
+					throw new RuntimeException("Too long encoded value.");
+				}
+
+				int aByte = data[offset] & 0xFF;
+				rawValue |= ((long) (aByte & 0x7F)) << shift;
+				shift += 7;
+				offset++;
+
+				if ((aByte & 0x80) == 0) {
+					break;
+				}
+			}
+
+			return (rawValue >>> 1) ^ -(rawValue & 1);
+		} catch (Exception e) {
+			throw new RuntimeException("Invalid message format.", e);
+		}
+	}
 }
@@ -1,5 +1,7 @@
 package net.acprog.modules.messenger;
 
+import java.math.BigDecimal;
+
 /**
  * Interface to access a remote registry.
  */
@@ -28,4 +30,113 @@ public interface RegistryConnector {
 	 */
 	public void writeRegister(int registerId, int value) throws RuntimeException;
 
+	/**
+	 * Writes values to several registers in a single transaction. The values
+	 * are written only if all of them are accepted by the registry. If a write
+	 * of an accepted value fails, the other values remain written and the
+	 * operation fails.
+	 * 
+	 * @param registerIds
+	 *            the identifiers of the registers.
+	 * @param values
+	 *            the values to be written to the registers.
+	 * @throws RuntimeException
+	 *             if the operation failed.
+	 */
+	public void writeRegisters(int[] registerIds, int[] values) throws RuntimeException;
+
+	/**
+	 * Reads content of a binary register. Large registers are transferred in
+	 * chunks.
+	 * 
+	 * @param registerId
+	 *            the identifier of the register.
+	 * @return the content of the register.
+	 * @throws RuntimeException
+	 *             if the operation failed.
+	 */
+	public byte[] readBinaryRegister(int registerId) throws RuntimeException;
+
+	/**
+	 * Writes content of a binary register. Large content is transferred in
+	 * chunks.
+	 * 
+	 * @param registerId
+	 *            the identifier of the register.
+	 * @param data
+	 *            the content to be written to the register.
+	 * @throws RuntimeException
+	 *             if the operation failed.
+	 */
+	public void writeBinaryRegister(int registerId, byte[] data) throws RuntimeException;
+
+	/**
+	 * Reads a value from a 64-bit integer register.
+	 * 
+	 * @param registerId
+	 *            the identifier of the register.
+	 * @return the value of register
+	 * @throws RuntimeException
+	 *             if the operation failed.
+	 */
+	public long readLongRegister(int registerId) throws RuntimeException;
+
+	/**
+	 * Writes a value to a 64-bit integer register.
+	 * 
+	 * @param registerId
+	 *            the identifier of the register.
+	 * @param value
+	 *            the value to be written to the register.
+	 * @throws RuntimeException
+	 *             if the operation failed.
+	 */
+	public void writeLongRegister(int registerId, long value) throws RuntimeException;
+
+	/**
+	 * Reads a value from a float register.
+	 * 
+	 * @param registerId
+	 *            the identifier of the register.
+	 * @return the value of register
+	 * @throws RuntimeException
+	 *             if the operation failed.
+	 */
+	public float readFloatRegister(int registerId) throws RuntimeException;
+
+	/**
+	 * Writes a value to a float register.
+	 * 
+	 * @param registerId
+	 *            the identifier of the register.
+	 * @param value
+	 *            the value to be written to the register.
+	 * @throws RuntimeException
+	 *             if the operation failed.
+	 */
+	public void writeFloatRegister(int registerId, float value) throws RuntimeException;
+
+	/**
+	 * Reads a value from a fixed-point register.
+	 * 
+	 * @param registerId
+	 *            the identifier of the register.
+	 * @return the value of register
+	 * @throws RuntimeException
+	 *             if the operation failed.
+	 */
+	public BigDecimal readFixedRegister(int registerId) throws RuntimeException;
+
+	/**
+	 * Writes a value to a fixed-point register.
+	 * 
+	 * @param registerId
+	 *            the identifier of the register.
+	 * @param value
+	 *            the value to be written to the register.
+	 * @throws RuntimeException
+	 *             if the operation failed.
+	 */
+	public void writeFixedRegister(int registerId, BigDecimal value) throws RuntimeException;
+
 }
@@ -21,6 +21,36 @@ const uint8_t WRITE_BIN_REGISTRY_REQUEST = 0x04;
 // Request for getting change hint - an indentifier of register whose value has been change but not read.
 const uint8_t GET_CHANGE_HINT_REQUEST = 0x05;
 
+// Request for reading a chunk (given by offset and maximal length) of a binary register.
+const uint8_t READ_BIN_REGISTRY_CHUNK_REQUEST = 0x06;
+
+// Request for writing a chunk (given by offset) of a binary register with given total length.
+const uint8_t WRITE_BIN_REGISTRY_CHUNK_REQUEST = 0x07;
+
+// Request for getting size of a binary register in bytes.
+const uint8_t GET_BIN_REGISTRY_SIZE_REQUEST = 0x08;
+
+// Request for reading value of a 64-bit integer register.
+const uint8_t READ_INT64_REGISTRY_REQUEST = 0x09;
+
+// Request for writing value to a 64-bit integer register.
+const uint8_t WRITE_INT64_REGISTRY_REQUEST = 0x0A;
+
+// Request for reading value of a float register.
+const uint8_t READ_FLOAT_REGISTRY_REQUEST = 0x0B;
+
+// Request for writing value to a float register.
+const uint8_t WRITE_FLOAT_REGISTRY_REQUEST = 0x0C;
+
+// Request for reading value of a fixed-point register.
+const uint8_t READ_FIXED_REGISTRY_REQUEST = 0x0D;
+
+// Request for writing value to a fixed-point register.
+const uint8_t WRITE_FIXED_REGISTRY_REQUEST = 0x0E;
+
+// Request for writing values to several integer registers in a single transaction.
+const uint8_t WRITE_INT_REGISTRY_BATCH_REQUEST = 0x0F;
+
 // Response indicating an unknown request or failed request.
 const uint8_t REQUEST_FAILED_RESPONSE = 0x00;
 
@@ -41,6 +71,12 @@ public:
 	// Processing handler invoked when read of an integer register value is requested.
 	long (*readIntRegisterEvent)(unsigned int registerId, bool& outValid);
 
+	// Processing handler invoked to validate a value of an integer register written in
+	// a batch write request. The batch is applied only if all values are accepted.
+	// Accepting a value is a promise that the subsequent write of the value succeeds,
+	// the batch write request fails without it.
+	bool (*prepareWriteIntRegisterEvent)(unsigned int registerId, long value);
+
 	// Processing handler invoked when write of a binary register value is requested.
 	bool (*writeBinRegisterEvent)(unsigned int registerId, const char* data,
 			int dataLength);
@@ -49,6 +85,44 @@ public:
 	int (*readBinRegisterEvent)(unsigned int registerId, char* dstBuffer,
 			int dstBufferSize);
 
+	// Processing handler invoked when write of a chunk of a binary register is requested.
+	// The totalLength is the length of the whole written content, so the chunk that ends
+	// at totalLength is the last one (an empty content is written by a single empty chunk)
+	// and the handler sets the size of the register to totalLength.
+	bool (*writeBinRegisterChunkEvent)(unsigned int registerId, long offset,
+			const char* data, int dataLength, long totalLength);
+
+	// Processing handler invoked when read of a chunk of a binary register is requested.
+	// The handler returns number of bytes written to the buffer (0 if offset is at the end
+	// of the register) or a negative value, if the read failed.
+	int (*readBinRegisterChunkEvent)(unsigned int registerId, long offset,
+			char* dstBuffer, int dstBufferSize);
+
+	// Processing handler invoked when size of a binary register is requested.
+	// The handler returns a negative value, if the size is not available.
+	long (*getBinRegisterSizeEvent)(unsigned int registerId);
+
+	// Processing handler invoked when write of a 64-bit integer register value is requested.
+	bool (*writeInt64RegisterEvent)(unsigned int registerId, int64_t value);
+
+	// Processing handler invoked when read of a 64-bit integer register value is requested.
+	int64_t (*readInt64RegisterEvent)(unsigned int registerId, bool& outValid);
+
+	// Processing handler invoked when write of a float register value is requested.
+	bool (*writeFloatRegisterEvent)(unsigned int registerId, float value);
+
+	// Processing handler invoked when read of a float register value is requested.
+	float (*readFloatRegisterEvent)(unsigned int registerId, bool& outValid);
+
+	// Processing handler invoked when write of a fixed-point register value is requested.
+	// The value of register is mantissa / 10^decimals.
+	bool (*writeFixedRegisterEvent)(unsigned int registerId, long mantissa,
+			uint8_t decimals);
+
+	// Processing handler invoked when read of a fixed-point register value is requested.
+	// The handler sets number of decimal places of the returned mantissa.
+	long (*readFixedRegisterEvent)(unsigned int registerId, uint8_t& outDecimals,
+			bool& outValid);
 };
 
 /********************************************************************************
@@ -115,9 +189,14 @@ private:
 			return true;
 		}
 
-		// Read additional bytes
+		// Read additional bytes (encoded long value has at most 5 bytes)
 		while (hasNextByte) {
-			if ((requestSize == 0) || (numberOfBytes > 5)) {
+			if ((requestSize == 0) || (numberOfBytes >= 5)) {
+				return false;
+			}
+
+			// Reject values that do not fit the long type
+			if (output > (LONG_MAX - 127L) / 128L) {
 				return false;
 			}
 
@@ -192,6 +271,99 @@ private:
 		return rawLength;
 	}
 
+	//--------------------------------------------------------------------------------
+	// Decodes a zigzag encoded 64-bit integer stored as a varint (7 bits per byte,
+	// least significant group first, the highest bit indicates a next byte).
+	inline bool readZigZagVarint(const char* &request, int &requestSize,
+			int64_t &output) {
+		uint64_t rawValue = 0;
+		uint8_t shift = 0;
+		while (true) {
+			if ((requestSize == 0) || (shift > 63)) {
+				return false;
+			}
+
+			const uint8_t aByte = *request;
+
+			// The 10th byte holds only the highest bit of the value (reject the bits
+			// beyond 64 bits and a next byte)
+			if ((shift == 63) && ((aByte & 0xFE) != 0)) {
+				return false;
+			}
+
+			rawValue |= ((uint64_t) (aByte & 0x7F)) << shift;
+			shift += 7;
+			request++;
+			requestSize--;
+
+			if ((aByte & 0x80) == 0) {
+				break;
+			}
+		}
+
+		output = (int64_t) (rawValue >> 1) ^ -((int64_t) (rawValue & 1));
+		return true;
+	}
+
+	//--------------------------------------------------------------------------------
+	// Encodes a 64-bit integer as a zigzag varint. The method returns the number of
+	// written bytes or 0, if the output buffer is too small.
+	inline uint8_t writeZigZagVarint(char* outputBuffer, int bufferSize,
+			int64_t value) {
+		uint64_t rawValue = (((uint64_t) value) << 1) ^ (uint64_t) (value >> 63);
+		uint8_t writtenBytes = 0;
+		while (true) {
+			if (writtenBytes >= bufferSize) {
+				return 0;
+			}
+
+			if (rawValue < 0x80) {
+				outputBuffer[writtenBytes] = (uint8_t) rawValue;
+				return writtenBytes + 1;
+			}
+
+			outputBuffer[writtenBytes] = ((uint8_t) rawValue) | 0x80;
+			rawValue >>= 7;
+			writtenBytes++;
+		}
+	}
+
+	//--------------------------------------------------------------------------------
+	// Decodes a float value stored in 4 bytes (IEEE 754, little-endian).
+	inline bool readFloat(const char* &request, int &requestSize, float &output) {
+		if (requestSize < 4) {
+			return false;
+		}
+
+		uint32_t rawValue = 0;
+		for (int i = 3; i >= 0; i--) {
+			rawValue = (rawValue << 8) | (uint8_t) request[i];
+		}
+		memcpy(&output, &rawValue, 4);
+
+		request += 4;
+		requestSize -= 4;
+		return true;
+	}
+
+	//--------------------------------------------------------------------------------
+	// Encodes a float value to 4 bytes (IEEE 754, little-endian). The method returns
+	// the number of written bytes or 0, if the output buffer is too small.
+	inline uint8_t writeFloat(char* outputBuffer, int bufferSize, float value) {
+		if (bufferSize < 4) {
+			return 0;
+		}
+
+		uint32_t rawValue;
+		memcpy(&rawValue, &value, 4);
+		for (int i = 0; i < 4; i++) {
+			outputBuffer[i] = (uint8_t) rawValue;
+			rawValue >>= 8;
+		}
+
+		return 4;
+	}
+
 	//--------------------------------------------------------------------------------
 	// Creates response indicating that the request failed.
 	inline void createFailResponse(char* responseBuffer, int &responseSize) {
@@ -267,6 +439,77 @@ private:
 		this->watchIdx = 0;
 		return false;
 	}
+	//--------------------------------------------------------------------------------
+	// Handles request for writing values of several integer registers. In the first
+	// pass, all values are validated by the prepare handler. The values are written
+	// only if all of them are accepted (UNWRITABLE_REGISTER_RESPONSE otherwise).
+	// The prepare handler must guarantee that an accepted value can be written.
+	// If a write fails anyway, the batch is partially applied and the transaction
+	// status is REQUEST_FAILED_RESPONSE. The response contains status of the
+	// transaction followed by status of each register in order of the request.
+	void handleBatchWriteRequest(const char* request, int requestSize,
+			char* responseBuffer, int &responseSize) {
+		if ((controller.writeIntRegisterEvent == NULL)
+				|| (controller.prepareWriteIntRegisterEvent == NULL)) {
+			createFailResponse(responseBuffer, responseSize);
+			return;
+		}
+
+		// Validate all pairs (registerId, value) and store results of validation
+		const char* const requestStart = request;
+		const int requestStartSize = requestSize;
+		bool allAccepted = true;
+		int registerCount = 0;
+		while (requestSize > 0) {
+			const int registerId = readRegisterId(request, requestSize);
+			long value;
+			if ((registerId < 0) || (!readEncodedLong(request, requestSize, value))
+					|| (1 + registerCount + 1 > responseSize)) {
+				createFailResponse(responseBuffer, responseSize);
+				return;
+			}
+
+			const bool accepted = controller.prepareWriteIntRegisterEvent(
+					registerId, value);
+			registerCount++;
+			responseBuffer[registerCount] =
+					accepted ? REQUEST_OK_RESPONSE : UNWRITABLE_REGISTER_RESPONSE;
+			allAccepted = allAccepted && accepted;
+		}
+
+		if (registerCount == 0) {
+			createFailResponse(responseBuffer, responseSize);
+			return;
+		}
+
+		responseSize = 1 + registerCount;
+		if (!allAccepted) {
+			*responseBuffer = UNWRITABLE_REGISTER_RESPONSE;
+			return;
+		}
+
+		// Apply all values (the request has been validated in the first pass)
+		request = requestStart;
+		requestSize = requestStartSize;
+		bool allWritten = true;
+		for (int i = 1; i <= registerCount; i++) {
+			const int registerId = readRegisterId(request, requestSize);
+			long value;
+			readEncodedLong(request, requestSize, value);
+
+			if (controller.writeIntRegisterEvent(registerId, value)) {
+				if (MARK_ON_WRITE) {
+					markModifiedRegister(registerId);
+				}
+			} else {
+				responseBuffer[i] = UNWRITABLE_REGISTER_RESPONSE;
+				allWritten = false;
+			}
+		}
+
+		*responseBuffer = allWritten ? REQUEST_OK_RESPONSE : REQUEST_FAILED_RESPONSE;
+	}
+
 public:
 	//--------------------------------------------------------------------------------
 	// Constructs view associated with a controller
@@ -337,12 +580,28 @@ public:
 			return;
 		}
 
+		// Action for writing values of several integer registers
+		if (requestCode == WRITE_INT_REGISTRY_BATCH_REQUEST) {
+			handleBatchWriteRequest(request, requestSize, responseBuffer,
+					responseSize);
+			return;
+		}
+
 		// If action code is followed by encoded ID of a register, we read the id
-		int registerId;
+		int registerId = -1;
 		if ((requestCode == READ_INT_REGISTRY_REQUEST)
 				|| (requestCode == WRITE_INT_REGISTRY_REQUEST)
 				|| (requestCode == READ_BIN_REGISTRY_REQUEST)
-				|| (requestCode == WRITE_BIN_REGISTRY_REQUEST)) {
+				|| (requestCode == WRITE_BIN_REGISTRY_REQUEST)
+				|| (requestCode == READ_BIN_REGISTRY_CHUNK_REQUEST)
+				|| (requestCode == WRITE_BIN_REGISTRY_CHUNK_REQUEST)
+				|| (requestCode == GET_BIN_REGISTRY_SIZE_REQUEST)
+				|| (requestCode == READ_INT64_REGISTRY_REQUEST)
+				|| (requestCode == WRITE_INT64_REGISTRY_REQUEST)
+				|| (requestCode == READ_FLOAT_REGISTRY_REQUEST)
+				|| (requestCode == WRITE_FLOAT_REGISTRY_REQUEST)
+				|| (requestCode == READ_FIXED_REGISTRY_REQUEST)
+				|| (requestCode == WRITE_FIXED_REGISTRY_REQUEST)) {
 			registerId = readRegisterId(request, requestSize);
 			if (registerId < 0) {
 				createFailResponse(responseBuffer, responseSize);
@@ -444,6 +703,269 @@ public:
 			responseSize = 1;
 			return;
 		}
+
+		// Request to read a chunk of a binary register
+		if (requestCode == READ_BIN_REGISTRY_CHUNK_REQUEST) {
+			long offset;
+			long maxLength;
+			if ((controller.readBinRegisterChunkEvent == NULL)
+					|| (!readEncodedLong(request, requestSize, offset))
+					|| (!readEncodedLong(request, requestSize, maxLength))
+					|| (offset < 0) || (maxLength < 0)) {
+				createFailResponse(responseBuffer, responseSize);
+				return;
+			}
+
+			// Limit length of the chunk by free space in the response buffer
+			if (maxLength > responseSize - 1) {
+				maxLength = responseSize - 1;
+			}
+
+			const int writtenBytes = controller.readBinRegisterChunkEvent(
+					registerId, offset, responseBuffer + 1, (int) maxLength);
+			if ((writtenBytes < 0) || (writtenBytes > maxLength)) {
+				createFailResponse(responseBuffer, responseSize);
+				return;
+			}
+
+			// Reading of the register starts with the first chunk
+			if (offset == 0) {
+				markRegisterRead(registerId);
+			}
+
+			// Complete response
+			responseSize = 1 + writtenBytes;
+			*responseBuffer = REQUEST_OK_RESPONSE;
+			return;
+		}
+
+		// Request to write a chunk of a binary register
+		if (requestCode == WRITE_BIN_REGISTRY_CHUNK_REQUEST) {
+			long offset;
+			long totalLength;
+			if ((controller.writeBinRegisterChunkEvent == NULL)
+					|| (!readEncodedLong(request, requestSize, offset))
+					|| (!readEncodedLong(request, requestSize, totalLength))
+					|| (offset < 0) || (offset > totalLength)
+					|| (requestSize > totalLength - offset)) {
+				createFailResponse(responseBuffer, responseSize);
+				return;
+			}
+
+			if (controller.writeBinRegisterChunkEvent(registerId, offset,
+					request, requestSize, totalLength)) {
+				*responseBuffer = REQUEST_OK_RESPONSE;
+				if (MARK_ON_WRITE) {
+					markModifiedRegister(registerId);
+				}
+			} else {
+				*responseBuffer = UNWRITABLE_REGISTER_RESPONSE;
+			}
+
+			responseSize = 1;
+			return;
+		}
+
+		// Request to get size of a binary register
+		if (requestCode == GET_BIN_REGISTRY_SIZE_REQUEST) {
+			if (controller.getBinRegisterSizeEvent == NULL) {
+				createFailResponse(responseBuffer, responseSize);
+				return;
+			}
+
+			const long size = controller.getBinRegisterSizeEvent(registerId);
+			if (size < 0) {
+				createFailResponse(responseBuffer, responseSize);
+				return;
+			}
+
+			uint8_t writtenBytes = writeEncodedLong(responseBuffer + 1,
+					responseSize - 1, size);
+			if (writtenBytes == 0) {
+				createFailResponse(responseBuffer, responseSize);
+				return;
+			}
+
+			// Complete response
+			responseSize = 1 + writtenBytes;
+			*responseBuffer = REQUEST_OK_RESPONSE;
+			return;
+		}
+
+		// Request to read a value from a 64-bit integer register
+		if (requestCode == READ_INT64_REGISTRY_REQUEST) {
+			if (controller.readInt64RegisterEvent == NULL) {
+				createFailResponse(responseBuffer, responseSize);
+				return;
+			}
+
+			bool outValid = true;
+			const int64_t value = controller.readInt64RegisterEvent(registerId,
+					outValid);
+
+			if (!outValid) {
+				createFailResponse(responseBuffer, responseSize);
+				return;
+			}
+
+			uint8_t writtenBytes = writeZigZagVarint(responseBuffer + 1,
+					responseSize - 1, value);
+			if (writtenBytes == 0) {
+				createFailResponse(responseBuffer, responseSize);
+				return;
+			}
+
+			markRegisterRead(registerId);
+
+			// Complete response
+			responseSize = 1 + writtenBytes;
+			*responseBuffer = REQUEST_OK_RESPONSE;
+			return;
+		}
+
+		// Request to write a value to a 64-bit integer register
+		if (requestCode == WRITE_INT64_REGISTRY_REQUEST) {
+			int64_t value;
+			if ((controller.writeInt64RegisterEvent == NULL)
+					|| (!readZigZagVarint(request, requestSize, value))) {
+				createFailResponse(responseBuffer, responseSize);
+				return;
+			}
+
+			if (controller.writeInt64RegisterEvent(registerId, value)) {
+				*responseBuffer = REQUEST_OK_RESPONSE;
+				if (MARK_ON_WRITE) {
+					markModifiedRegister(registerId);
+				}
+			} else {
+				*responseBuffer = UNWRITABLE_REGISTER_RESPONSE;
+			}
+
+			responseSize = 1;
+			return;
+		}
+
+		// Request to read a value from a float register
+		if (requestCode == READ_FLOAT_REGISTRY_REQUEST) {
+			if (controller.readFloatRegisterEvent == NULL) {
+				createFailResponse(responseBuffer, responseSize);
+				return;
+			}
+
+			bool outValid = true;
+			const float value = controller.readFloatRegisterEvent(registerId,
+					outValid);
+
+			if (!outValid) {
+				createFailResponse(responseBuffer, responseSize);
+				return;
+			}
+
+			uint8_t writtenBytes = writeFloat(responseBuffer + 1,
+					responseSize - 1, value);
+			if (writtenBytes == 0) {
+				createFailResponse(responseBuffer, responseSize);
+				return;
+			}
+
+			markRegisterRead(registerId);
+
+			// Complete response
+			responseSize = 1 + writtenBytes;
+			*responseBuffer = REQUEST_OK_RESPONSE;
+			return;
+		}
+
+		// Request to write a value to a float register
+		if (requestCode == WRITE_FLOAT_REGISTRY_REQUEST) {
+			float value;
+			if ((controller.writeFloatRegisterEvent == NULL)
+					|| (!readFloat(request, requestSize, value))) {
+				createFailResponse(responseBuffer, responseSize);
+				return;
+			}
+
+			if (controller.writeFloatRegisterEvent(registerId, value)) {
+				*responseBuffer = REQUEST_OK_RESPONSE;
+				if (MARK_ON_WRITE) {
+					markModifiedRegister(registerId);
+				}
+			} else {
+				*responseBuffer = UNWRITABLE_REGISTER_RESPONSE;
+			}
+
+			responseSize = 1;
+			return;
+		}
+
+		// Request to read a value from a fixed-point register
+		if (requestCode == READ_FIXED_REGISTRY_REQUEST) {
+			if ((controller.readFixedRegisterEvent == NULL) || (responseSize < 2)) {
+				createFailResponse(responseBuffer, responseSize);
+				return;
+			}
+
+			bool outValid = true;
+			uint8_t decimals = 0;
+			const long mantissa = controller.readFixedRegisterEvent(registerId,
+					decimals, outValid);
+
+			if (!outValid) {
+				createFailResponse(responseBuffer, responseSize);
+				return;
+			}
+
+			// Response: number of decimal places followed by the mantissa
+			responseBuffer[1] = decimals;
+			uint8_t writtenBytes = writeZigZagVarint(responseBuffer + 2,
+					responseSize - 2, mantissa);
+			if (writtenBytes == 0) {
+				createFailResponse(responseBuffer, responseSize);
+				return;
+			}
+
+			markRegisterRead(registerId);
+
+			// Complete response
+			responseSize = 2 + writtenBytes;
+			*responseBuffer = REQUEST_OK_RESPONSE;
+			return;
+		}
+
+		// Request to write a value to a fixed-point register
+		if (requestCode == WRITE_FIXED_REGISTRY_REQUEST) {
+			if ((controller.writeFixedRegisterEvent == NULL) || (requestSize == 0)) {
+				createFailResponse(responseBuffer, responseSize);
+				return;
+			}
+
+			const uint8_t decimals = (uint8_t) *request;
+			request++;
+			requestSize--;
+
+			int64_t mantissa;
+			if ((!readZigZagVarint(request, requestSize, mantissa))
+					|| (mantissa < LONG_MIN) || (mantissa > LONG_MAX)) {
+				createFailResponse(responseBuffer, responseSize);
+				return;
+			}
+
+			if (controller.writeFixedRegisterEvent(registerId, (long) mantissa,
+					decimals)) {
+				*responseBuffer = REQUEST_OK_RESPONSE;
+				if (MARK_ON_WRITE) {
+					markModifiedRegister(registerId);
+				}
+			} else {
+				*responseBuffer = UNWRITABLE_REGISTER_RESPONSE;
+			}
+
+			responseSize = 1;
+			return;
+		}
+
+		// Unknown request
+		createFailResponse(responseBuffer, responseSize);
 	}
 };
 
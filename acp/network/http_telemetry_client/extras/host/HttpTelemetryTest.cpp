@@ -0,0 +1,335 @@
+/********************************************************************************
+ * Test of HttpTelemetryController against a scripted collector that runs in the
+ * same process on a POSIX socket (see PosixNetwork.h). Each request received by
+ * the collector is answered by the next action of a script: a status code or
+ * closing the connection without a response. The simulated clock moves only by
+ * delay(), so that retry delays are deterministic. The test checks:
+ * - 2xx delivers the batch and keeps the connection alive,
+ * - 4xx drops the batch, 408, 429 and 5xx are retried with backoff,
+ * - the oldest samples are dropped when the ring buffer overflows,
+ * - a kept-alive connection closed by the collector is replaced at once, without
+ *   a failed attempt, while a closed new connection is a failed attempt,
+ * - a batch is dropped after MaxAttempts failed attempts,
+ * - pending samples are sent after the flush interval or flush().
+ *
+ * Usage: HttpTelemetryTest [port]
+ ********************************************************************************/
+
+#include <acp/network/http_telemetry_client/HttpTelemetryClient.h>
+#include <HostCore.h>
+#include <PosixNetwork.h>
+#include <stdio.h>
+
+using namespace acp_network_http_telemetry_client;
+
+// Script action that closes the connection without a response
+#define DROP 0
+
+// Maximal number of script actions
+#define MAX_ACTIONS 8
+
+/********************************************************************************
+ * Client that counts opened connections.
+ ********************************************************************************/
+class CountingClient: public PosixClient {
+private:
+	// Number of connect calls
+	int connects;
+public:
+	CountingClient() :
+			connects(0) {
+	}
+
+	int connect(IPAddress ip, uint16_t port) {
+		connects++;
+		return PosixClient::connect(ip, port);
+	}
+
+	int connect(const char* host, uint16_t port) {
+		connects++;
+		return PosixClient::connect(host, port);
+	}
+
+	//--------------------------------------------------------------------------------
+	// Returns the number of connect calls.
+	int getConnects() {
+		return connects;
+	}
+};
+
+/********************************************************************************
+ * Collector that answers requests by script actions.
+ ********************************************************************************/
+class ScriptedCollector {
+private:
+	// Listening server
+	PosixServer server;
+
+	// Received part of the current request
+	char request[1024];
+	int requestLength;
+
+	// Actions for next requests
+	int actions[MAX_ACTIONS];
+	int actionCount;
+	int nextAction;
+
+	// Number of received requests
+	int requests;
+
+	// Number of samples in the last received request
+	int lastSamples;
+
+	//--------------------------------------------------------------------------------
+	// Returns the number of occurrences of a string in the received request.
+	int countOccurrences(const char* str) {
+		int count = 0;
+		for (const char* p = strstr(request, str); p != NULL; p = strstr(p + 1, str)) {
+			count++;
+		}
+		return count;
+	}
+
+	//--------------------------------------------------------------------------------
+	// Returns whether the received request is complete.
+	bool isRequestComplete() {
+		const char* body = strstr(request, "\r\n\r\n");
+		const char* contentLength = strstr(request, "Content-Length: ");
+		if ((body == NULL) || (contentLength == NULL)) {
+			return false;
+		}
+
+		return request + requestLength - (body + 4) >= atol(contentLength + 16);
+	}
+
+	//--------------------------------------------------------------------------------
+	// Answers the complete request by the next action.
+	void answer(PosixClient& client) {
+		requests++;
+		lastSamples = countOccurrences("\"name\"");
+		const int action = (nextAction < actionCount) ? actions[nextAction++] : 200;
+		requestLength = 0;
+		if (action == DROP) {
+			client.stop();
+			return;
+		}
+
+		char response[64];
+		const int length = snprintf(response, sizeof(response),
+				"HTTP/1.1 %d Scripted\r\nContent-Length: 0\r\n\r\n", action);
+		client.write((const uint8_t*) response, length);
+	}
+
+public:
+	ScriptedCollector(uint16_t port) :
+			server(port), requestLength(0), actionCount(0), nextAction(0), requests(0), lastSamples(0) {
+		request[0] = 0;
+	}
+
+	//--------------------------------------------------------------------------------
+	// Starts listening.
+	bool begin() {
+		server.begin();
+		return server.listening();
+	}
+
+	//--------------------------------------------------------------------------------
+	// Sets actions for next requests (the following requests are answered by 200).
+	void script(int action1, int action2 = -1, int action3 = -1, int action4 = -1) {
+		const int script[] = { action1, action2, action3, action4 };
+		actionCount = 0;
+		nextAction = 0;
+		for (int i = 0; (i < 4) && (script[i] >= 0); i++) {
+			actions[actionCount++] = script[i];
+		}
+	}
+
+	//--------------------------------------------------------------------------------
+	// Receives requests and answers complete requests.
+	void loop() {
+		PosixClient client = server.available();
+		if (!client) {
+			return;
+		}
+
+		if (client.available() <= 0) {
+			// Closed by the client
+			client.stop();
+			requestLength = 0;
+			return;
+		}
+
+		const int readBytes = client.read((uint8_t*) request + requestLength, sizeof(request) - 1 - requestLength);
+		if (readBytes > 0) {
+			requestLength += readBytes;
+		}
+		request[requestLength] = 0;
+
+		if (isRequestComplete()) {
+			answer(client);
+		}
+	}
+
+	//--------------------------------------------------------------------------------
+	// Waits at most timeout milliseconds for a new connection or data.
+	void wait(int timeout) {
+		server.wait(timeout);
+	}
+
+	//--------------------------------------------------------------------------------
+	// Returns the number of received requests.
+	int getRequests() {
+		return requests;
+	}
+
+	//--------------------------------------------------------------------------------
+	// Returns the number of samples in the last received request.
+	int getLastSamples() {
+		return lastSamples;
+	}
+};
+
+HttpTelemetryController<6, 3> controller;
+THttpTelemetryClient<6, 3> telemetry(controller);
+CountingClient client;
+ScriptedCollector* collector;
+
+// Number of failed checks
+static int failures = 0;
+
+//--------------------------------------------------------------------------------
+// Reports a failed check.
+static void check(bool condition, const char* description) {
+	if (!condition) {
+		printf("FAIL: %s\n", description);
+		failures++;
+	}
+}
+
+//--------------------------------------------------------------------------------
+// Runs the telemetry looper and the collector until the collector received given
+// total number of requests (at most 5 seconds) and the responses are processed.
+static void settle(int requests) {
+	for (int i = 0; (i < 5000) && (collector->getRequests() < requests); i++) {
+		controller.telemetryLooper();
+		collector->loop();
+		collector->wait(1);
+	}
+
+	for (int i = 0; i < 20; i++) {
+		controller.telemetryLooper();
+		collector->loop();
+	}
+}
+
+//--------------------------------------------------------------------------------
+// Adds given number of samples.
+static void addSamples(int count) {
+	for (int i = 0; i < count; i++) {
+		telemetry.addSample(F("temperature"), 20 + i);
+	}
+}
+
+int main(int argc, char* argv[]) {
+	const uint16_t port = (argc > 1) ? atoi(argv[1]) : 18081;
+	static ScriptedCollector scriptedCollector(port);
+	collector = &scriptedCollector;
+	if (!collector->begin()) {
+		perror("HttpTelemetryTest");
+		return 1;
+	}
+
+	controller.init(F("127.0.0.1"), port, F("/collect"), 10000, 2000, 100, 400, 4);
+	telemetry.setClient(&client);
+
+	// A partial batch waits for the flush interval, a full batch is sent at once (2xx)
+	addSamples(2);
+	settle(0);
+	check(collector->getRequests() == 0, "partial batch is not sent");
+	addSamples(1);
+	settle(1);
+	check(collector->getLastSamples() == 3, "full batch is sent");
+	check((telemetry.getDeliveredSamples() == 3) && (telemetry.getPendingSamples() == 0), "2xx delivers the batch");
+	check(telemetry.isLinkUp() && client.connected(), "2xx keeps the connection alive");
+
+	// 5xx, 429 and 408 are retried with exponential backoff (100, 200, 400 ms)
+	collector->script(503, 429, 408, 200);
+	addSamples(3);
+	settle(2);
+	check(!telemetry.isLinkUp() && (telemetry.getPendingSamples() == 3), "5xx keeps the batch");
+	delay(99);
+	settle(0);
+	check(collector->getRequests() == 2, "retry waits for the retry delay");
+	delay(1);
+	settle(3);
+	check((collector->getRequests() == 3) && !telemetry.isLinkUp(), "429 is retried");
+	delay(199);
+	settle(0);
+	check(collector->getRequests() == 3, "retry delay doubles");
+	delay(1);
+	settle(4);
+	check((collector->getRequests() == 4) && !telemetry.isLinkUp(), "408 is retried");
+	delay(400);
+	settle(5);
+	check((telemetry.getDeliveredSamples() == 6) && telemetry.isLinkUp(), "retried batch is delivered");
+
+	// The oldest samples are dropped from the full ring buffer, 4xx drops the batch
+	collector->script(400, 200);
+	addSamples(8);
+	check((telemetry.getPendingSamples() == 6) && (telemetry.getDroppedSamples() == 2), "ring buffer drops oldest samples");
+	settle(7);
+	check(telemetry.getDroppedSamples() == 5, "4xx drops the batch");
+	check((telemetry.getDeliveredSamples() == 9) && (telemetry.getPendingSamples() == 0), "next batch follows a rejected batch");
+
+	// A kept-alive connection closed by the collector is replaced without a retry delay
+	const int connects = client.getConnects();
+	collector->script(DROP, 200);
+	addSamples(3);
+	settle(9);
+	check(collector->getRequests() == 9, "batch is resent over a new connection");
+	check((telemetry.getDeliveredSamples() == 12) && telemetry.isLinkUp(), "resent batch is delivered");
+	check(client.getConnects() == connects + 1, "closed connection is replaced once");
+
+	// A new connection closed by the collector is a failed attempt
+	collector->script(503, DROP, 200);
+	addSamples(3);
+	settle(10);
+	delay(100);
+	settle(11);
+	check((collector->getRequests() == 11) && !telemetry.isLinkUp(), "closed new connection is a failed attempt");
+	delay(199);
+	settle(0);
+	check(collector->getRequests() == 11, "closed new connection is retried with backoff");
+	delay(1);
+	settle(12);
+	check((telemetry.getDeliveredSamples() == 15) && telemetry.isLinkUp(), "batch is delivered after a closed connection");
+
+	// A batch is dropped after MaxAttempts failed attempts
+	collector->script(500, 500, 500, 500);
+	addSamples(3);
+	settle(13);
+	delay(100);
+	settle(14);
+	delay(200);
+	settle(15);
+	delay(400);
+	settle(16);
+	check((telemetry.getDroppedSamples() == 8) && (telemetry.getPendingSamples() == 0), "batch is dropped after max attempts");
+	check(telemetry.isLinkUp(), "attempts are reset after a dropped batch");
+
+	// Pending samples are sent after the flush interval or on flush()
+	addSamples(1);
+	delay(9999);
+	settle(0);
+	check(collector->getRequests() == 16, "sample waits for the flush interval");
+	delay(1);
+	settle(17);
+	check((collector->getLastSamples() == 1) && (telemetry.getDeliveredSamples() == 16), "flush interval sends pending samples");
+	addSamples(2);
+	telemetry.flush();
+	settle(18);
+	check((collector->getLastSamples() == 2) && (telemetry.getDeliveredSamples() == 18), "flush sends pending samples");
+
+	printf("%s: %d failed checks\n", (failures == 0) ? "OK" : "FAILED", failures);
+	return (failures == 0) ? 0 : 1;
+}
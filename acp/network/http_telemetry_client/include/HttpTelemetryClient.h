@@ -0,0 +1,630 @@
+#ifndef MODULES_ACP_NETWORK_HTTP_TELEMETRY_CLIENT_INCLUDE_HTTPTELEMETRYCLIENT_H_
+#define MODULES_ACP_NETWORK_HTTP_TELEMETRY_CLIENT_INCLUDE_HTTPTELEMETRYCLIENT_H_
+
+#include <acp/core.h>
+#include <acp/network/libs/format_printers/FormatPrinters.h>
+
+#include <Client.h>
+
+namespace acp_network_http_telemetry_client {
+
+	template<int SAMPLE_CAPACITY, int BATCH_SIZE> class THttpTelemetryClient;
+	template<int SAMPLE_CAPACITY, int BATCH_SIZE> class HttpTelemetryController;
+
+	/********************************************************************************
+	 * Sample (reading) waiting to be pushed to the collector
+	 ********************************************************************************/
+	struct TelemetrySample {
+		// Name of the measured quantity (stored in flash memory)
+		const __FlashStringHelper* name;
+		// Measured value
+		double value;
+		// Time (millis) when the sample was taken
+		unsigned long time;
+	};
+
+	/********************************************************************************
+	 * Print that only counts written bytes (used to compute the content length)
+	 ********************************************************************************/
+	class CountingPrint: public Print {
+	private:
+		// Number of written bytes
+		unsigned long count;
+	public:
+		//--------------------------------------------------------------------------------
+		// Constructs a counting print.
+		CountingPrint() :
+				count(0) {
+			// Nothing to do
+		}
+
+		//--------------------------------------------------------------------------------
+		// Writes a byte.
+		virtual size_t write(uint8_t /*data*/) {
+			count++;
+			return 1;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Writes a block of bytes.
+		virtual size_t write(const uint8_t* /*data*/, size_t size) {
+			count += size;
+			return size;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns the number of written bytes.
+		inline unsigned long getCount() {
+			return count;
+		}
+	};
+
+	/********************************************************************************
+	 * Controller of the http telemetry client. Samples are stored in a ring buffer
+	 * and pushed to the collector in batches by POST requests with a JSON array of
+	 * samples. The connection to the collector is kept alive between batches; if the
+	 * collector closes an idle connection, the batch is resent over a new one.
+	 * Failed batches are retried with an exponential backoff.
+	 ********************************************************************************/
+	template<int SAMPLE_CAPACITY, int BATCH_SIZE> class HttpTelemetryController {
+		friend class THttpTelemetryClient<SAMPLE_CAPACITY, BATCH_SIZE>;
+	private:
+		// Maximal length of the host name
+		static const int MAX_HOST_LENGTH = 64;
+
+		// Size of the buffer used to receive a line of the response
+		static const int LINE_BUFFER_SIZE = 32;
+
+		// Size of the buffer used to coalesce writes of the request
+		static const int OUTPUT_BUFFER_SIZE = 64;
+
+		// Phases of a request
+		enum Phase {
+			IDLE, STATUS_LINE, HEADER_FIELDS, BODY
+		};
+
+		// Client used to connect the collector
+		Client* client;
+
+		// Host name of the collector (stored in flash memory)
+		const __FlashStringHelper* host;
+
+		// Port of the collector
+		uint16_t port;
+
+		// Path of the collecting resource (stored in flash memory)
+		const __FlashStringHelper* path;
+
+		// Maximal time in milliseconds that a sample waits before a (non-full) batch is sent
+		unsigned long flushInterval;
+
+		// Time limit in milliseconds to receive the response
+		unsigned long responseTimeout;
+
+		// Delay in milliseconds before the first retry of a failed batch
+		unsigned long retryDelay;
+
+		// Maximal delay in milliseconds between retries
+		unsigned long maxRetryDelay;
+
+		// Maximal number of consecutive failed attempts to send a batch before the batch is
+		// dropped (0 for unlimited retries)
+		uint8_t maxAttempts;
+
+		// Ring buffer of samples
+		TelemetrySample samples[SAMPLE_CAPACITY];
+
+		// Index of the oldest sample in the ring buffer
+		int firstSample;
+
+		// Number of samples in the ring buffer
+		int sampleCount;
+
+		// Number of samples dropped due to a full ring buffer or a rejected batch
+		unsigned long droppedSamples;
+
+		// Number of samples delivered to the collector
+		unsigned long deliveredSamples;
+
+		// Phase of the current request
+		Phase phase;
+
+		// Number of samples (from the oldest one) sent in the current request
+		int batchSamples;
+
+		// Time when the current request was sent
+		unsigned long requestTime;
+
+		// Time when sending of the next batch is allowed (after a failure)
+		unsigned long retryTime;
+
+		// Number of consecutive failed attempts
+		uint8_t failedAttempts;
+
+		// Indicates whether the pending samples are sent without waiting for a full batch
+		bool flushRequested;
+
+		// Status code of the response
+		int statusCode;
+
+		// Number of remaining bytes of the response body (-1, if unknown)
+		long remainingBodyBytes;
+
+		// Indicates whether the collector closes the connection after the response
+		bool connectionClose;
+
+		// Indicates whether the current request was sent over a connection kept alive
+		// after the previous response
+		bool reusedConnection;
+
+		// Received line of the response (lower case, longer lines are truncated)
+		char line[LINE_BUFFER_SIZE];
+
+		// Length of the received line
+		uint8_t lineLength;
+
+		//--------------------------------------------------------------------------------
+		// Returns whether a string starts with given string stored in flash memory.
+		static bool startsWithFString(const char* str, const __FlashStringHelper* ifsh) {
+			PGM_P p = reinterpret_cast<PGM_P>(ifsh);
+			while (true) {
+				const char c = pgm_read_byte(p);
+				if (c == 0) {
+					return true;
+				}
+
+				if (c != *str) {
+					return false;
+				}
+
+				str++;
+				p++;
+			}
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns a pointer to the first non-space character of a header value.
+		static const char* skipSpaces(const char* str) {
+			while (*str == ' ') {
+				str++;
+			}
+
+			return str;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns whether sending of a batch is due.
+		bool isBatchDue(unsigned long now) {
+			if (sampleCount == 0) {
+				return false;
+			}
+
+			if ((failedAttempts > 0) && ((long)(now - retryTime) < 0)) {
+				return false;
+			}
+
+			return flushRequested || (sampleCount >= BATCH_SIZE) || (now - samples[firstSample].time >= flushInterval);
+		}
+
+		//--------------------------------------------------------------------------------
+		// Connects the collector, if the connection is not open.
+		bool connect() {
+			if (client->connected()) {
+				reusedConnection = true;
+				return true;
+			}
+
+			client->stop();
+			reusedConnection = false;
+
+			char hostName[MAX_HOST_LENGTH + 1];
+			PGM_P p = reinterpret_cast<PGM_P>(host);
+			int length = 0;
+			while (length < MAX_HOST_LENGTH) {
+				const char c = pgm_read_byte(p++);
+				if (c == 0) {
+					break;
+				}
+				hostName[length++] = c;
+			}
+			hostName[length] = 0;
+
+			return client->connect(hostName, port) > 0;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Prints the JSON array with first given number of samples.
+		void printSamples(Print* out, int count, unsigned long now) {
+			out->print('[');
+			for (int i = 0; i < count; i++) {
+				if (i > 0) {
+					out->print(',');
+				}
+
+				const TelemetrySample& sample = samples[(firstSample + i) % SAMPLE_CAPACITY];
+				acp_network_libs_format_printers::JSONMapPrinter printer(out);
+				printer.add(F("name"), sample.name);
+				printer.add(F("value"), sample.value);
+				printer.add(F("age"), now - sample.time);
+				printer.close();
+			}
+			out->print(']');
+		}
+
+		//--------------------------------------------------------------------------------
+		// Sends a request with the batch of oldest samples. Returns whether the request
+		// was sent.
+		bool sendBatch() {
+			if (!connect()) {
+				return false;
+			}
+
+			// Ages of samples are relative to the time of sending, the collector derives
+			// absolute time from the time of receiving.
+			const unsigned long now = millis();
+			batchSamples = (sampleCount < BATCH_SIZE) ? sampleCount : BATCH_SIZE;
+
+			CountingPrint counter;
+			printSamples(&counter, batchSamples, now);
+
+			uint8_t outputBuffer[OUTPUT_BUFFER_SIZE];
+			acp_network_libs_format_printers::BufferedPrint output(client, outputBuffer, OUTPUT_BUFFER_SIZE);
+			output.print(F("POST "));
+			output.print(path);
+			output.print(F(" HTTP/1.1\r\nHost: "));
+			output.print(host);
+			if (port != 80) {
+				output.print(':');
+				output.print(port);
+			}
+			output.print(F("\r\nContent-Type: application/json\r\nContent-Length: "));
+			output.print(counter.getCount());
+			output.print(F("\r\nConnection: keep-alive\r\n\r\n"));
+			printSamples(&output, batchSamples, now);
+			output.flush();
+
+			requestTime = millis();
+			phase = STATUS_LINE;
+			statusCode = 0;
+			remainingBodyBytes = -1;
+			connectionClose = false;
+			lineLength = 0;
+			return true;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Removes first given number of samples from the ring buffer.
+		void removeSamples(int count) {
+			firstSample = (firstSample + count) % SAMPLE_CAPACITY;
+			sampleCount -= count;
+			if (sampleCount == 0) {
+				flushRequested = false;
+			}
+		}
+
+		//--------------------------------------------------------------------------------
+		// Handles a failed attempt to send a batch: the connection is closed and the next
+		// attempt is delayed.
+		void handleFailure() {
+			client->stop();
+			phase = IDLE;
+
+			if (failedAttempts < 255) {
+				failedAttempts++;
+			}
+
+			// Drop the batch after too many attempts
+			if ((maxAttempts > 0) && (failedAttempts >= maxAttempts)) {
+				const int count = (batchSamples > 0) ? batchSamples : ((sampleCount < BATCH_SIZE) ? sampleCount : BATCH_SIZE);
+				removeSamples(count);
+				droppedSamples += count;
+				failedAttempts = 0;
+				return;
+			}
+
+			// Exponential backoff
+			unsigned long delayTime = retryDelay;
+			for (uint8_t i = 1; (i < failedAttempts) && (delayTime < maxRetryDelay); i++) {
+				delayTime = delayTime << 1;
+			}
+
+			if (delayTime > maxRetryDelay) {
+				delayTime = maxRetryDelay;
+			}
+
+			retryTime = millis() + delayTime;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Handles a connection closed before the response. A kept-alive connection that
+		// the collector closed before receiving the request (e.g., after an idle timeout)
+		// is not a failure of the collector, so the batch is sent again at once over a new
+		// connection.
+		void handleConnectionClosed() {
+			if (reusedConnection && (phase == STATUS_LINE) && (lineLength == 0)) {
+				client->stop();
+				if (sendBatch()) {
+					return;
+				}
+			}
+
+			handleFailure();
+		}
+
+		//--------------------------------------------------------------------------------
+		// Completes the current request after the response has been received.
+		void completeRequest() {
+			phase = IDLE;
+			if (connectionClose) {
+				client->stop();
+			}
+
+			if ((statusCode >= 200) && (statusCode < 300)) {
+				removeSamples(batchSamples);
+				deliveredSamples += batchSamples;
+				failedAttempts = 0;
+			} else if ((statusCode >= 400) && (statusCode < 500) && (statusCode != 408) && (statusCode != 429)) {
+				// The collector rejects the batch, retrying would not help (except for 408 Request
+				// Timeout and 429 Too Many Requests that are retried with backoff)
+				removeSamples(batchSamples);
+				droppedSamples += batchSamples;
+				failedAttempts = 0;
+			} else {
+				handleFailure();
+			}
+		}
+
+		//--------------------------------------------------------------------------------
+		// Processes a received line of the response (without CRLF).
+		void processLine() {
+			line[lineLength] = 0;
+
+			if (phase == STATUS_LINE) {
+				// Status line: HTTP/1.x code reason
+				if (!startsWithFString(line, F("http/1."))) {
+					handleFailure();
+					return;
+				}
+
+				const char* readPtr = line;
+				while ((*readPtr != ' ') && (*readPtr != 0)) {
+					readPtr++;
+				}
+
+				readPtr = skipSpaces(readPtr);
+				while (('0' <= *readPtr) && (*readPtr <= '9')) {
+					statusCode = statusCode * 10 + (*readPtr - '0');
+					readPtr++;
+				}
+
+				// HTTP/1.0 closes the connection by default
+				connectionClose = (line[7] == '0');
+				phase = HEADER_FIELDS;
+				return;
+			}
+
+			// End of header fields
+			if (lineLength == 0) {
+				if ((statusCode == 204) || (statusCode == 304)) {
+					remainingBodyBytes = 0;
+				}
+
+				if (remainingBodyBytes > 0) {
+					phase = BODY;
+				} else {
+					// A body of unknown length ends by closing the connection
+					if (remainingBodyBytes < 0) {
+						connectionClose = true;
+					}
+					completeRequest();
+				}
+				return;
+			}
+
+			if (startsWithFString(line, F("content-length:"))) {
+				const char* readPtr = skipSpaces(line + 15);
+				remainingBodyBytes = 0;
+				while (('0' <= *readPtr) && (*readPtr <= '9')) {
+					remainingBodyBytes = remainingBodyBytes * 10 + (*readPtr - '0');
+					readPtr++;
+				}
+			} else if (startsWithFString(line, F("connection:"))) {
+				const char* readPtr = skipSpaces(line + 11);
+				if (startsWithFString(readPtr, F("close"))) {
+					connectionClose = true;
+				} else if (startsWithFString(readPtr, F("keep-alive"))) {
+					connectionClose = false;
+				}
+			} else if (startsWithFString(line, F("transfer-encoding:"))) {
+				// Chunked body is not decoded, the connection is closed after the header
+				remainingBodyBytes = -1;
+			}
+		}
+
+		//--------------------------------------------------------------------------------
+		// Receives available bytes of the response.
+		void receiveResponse() {
+			while (phase != IDLE) {
+				if (client->available() <= 0) {
+					break;
+				}
+
+				// Skip the response body
+				if (phase == BODY) {
+					uint8_t discardBuffer[16];
+					const int length = (remainingBodyBytes < (long) sizeof(discardBuffer)) ? remainingBodyBytes : sizeof(discardBuffer);
+					const int readBytes = client->read(discardBuffer, length);
+					if (readBytes <= 0) {
+						break;
+					}
+
+					remainingBodyBytes -= readBytes;
+					if (remainingBodyBytes == 0) {
+						completeRequest();
+					}
+					continue;
+				}
+
+				const int c = client->read();
+				if (c < 0) {
+					break;
+				}
+
+				if (c == '\n') {
+					processLine();
+					lineLength = 0;
+				} else if ((c != '\r') && (lineLength < LINE_BUFFER_SIZE - 1)) {
+					line[lineLength++] = (('A' <= c) && (c <= 'Z')) ? c - 'A' + 'a' : c;
+				}
+			}
+
+			if (phase == IDLE) {
+				return;
+			}
+
+			// Check whether the connection was closed or the response timed out
+			if (!client->connected()) {
+				handleConnectionClosed();
+			} else if (millis() - requestTime > responseTimeout) {
+				handleFailure();
+			}
+		}
+	public:
+		//--------------------------------------------------------------------------------
+		// Initializes the controller.
+		void init(const __FlashStringHelper* host, uint16_t port, const __FlashStringHelper* path, unsigned long flushInterval,
+				unsigned long responseTimeout, unsigned long retryDelay, unsigned long maxRetryDelay, int maxAttempts) {
+			this->client = NULL;
+			this->host = host;
+			this->port = port;
+			this->path = path;
+			this->flushInterval = flushInterval;
+			this->responseTimeout = responseTimeout;
+			this->retryDelay = retryDelay;
+			this->maxRetryDelay = (maxRetryDelay < retryDelay) ? retryDelay : maxRetryDelay;
+			this->maxAttempts = constrain(maxAttempts, 0, 255);
+
+			firstSample = 0;
+			sampleCount = 0;
+			droppedSamples = 0;
+			deliveredSamples = 0;
+			phase = IDLE;
+			batchSamples = 0;
+			failedAttempts = 0;
+			flushRequested = false;
+			reusedConnection = false;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Stores a sample. If the ring buffer is full, the oldest sample is dropped.
+		void addSample(const __FlashStringHelper* name, double value) {
+			if (sampleCount == SAMPLE_CAPACITY) {
+				removeSamples(1);
+				droppedSamples++;
+
+				// The dropped sample belongs to the batch waiting for a response
+				if (batchSamples > 0) {
+					batchSamples--;
+				}
+			}
+
+			TelemetrySample& sample = samples[(firstSample + sampleCount) % SAMPLE_CAPACITY];
+			sample.name = name;
+			sample.value = value;
+			sample.time = millis();
+			sampleCount++;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Looper that sends batches and receives responses.
+		void telemetryLooper() {
+			if (client == NULL) {
+				return;
+			}
+
+			if (phase != IDLE) {
+				receiveResponse();
+				return;
+			}
+
+			if (!isBatchDue(millis())) {
+				return;
+			}
+
+			batchSamples = 0;
+			if (!sendBatch()) {
+				handleFailure();
+			}
+		}
+	};
+
+	/********************************************************************************
+	 * Http telemetry client (view)
+	 ********************************************************************************/
+	template<int SAMPLE_CAPACITY, int BATCH_SIZE> class THttpTelemetryClient {
+	private:
+		// The controller
+		HttpTelemetryController<SAMPLE_CAPACITY, BATCH_SIZE> &controller;
+	public:
+		//--------------------------------------------------------------------------------
+		// Constructs view for the telemetry client.
+		THttpTelemetryClient(HttpTelemetryController<SAMPLE_CAPACITY, BATCH_SIZE> &controller) :
+				controller(controller) {
+			// Nothing to do
+		}
+
+		//--------------------------------------------------------------------------------
+		// Sets the client (e.g., EthernetClient) used to connect the collector.
+		void setClient(Client* client) {
+			if (controller.client == client) {
+				return;
+			}
+
+			if (controller.client != NULL) {
+				controller.client->stop();
+			}
+
+			controller.client = client;
+			controller.phase = HttpTelemetryController<SAMPLE_CAPACITY, BATCH_SIZE>::IDLE;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Stores a sample that is pushed with the next batch. A pointer to a name stored
+		// in flash memory is required.
+		inline void addSample(const __FlashStringHelper* name, double value) {
+			controller.addSample(name, value);
+		}
+
+		//--------------------------------------------------------------------------------
+		// Requests sending of all stored samples without waiting for a full batch.
+		inline void flush() {
+			controller.flushRequested = true;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns the number of samples waiting to be pushed.
+		inline int getPendingSamples() {
+			return controller.sampleCount;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns the number of samples dropped due to a full buffer or a rejected batch.
+		inline unsigned long getDroppedSamples() {
+			return controller.droppedSamples;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns the number of samples delivered to the collector.
+		inline unsigned long getDeliveredSamples() {
+			return controller.deliveredSamples;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns whether the last attempt to push a batch succeeded.
+		inline bool isLinkUp() {
+			return controller.failedAttempts == 0;
+		}
+	};
+}
+
+#endif /* MODULES_ACP_NETWORK_HTTP_TELEMETRY_CLIENT_INCLUDE_HTTPTELEMETRYCLIENT_H_ */
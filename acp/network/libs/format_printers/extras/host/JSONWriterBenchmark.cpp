@@ -0,0 +1,139 @@
+/********************************************************************************
+ * Benchmark of JSONWriter. It compares a flat object written by JSONMapPrinter
+ * and JSONWriter and an array of integers printed item by item and written by
+ * JSONWriter::array(). For each document, it reports the time, the size and
+ * the number of write calls of the output (each call is a packet or an SPI
+ * transfer on an Ethernet shield, unless the output is buffered).
+ ********************************************************************************/
+
+#include <acp/network/libs/format_printers/FormatPrinters.h>
+#include <HostCore.h>
+#include <limits.h>
+#include <stdio.h>
+
+using namespace acp_network_libs_format_printers;
+
+/********************************************************************************
+ * Print that only counts written bytes and write calls.
+ ********************************************************************************/
+class CountingPrint: public Print {
+public:
+	unsigned long bytes;
+	unsigned long calls;
+
+	CountingPrint() :
+			bytes(0), calls(0) {
+	}
+
+	size_t write(uint8_t) {
+		bytes++;
+		calls++;
+		return 1;
+	}
+
+	size_t write(const uint8_t*, size_t size) {
+		bytes += size;
+		calls++;
+		return size;
+	}
+
+	using Print::write;
+};
+
+// Number of generated documents of each case
+static const long DOCUMENTS = 200000;
+
+static char keys[8][8];
+static int samples[32];
+static long longSamples[32];
+
+//--------------------------------------------------------------------------------
+// Prints a measured case.
+static void report(const char* name, uint64_t start, CountingPrint& output) {
+	printf("%-30s %10.1f %10lu %10lu\n", name, (double) (hostNanos() - start) / DOCUMENTS,
+			output.bytes / DOCUMENTS, output.calls / DOCUMENTS);
+}
+
+int main() {
+	for (int i = 0; i < 8; i++) {
+		snprintf(keys[i], sizeof(keys[i]), "sensor%d", i);
+	}
+
+	for (int i = 0; i < 32; i++) {
+		samples[i] = i * 37 - 500;
+		longSamples[i] = (i % 2 == 0) ? LONG_MIN + i : LONG_MAX - i;
+	}
+
+	printf("%-30s %10s %10s %10s\n", "document", "ns", "bytes", "writes");
+
+	{
+		CountingPrint output;
+		const uint64_t start = hostNanos();
+		for (long k = 0; k < DOCUMENTS; k++) {
+			JSONMapPrinter printer(output);
+			for (int i = 0; i < 8; i++) {
+				printer.add(keys[i], samples[i]);
+			}
+		}
+		report("flat object JSONMapPrinter", start, output);
+	}
+
+	{
+		CountingPrint output;
+		const uint64_t start = hostNanos();
+		for (long k = 0; k < DOCUMENTS; k++) {
+			JSONWriter writer(output);
+			writer.beginObject();
+			for (int i = 0; i < 8; i++) {
+				writer.add(keys[i], samples[i]);
+			}
+			writer.end();
+			output.println();
+		}
+		report("flat object JSONWriter", start, output);
+	}
+
+	{
+		CountingPrint output;
+		const uint64_t start = hostNanos();
+		for (long k = 0; k < DOCUMENTS; k++) {
+			output.print(F("{\"samples\":["));
+			for (int i = 0; i < 32; i++) {
+				if (i > 0) {
+					output.print(',');
+				}
+				output.print(samples[i]);
+			}
+			output.print(F("]}"));
+		}
+		report("int array printed by items", start, output);
+	}
+
+	{
+		CountingPrint output;
+		const uint64_t start = hostNanos();
+		for (long k = 0; k < DOCUMENTS; k++) {
+			JSONWriter writer(output);
+			writer.beginObject();
+			writer.key(F("samples"));
+			writer.array(samples, 32);
+			writer.end();
+		}
+		report("int array JSONWriter", start, output);
+	}
+
+	{
+		CountingPrint output;
+		const uint64_t start = hostNanos();
+		for (long k = 0; k < DOCUMENTS; k++) {
+			JSONWriter writer(output);
+			writer.beginObject();
+			writer.key(F("samples"));
+			writer.array(longSamples, 32);
+			writer.end();
+		}
+		report("extreme long array JSONWriter", start, output);
+	}
+
+	return 0;
+}
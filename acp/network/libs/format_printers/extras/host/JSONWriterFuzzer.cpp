@@ -0,0 +1,604 @@
+/********************************************************************************
+ * Fuzz target for JSONWriter.
+ *
+ * If the first input byte is below 0x80, it selects the type of array items
+ * (uint8_t, int, unsigned int, long or unsigned long) and the rest of input is
+ * split into the items. The written array must be equal to the array formatted
+ * by snprintf.
+ *
+ * Otherwise, each of the following input bytes is a call of the writer (begin,
+ * key, value, end, close, array or a run of nested arrays, with an argument
+ * selected by the upper bits),
+ * including invalid sequences, nesting beyond MAX_DEPTH and a second value at
+ * the top level. The target checks:
+ * - isValid() agrees with a reference model of valid call sequences,
+ * - after close(), the output of a valid sequence is a single JSON value (or
+ *   empty, if no value was written),
+ * - the output of an invalid sequence is a prefix of a JSON value (the output
+ *   is stopped at the first invalid call).
+ ********************************************************************************/
+
+#include <acp/network/libs/format_printers/FormatPrinters.h>
+#include <ctype.h>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+
+using namespace acp_network_libs_format_printers;
+
+// Maximal number of array items
+#define MAX_ITEMS 64
+
+// Size of the output buffer (enough for the longest call sequence)
+#define OUTPUT_SIZE 32768
+
+/********************************************************************************
+ * Print that collects written data.
+ ********************************************************************************/
+class BufferPrint: public Print {
+public:
+	char data[OUTPUT_SIZE];
+	size_t length;
+
+	BufferPrint() :
+			length(0) {
+	}
+
+	size_t write(uint8_t c) {
+		if (length + 1 >= sizeof(data)) {
+			fprintf(stderr, "Output overflow\n");
+			abort();
+		}
+
+		data[length++] = c;
+		data[length] = 0;
+		return 1;
+	}
+
+	using Print::write;
+};
+
+//--------------------------------------------------------------------------------
+// Writes items of given type decoded from input and compares the output with
+// the reference output.
+template<typename T> static void check(const uint8_t* data, size_t size, const char* format) {
+	T values[MAX_ITEMS];
+	int count = 0;
+	while ((count < MAX_ITEMS) && (size >= sizeof(T))) {
+		memcpy(&values[count++], data, sizeof(T));
+		data += sizeof(T);
+		size -= sizeof(T);
+	}
+
+	BufferPrint output;
+	JSONWriter writer(output);
+	writer.array(values, count);
+	writer.close();
+
+	char expected[sizeof(output.data)];
+	size_t length = snprintf(expected, sizeof(expected), "[");
+	for (int i = 0; i < count; i++) {
+		if (i > 0) {
+			length += snprintf(expected + length, sizeof(expected) - length, ",");
+		}
+		length += snprintf(expected + length, sizeof(expected) - length, format, values[i]);
+	}
+	snprintf(expected + length, sizeof(expected) - length, "]");
+
+	if (!writer.isValid() || (strcmp(output.data, expected) != 0)) {
+		fprintf(stderr, "Array written as %s instead of %s\n", output.data, expected);
+		abort();
+	}
+}
+
+/********************************************************************************
+ * Strict JSON parser (RFC 8259) that checks the written output.
+ ********************************************************************************/
+class JSONChecker {
+public:
+	// Results of parsing
+	enum Result {
+		COMPLETE, TRUNCATED, MALFORMED
+	};
+private:
+	// Parsed text
+	const char* text;
+
+	// Position of the next character
+	const char* position;
+
+	//--------------------------------------------------------------------------------
+	// Returns whether the text ends at the current position.
+	inline bool atEnd() {
+		return *position == 0;
+	}
+
+	//--------------------------------------------------------------------------------
+	// Parses an expected sequence of characters.
+	Result parseLiteral(const char* literal) {
+		while (*literal != 0) {
+			if (atEnd()) {
+				return TRUNCATED;
+			}
+
+			if (*position != *literal) {
+				return MALFORMED;
+			}
+
+			position++;
+			literal++;
+		}
+
+		return COMPLETE;
+	}
+
+	//--------------------------------------------------------------------------------
+	// Parses a run of decimal digits (at least one).
+	Result parseDigits() {
+		if (atEnd()) {
+			return TRUNCATED;
+		}
+
+		if ((*position < '0') || (*position > '9')) {
+			return MALFORMED;
+		}
+
+		while (('0' <= *position) && (*position <= '9')) {
+			position++;
+		}
+
+		return COMPLETE;
+	}
+
+	//--------------------------------------------------------------------------------
+	// Parses a number.
+	Result parseNumber() {
+		if (*position == '-') {
+			position++;
+		}
+
+		if (*position == '0') {
+			position++;
+		} else {
+			const Result result = parseDigits();
+			if (result != COMPLETE) {
+				return result;
+			}
+		}
+
+		if (*position == '.') {
+			position++;
+			const Result result = parseDigits();
+			if (result != COMPLETE) {
+				return result;
+			}
+		}
+
+		if ((*position == 'e') || (*position == 'E')) {
+			position++;
+			if ((*position == '+') || (*position == '-')) {
+				position++;
+			}
+
+			const Result result = parseDigits();
+			if (result != COMPLETE) {
+				return result;
+			}
+		}
+
+		return COMPLETE;
+	}
+
+	//--------------------------------------------------------------------------------
+	// Parses a string.
+	Result parseString() {
+		position++;
+		while (true) {
+			if (atEnd()) {
+				return TRUNCATED;
+			}
+
+			const char c = *position++;
+			if (c == '"') {
+				return COMPLETE;
+			}
+
+			if ((uint8_t) c < ' ') {
+				return MALFORMED;
+			}
+
+			if (c != '\\') {
+				continue;
+			}
+
+			if (atEnd()) {
+				return TRUNCATED;
+			}
+
+			const char escaped = *position++;
+			if (escaped == 'u') {
+				for (int i = 0; i < 4; i++) {
+					if (atEnd()) {
+						return TRUNCATED;
+					}
+
+					if (!isxdigit(*position++)) {
+						return MALFORMED;
+					}
+				}
+			} else if (strchr("\"\\/bfnrt", escaped) == NULL) {
+				return MALFORMED;
+			}
+		}
+	}
+
+	//--------------------------------------------------------------------------------
+	// Parses items of an object or array after the opening bracket.
+	Result parseItems(bool object) {
+		position++;
+		const char closing = object ? '}' : ']';
+		if (atEnd()) {
+			return TRUNCATED;
+		}
+
+		if (*position == closing) {
+			position++;
+			return COMPLETE;
+		}
+
+		while (true) {
+			if (object) {
+				if (atEnd()) {
+					return TRUNCATED;
+				}
+
+				if (*position != '"') {
+					return MALFORMED;
+				}
+
+				Result result = parseString();
+				if (result == COMPLETE) {
+					result = parseLiteral(":");
+				}
+
+				if (result != COMPLETE) {
+					return result;
+				}
+			}
+
+			const Result result = parseValue();
+			if (result != COMPLETE) {
+				return result;
+			}
+
+			if (atEnd()) {
+				return TRUNCATED;
+			}
+
+			const char c = *position++;
+			if (c == closing) {
+				return COMPLETE;
+			}
+
+			if (c != ',') {
+				return MALFORMED;
+			}
+		}
+	}
+
+public:
+	JSONChecker(const char* text) :
+			text(text), position(text) {
+	}
+
+	//--------------------------------------------------------------------------------
+	// Parses a value.
+	Result parseValue() {
+		if (atEnd()) {
+			return TRUNCATED;
+		}
+
+		switch (*position) {
+		case '{':
+			return parseItems(true);
+		case '[':
+			return parseItems(false);
+		case '"':
+			return parseString();
+		case 't':
+			return parseLiteral("true");
+		case 'f':
+			return parseLiteral("false");
+		case 'n':
+			return parseLiteral("null");
+		default:
+			if ((*position == '-') || (('0' <= *position) && (*position <= '9'))) {
+				return parseNumber();
+			}
+			return MALFORMED;
+		}
+	}
+
+	//--------------------------------------------------------------------------------
+	// Parses the whole text as a single value.
+	Result parse() {
+		const Result result = parseValue();
+		if ((result == COMPLETE) && !atEnd()) {
+			return MALFORMED;
+		}
+
+		return result;
+	}
+
+	//--------------------------------------------------------------------------------
+	// Returns the position of the first character that was not parsed.
+	inline size_t getPosition() {
+		return position - text;
+	}
+};
+
+/********************************************************************************
+ * Reference model of valid call sequences of JSONWriter.
+ ********************************************************************************/
+class JSONWriterModel {
+private:
+	// Kinds of open levels (true for arrays)
+	bool arrays[JSONWriter::MAX_DEPTH];
+	int depth;
+
+	// Indicates whether a key waits for its value
+	bool keyWritten;
+
+	// Indicates whether a value at the top level was written
+	bool rootWritten;
+
+	// Indicates whether the sequence is invalid
+	bool invalid;
+
+	//--------------------------------------------------------------------------------
+	// Returns whether a value is allowed and marks it as written.
+	bool openValue() {
+		if (depth == 0) {
+			if (rootWritten) {
+				return false;
+			}
+
+			rootWritten = true;
+			return true;
+		}
+
+		if (arrays[depth - 1]) {
+			return true;
+		}
+
+		const bool allowed = keyWritten;
+		keyWritten = false;
+		return allowed;
+	}
+
+public:
+	JSONWriterModel() :
+			depth(0), keyWritten(false), rootWritten(false), invalid(false) {
+	}
+
+	void value() {
+		invalid = invalid || !openValue();
+	}
+
+	void begin(bool array) {
+		if (invalid || (depth == JSONWriter::MAX_DEPTH) || !openValue()) {
+			invalid = true;
+			return;
+		}
+
+		arrays[depth++] = array;
+	}
+
+	void key() {
+		if (invalid || (depth == 0) || arrays[depth - 1] || keyWritten) {
+			invalid = true;
+			return;
+		}
+
+		keyWritten = true;
+	}
+
+	void end() {
+		if (invalid || (depth == 0) || keyWritten) {
+			invalid = true;
+			return;
+		}
+
+		depth--;
+	}
+
+	void close() {
+		while ((depth > 0) && !invalid) {
+			end();
+		}
+	}
+
+	//--------------------------------------------------------------------------------
+	// Returns whether the sequence is valid.
+	inline bool isValid() {
+		return !invalid;
+	}
+
+	//--------------------------------------------------------------------------------
+	// Returns whether a value at the top level was written.
+	inline bool isRootWritten() {
+		return rootWritten;
+	}
+};
+
+// Strings written as keys and values (with characters that require escaping)
+static const char* const strings[] = { "", "name", "quote\"", "back\\slash", "line\nbreak\r\t", "\x01\x1F control",
+		"utf-8 \xC5\xBE\xC3\xA1\xC4\x8D", "\x7F delete", "/slash/", "{[\":,]}" };
+
+// Real numbers written as values (some of them are written as null)
+static const double reals[] = { 0, -1.5, 21.25, 1e9, 5e9, -5e9, NAN, INFINITY, -INFINITY, 1e-7, -0.001 };
+
+//--------------------------------------------------------------------------------
+// Writes a sequence of calls decoded from input and checks the output.
+static void checkSequence(const uint8_t* data, size_t size) {
+	BufferPrint output;
+	JSONWriter writer(output);
+	JSONWriterModel model;
+	static const long longs[] = { 0, 1, -1, LONG_MIN, LONG_MAX, 1234567 };
+	static const int ints[] = { 0, -7, INT_MIN, INT_MAX };
+
+	for (size_t i = 0; i < size; i++) {
+		const uint8_t argument = data[i] >> 4;
+		const char* str = strings[argument % (sizeof(strings) / sizeof(strings[0]))];
+		switch (data[i] & 0x0F) {
+		case 0:
+			writer.beginObject();
+			model.begin(false);
+			break;
+		case 1:
+			writer.beginArray();
+			model.begin(true);
+			break;
+		case 2:
+			writer.beginObject(str);
+			model.key();
+			model.begin(false);
+			break;
+		case 3:
+			writer.beginArray(F("array"));
+			model.key();
+			model.begin(true);
+			break;
+		case 4:
+			writer.end();
+			model.end();
+			break;
+		case 5:
+			// Deep nesting (reaches MAX_DEPTH in a few calls)
+			for (int level = 0; level <= argument; level++) {
+				writer.beginArray();
+				model.begin(true);
+			}
+			break;
+		case 6:
+			writer.key(str);
+			model.key();
+			break;
+		case 7:
+			writer.key(F("key\t\"flash\""));
+			model.key();
+			break;
+		case 8:
+			writer.value(str);
+			model.value();
+			break;
+		case 9:
+			if (argument % 3 == 0) {
+				writer.value((const char*) NULL);
+			} else if (argument % 3 == 1) {
+				writer.value(F("flash \\ value\n"));
+			} else {
+				writer.nullValue();
+			}
+			model.value();
+			break;
+		case 10:
+			if (argument & 0x08) {
+				writer.value((unsigned long) longs[argument % 6]);
+			} else {
+				writer.value(longs[argument % 6]);
+			}
+			model.value();
+			break;
+		case 11:
+			if (argument & 0x08) {
+				writer.value((unsigned int) ints[argument % 4]);
+			} else {
+				writer.value(ints[argument % 4]);
+			}
+			model.value();
+			break;
+		case 12:
+			writer.value(reals[argument % (sizeof(reals) / sizeof(reals[0]))], argument % 4);
+			model.value();
+			break;
+		case 13:
+			writer.value((argument & 0x01) != 0);
+			model.value();
+			break;
+		case 14:
+			if (argument & 0x08) {
+				writer.array(reals, argument % 8, argument % 3);
+			} else {
+				writer.array(longs, argument % 7);
+			}
+			model.value();
+			break;
+		default:
+			writer.close();
+			model.close();
+		}
+
+		if (writer.isValid() != model.isValid()) {
+			fprintf(stderr, "Writer is %s after call %u, expected %s\n", writer.isValid() ? "valid" : "invalid", (unsigned) i,
+					model.isValid() ? "valid" : "invalid");
+			abort();
+		}
+	}
+
+	writer.close();
+	model.close();
+	if (writer.isValid() != model.isValid()) {
+		fprintf(stderr, "Writer is %s after close, expected %s\n", writer.isValid() ? "valid" : "invalid", model.isValid() ? "valid" : "invalid");
+		abort();
+	}
+
+	JSONChecker checker(output.data);
+	const JSONChecker::Result result = checker.parse();
+	bool correct;
+	if (writer.isValid()) {
+		correct = model.isRootWritten() ? (result == JSONChecker::COMPLETE) : (output.length == 0);
+	} else {
+		correct = (result != JSONChecker::MALFORMED) || (output.length == 0);
+	}
+
+	if (!correct) {
+		fprintf(stderr, "Output of %s sequence is not %s JSON (at %u): %s\n", writer.isValid() ? "valid" : "invalid",
+				writer.isValid() ? "complete" : "a prefix of", (unsigned) checker.getPosition(), output.data);
+		abort();
+	}
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+	if (size < 1) {
+		return 0;
+	}
+
+	if (data[0] >= 0x80) {
+		checkSequence(data + 1, size - 1);
+		return 0;
+	}
+
+	const uint8_t type = data[0] % 5;
+	data++;
+	size--;
+
+	switch (type) {
+	case 0:
+		check<uint8_t>(data, size, "%u");
+		break;
+	case 1:
+		check<int>(data, size, "%d");
+		break;
+	case 2:
+		check<unsigned int>(data, size, "%u");
+		break;
+	case 3:
+		check<long>(data, size, "%ld");
+		break;
+	default:
+		check<unsigned long>(data, size, "%lu");
+	}
+
+	return 0;
+}
@@ -2,6 +2,8 @@
 #define MODULES_ACP_NETWORK_LIBS_FORMAT_PRINTERS_INCLUDE_FORMATPRINTERS_H_
 
 #include <acp/core.h>
+#include <acp/utils/buffer_pool/BufferPool.h>
+#include <limits.h>
 
 namespace acp_network_libs_format_printers {
 
@@ -71,6 +73,226 @@ namespace acp_network_libs_format_printers {
 		void close();
 	};
 
+	/********************************************************************************
+	 * Streaming JSON writer for generating nested objects and arrays. Nesting is
+	 * tracked in a fixed-depth state stack, so that separators and closing brackets
+	 * are always generated correctly. An invalid sequence of calls (e.g. a value in
+	 * an object without a key or too deep nesting) stops the output.
+	 ********************************************************************************/
+	class JSONWriter {
+	public:
+		// Maximal depth of nested objects and arrays
+		static const uint8_t MAX_DEPTH = 16;
+	private:
+		// Output
+		Print* out;
+
+		// Current depth of nested objects and arrays
+		uint8_t depth;
+
+		// Indicates state of writer
+		// bit 0 - key has been written, the value is expected
+		// bit 1 - value at the top level has been written
+		// bit 2 - invalid sequence of calls, the output is stopped
+		uint8_t state;
+
+		// Bits of levels that are arrays (bit i corresponds to depth i+1)
+		uint16_t arrayLevels;
+
+		// Bits of levels that contain at least one item
+		uint16_t nonEmptyLevels;
+
+		//--------------------------------------------------------------------------------
+		// Opens printing of a value and returns whether the opening succeeded.
+		bool openValue();
+
+		//--------------------------------------------------------------------------------
+		// Opens printing of a key and returns whether the opening succeeded.
+		bool openKey();
+
+		//--------------------------------------------------------------------------------
+		// Opens a nested object or array.
+		void begin(bool array);
+
+		//--------------------------------------------------------------------------------
+		// Stops the output due to an invalid sequence of calls.
+		void fail();
+
+		//--------------------------------------------------------------------------------
+		// Prints an escaped string (assumes valid output).
+		void printEscapedString(const char* str);
+
+		//--------------------------------------------------------------------------------
+		// Prints an escaped string (assumes valid output).
+		void printEscapedString(const __FlashStringHelper* fstr);
+
+		//--------------------------------------------------------------------------------
+		// Prints an escaped character (assumes valid output).
+		void printEscapedChar(char c);
+
+		//--------------------------------------------------------------------------------
+		// Prints a real number (assumes valid output).
+		void printNumber(double value, int digits);
+
+		//--------------------------------------------------------------------------------
+		// Formats an integer in decimal notation so that it ends before given position and
+		// returns the position of the first character.
+		static char* formatInteger(char* end, unsigned long magnitude, bool negative);
+
+		static inline char* formatInteger(char* end, long value) {
+			return formatInteger(end, (value < 0) ? 0UL - (unsigned long) value : (unsigned long) value, value < 0);
+		}
+
+		static inline char* formatInteger(char* end, unsigned long value) {
+			return formatInteger(end, value, false);
+		}
+
+		static inline char* formatInteger(char* end, int value) {
+			return formatInteger(end, (long) value);
+		}
+
+		static inline char* formatInteger(char* end, unsigned int value) {
+			return formatInteger(end, (unsigned long) value);
+		}
+
+		static inline char* formatInteger(char* end, uint8_t value) {
+			return formatInteger(end, (unsigned long) value);
+		}
+
+		//--------------------------------------------------------------------------------
+		// Prints an array of integers as a value. Numbers are formatted into a block that
+		// is written at once when full.
+		template<typename T> void printArray(const T* values, int count) {
+			if (!openValue()) {
+				return;
+			}
+
+			char block[32];
+			block[0] = '[';
+			int blockLength = 1;
+			for (int i = 0; i < count; i++) {
+				// Separator, sign and digits of the longest number (log10(2) < 10/33)
+				char number[sizeof(unsigned long) * CHAR_BIT * 10 / 33 + 3];
+				char* end = number + sizeof(number);
+				char* start = formatInteger(end, values[i]);
+				if (i > 0) {
+					start--;
+					*start = ',';
+				}
+
+				const int length = end - start;
+				if (blockLength + length > (int) sizeof(block)) {
+					out->write((const uint8_t*) block, blockLength);
+					blockLength = 0;
+				}
+
+				memcpy(block + blockLength, start, length);
+				blockLength += length;
+			}
+
+			out->write((const uint8_t*) block, blockLength);
+			out->print(']');
+		}
+
+		//--------------------------------------------------------------------------------
+		// Prints an array of real numbers as a value.
+		template<typename T> void printRealArray(const T* values, int count, int digits) {
+			if (!openValue()) {
+				return;
+			}
+
+			out->print('[');
+			for (int i = 0; i < count; i++) {
+				if (i > 0) {
+					out->print(',');
+				}
+				printNumber((double) values[i], digits);
+			}
+			out->print(']');
+		}
+	public:
+		//--------------------------------------------------------------------------------
+		// Construct a writer that generates output to given Print object.
+		JSONWriter(Print* print);
+
+		//--------------------------------------------------------------------------------
+		// Construct a writer that generates output to given Print object.
+		JSONWriter(Print& print): JSONWriter(&print) {}
+
+		//--------------------------------------------------------------------------------
+		// Destructs the writer (and closes all open objects and arrays)
+		~JSONWriter();
+
+		//--------------------------------------------------------------------------------
+		// Starts a nested object (a value of an array, a value of a key or the top level value).
+		void beginObject();
+
+		//--------------------------------------------------------------------------------
+		// Starts a nested array (a value of an array, a value of a key or the top level value).
+		void beginArray();
+
+		//--------------------------------------------------------------------------------
+		// Starts a nested object or array as a value of given key.
+		template<typename KEY> void beginObject(KEY key) {
+			this->key(key);
+			beginObject();
+		}
+
+		template<typename KEY> void beginArray(KEY key) {
+			this->key(key);
+			beginArray();
+		}
+
+		//--------------------------------------------------------------------------------
+		// Ends the innermost object or array.
+		void end();
+
+		//--------------------------------------------------------------------------------
+		// Writes a key of the next value in an object.
+		void key(const char* key);
+		void key(const __FlashStringHelper* key);
+
+		//--------------------------------------------------------------------------------
+		// Writes a value.
+		void value(const char* value);
+		void value(const __FlashStringHelper* value);
+		void value(int value);
+		void value(unsigned int value);
+		void value(long value);
+		void value(unsigned long value);
+		void value(double value, int digits = 2);
+		void value(bool value);
+		void nullValue();
+
+		//--------------------------------------------------------------------------------
+		// Writes an array of numbers as a value. Real numbers are printed with given
+		// number of decimal digits (values that cannot be printed are written as null).
+		void array(const uint8_t* values, int count);
+		void array(const int* values, int count);
+		void array(const unsigned int* values, int count);
+		void array(const long* values, int count);
+		void array(const unsigned long* values, int count);
+		void array(const float* values, int count, int digits = 2);
+		void array(const double* values, int count, int digits = 2);
+
+		//--------------------------------------------------------------------------------
+		// Writes a key-value pair in an object.
+		template<typename KEY, typename VALUE> void add(KEY key, VALUE value) {
+			this->key(key);
+			this->value(value);
+		}
+
+		//--------------------------------------------------------------------------------
+		// Closes all open objects and arrays.
+		void close();
+
+		//--------------------------------------------------------------------------------
+		// Returns whether the sequence of calls was valid (the output was not stopped).
+		inline bool isValid() {
+			return (state & B00000100) == 0;
+		}
+	};
+
 	/********************************************************************************
 	 * XML format printer for generating an object with key-value pairs.
 	 ********************************************************************************/
@@ -147,37 +369,74 @@ namespace acp_network_libs_format_printers {
 	};
 
 	/********************************************************************************
-	 * Printer printing data from a stream
+	 * Print object that coalesces small writes in a buffer and writes them to the
+	 * output in large blocks.
 	 ********************************************************************************/
-	template<int BUFFER_SIZE> class StreamPrinter {
+	class BufferedPrint: public Print {
 	private:
 		// Output
 		Print* out;
+
+		// Buffer for coalescing written bytes
+		uint8_t* buffer;
+
+		// Size of the buffer
+		int bufferSize;
+
+		// Number of bytes stored in the buffer
+		int bufferedBytes;
 	public:
 		//--------------------------------------------------------------------------------
-		// Construct a stream printer that generates output to given Print object.
-		StreamPrinter(Print* print) {
-			out = print;
-		}
+		// Constructs a buffered print that writes to given Print object using given buffer.
+		// If the size of buffer is not positive, all writes are passed to the output.
+		BufferedPrint(Print* print, uint8_t* buffer, int bufferSize);
 
 		//--------------------------------------------------------------------------------
-		// Construct a stream printer that generates output to given Print object.
-		StreamPrinter(Print &print): StreamPrinter(&print) {}
+		// Destructs the buffered print (and writes all buffered bytes).
+		~BufferedPrint();
 
 		//--------------------------------------------------------------------------------
-		// Prints all available bytes in the stream to the output.
-		inline void printAvailable(Stream& stream) {
-			printAvailable(&stream);
+		// Writes a byte.
+		virtual size_t write(uint8_t data);
+
+		//--------------------------------------------------------------------------------
+		// Writes a block of bytes.
+		virtual size_t write(const uint8_t* data, size_t size);
+
+		//--------------------------------------------------------------------------------
+		// Writes all buffered bytes to the output.
+		virtual void flush();
+
+		//--------------------------------------------------------------------------------
+		// Returns the output.
+		inline Print* getOutput() {
+			return out;
 		}
 
 		//--------------------------------------------------------------------------------
-		// Prints all available bytes in the stream to the output.
-		void printAvailable(Stream* stream) {
-			if (stream == NULL) {
-				return;
-			}
+		// Writes all buffered bytes and redirects further bytes to given output.
+		inline void setOutput(Print* print) {
+			flush();
+			out = print;
+		}
 
-			uint8_t buffer[BUFFER_SIZE];
+		using Print::write;
+	};
+
+	/********************************************************************************
+	 * Printer printing data from a stream
+	 ********************************************************************************/
+	template<int BUFFER_SIZE> class StreamPrinter {
+	private:
+		// Output
+		Print* out;
+
+		// Pool for leasing the buffer (NULL, if the buffer is allocated on the stack)
+		acp_utils_buffer_pool::BufferPool* pool;
+
+		//--------------------------------------------------------------------------------
+		// Prints all available bytes in the stream to the output using given buffer.
+		void copyAvailable(Stream* stream, uint8_t* buffer) {
 			while (true) {
 				int availableBytes = stream->available();
 				if (availableBytes <= 0) {
@@ -196,6 +455,50 @@ namespace acp_network_libs_format_printers {
 				out->write(buffer, availableBytes);
 			}
 		}
+
+		//--------------------------------------------------------------------------------
+		// Prints all available bytes in the stream to the output using a buffer on the stack.
+		void copyAvailableWithStackBuffer(Stream* stream) {
+			uint8_t buffer[BUFFER_SIZE];
+			copyAvailable(stream, buffer);
+		}
+	public:
+		//--------------------------------------------------------------------------------
+		// Construct a stream printer that generates output to given Print object. If
+		// a pool is given, the buffer is leased from the pool.
+		StreamPrinter(Print* print, acp_utils_buffer_pool::BufferPool* pool = NULL) {
+			out = print;
+			this->pool = pool;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Construct a stream printer that generates output to given Print object.
+		StreamPrinter(Print &print, acp_utils_buffer_pool::BufferPool* pool = NULL): StreamPrinter(&print, pool) {}
+
+		//--------------------------------------------------------------------------------
+		// Prints all available bytes in the stream to the output.
+		inline void printAvailable(Stream& stream) {
+			printAvailable(&stream);
+		}
+
+		//--------------------------------------------------------------------------------
+		// Prints all available bytes in the stream to the output.
+		void printAvailable(Stream* stream) {
+			if (stream == NULL) {
+				return;
+			}
+
+			if (pool != NULL) {
+				acp_utils_buffer_pool::BufferLease lease(pool, BUFFER_SIZE);
+				if (lease.get() != NULL) {
+					copyAvailable(stream, lease.get());
+					return;
+				}
+			}
+
+			// Without a pooled buffer, the buffer is allocated on the stack
+			copyAvailableWithStackBuffer(stream);
+		}
 	};
 
 }
@@ -40,9 +40,9 @@ bool JSONMapPrinter::openPair() {
 //--------------------------------------------------------------------------------
 // Prints characters in \uxxxx notation (assumes valid output).
 void JSONMapPrinter::printUEscapedChar(char c) {
-	int code = (int) c;
+	int code = (uint8_t) c;
 	byte hexDigits[4];
-	for (int i = 3; i >= 0; i++) {
+	for (int i = 3; i >= 0; i--) {
 		hexDigits[i] = code % 16;
 		code = code / 16;
 	}
@@ -321,6 +321,428 @@ void JSONMapPrinter::add(const __FlashStringHelper* key, bool value) {
 	out->print(value ? F("true") : F("false"));
 }
 
+/********************************************************************************
+ * Streaming JSON writer for generating nested objects and arrays.
+ ********************************************************************************/
+
+//--------------------------------------------------------------------------------
+// Construct a writer that generates output to given Print object.
+JSONWriter::JSONWriter(Print* print) :
+		out(print), depth(0), state(0), arrayLevels(0), nonEmptyLevels(0) {
+	// Nothing to do
+}
+
+//--------------------------------------------------------------------------------
+// Destructs the writer (and closes all open objects and arrays)
+JSONWriter::~JSONWriter() {
+	close();
+}
+
+//--------------------------------------------------------------------------------
+// Stops the output due to an invalid sequence of calls.
+void JSONWriter::fail() {
+	state |= B00000100;
+}
+
+//--------------------------------------------------------------------------------
+// Opens printing of a value and returns whether the opening succeeded.
+bool JSONWriter::openValue() {
+	if ((out == NULL) || ((state & B00000100) != 0)) {
+		return false;
+	}
+
+	// Only a single value is allowed at the top level
+	if (depth == 0) {
+		if ((state & B00000010) != 0) {
+			fail();
+			return false;
+		}
+
+		state |= B00000010;
+		return true;
+	}
+
+	const uint16_t levelBit = 1 << (depth - 1);
+	if ((arrayLevels & levelBit) == 0) {
+		// Value in an object requires a key
+		if ((state & B00000001) == 0) {
+			fail();
+			return false;
+		}
+
+		state &= ~B00000001;
+		return true;
+	}
+
+	if ((nonEmptyLevels & levelBit) != 0) {
+		out->print(',');
+	}
+
+	nonEmptyLevels |= levelBit;
+	return true;
+}
+
+//--------------------------------------------------------------------------------
+// Opens printing of a key and returns whether the opening succeeded.
+bool JSONWriter::openKey() {
+	if ((out == NULL) || ((state & B00000100) != 0)) {
+		return false;
+	}
+
+	// Key is allowed only in an object that does not wait for a value
+	const uint16_t levelBit = (depth > 0) ? 1 << (depth - 1) : 0;
+	if ((depth == 0) || ((arrayLevels & levelBit) != 0) || ((state & B00000001) != 0)) {
+		fail();
+		return false;
+	}
+
+	if ((nonEmptyLevels & levelBit) != 0) {
+		out->print(',');
+	}
+
+	nonEmptyLevels |= levelBit;
+	state |= B00000001;
+	return true;
+}
+
+//--------------------------------------------------------------------------------
+// Opens a nested object or array.
+void JSONWriter::begin(bool array) {
+	if (depth >= MAX_DEPTH) {
+		fail();
+		return;
+	}
+
+	if (!openValue()) {
+		return;
+	}
+
+	depth++;
+	const uint16_t levelBit = 1 << (depth - 1);
+	nonEmptyLevels &= ~levelBit;
+	if (array) {
+		arrayLevels |= levelBit;
+		out->print('[');
+	} else {
+		arrayLevels &= ~levelBit;
+		out->print('{');
+	}
+}
+
+//--------------------------------------------------------------------------------
+// Prints an escaped character (assumes valid output).
+void JSONWriter::printEscapedChar(char c) {
+	out->print('\\');
+	if (c == '\n') {
+		out->print('n');
+	} else if (c == '\r') {
+		out->print('r');
+	} else if (c == '\t') {
+		out->print('t');
+	} else if ((c == '\"') || (c == '\\')) {
+		out->print(c);
+	} else {
+		const char hexDigits[] = "0123456789ABCDEF";
+		out->print(F("u00"));
+		out->print(hexDigits[(c >> 4) & 0x0F]);
+		out->print(hexDigits[c & 0x0F]);
+	}
+}
+
+//--------------------------------------------------------------------------------
+// Prints an escaped string (assumes valid output).
+void JSONWriter::printEscapedString(const char* str) {
+	if (str == NULL) {
+		out->print(F("null"));
+		return;
+	}
+
+	out->print('\"');
+
+	// Runs of characters that need no escaping are written at once
+	const char* runStart = str;
+	while (*str != 0) {
+		const char c = *str;
+		if ((c == '\"') || (c == '\\') || ((uint8_t) c < ' ')) {
+			if (str > runStart) {
+				out->write((const uint8_t*) runStart, str - runStart);
+			}
+
+			printEscapedChar(c);
+			runStart = str + 1;
+		}
+
+		str++;
+	}
+
+	if (str > runStart) {
+		out->write((const uint8_t*) runStart, str - runStart);
+	}
+
+	out->print('\"');
+}
+
+//--------------------------------------------------------------------------------
+// Prints an escaped string (assumes valid output).
+void JSONWriter::printEscapedString(const __FlashStringHelper* fstr) {
+	if (fstr == NULL) {
+		out->print(F("null"));
+		return;
+	}
+
+	PGM_P str = reinterpret_cast<PGM_P>(fstr);
+	out->print('\"');
+
+	// Characters are copied from flash memory in blocks
+	uint8_t block[16];
+	int blockLength = 0;
+	char c = pgm_read_byte(str);
+	while (c != 0) {
+		if ((c == '\"') || (c == '\\') || ((uint8_t) c < ' ')) {
+			out->write(block, blockLength);
+			blockLength = 0;
+			printEscapedChar(c);
+		} else {
+			if (blockLength == sizeof(block)) {
+				out->write(block, blockLength);
+				blockLength = 0;
+			}
+
+			block[blockLength] = c;
+			blockLength++;
+		}
+
+		str++;
+		c = pgm_read_byte(str);
+	}
+
+	out->write(block, blockLength);
+	out->print('\"');
+}
+
+//--------------------------------------------------------------------------------
+// Prints a real number (assumes valid output). Values that cannot be printed as
+// a number (NaN, infinity and values out of the range of Print) are printed as null.
+void JSONWriter::printNumber(double value, int digits) {
+	if ((value != value) || (value > 4294967040.0) || (value < -4294967040.0)) {
+		out->print(F("null"));
+		return;
+	}
+
+	out->print(value, digits);
+}
+
+//--------------------------------------------------------------------------------
+// Formats an integer in decimal notation so that it ends before given position and
+// returns the position of the first character.
+char* JSONWriter::formatInteger(char* end, unsigned long magnitude, bool negative) {
+	char* start = end;
+	do {
+		start--;
+		*start = '0' + (magnitude % 10);
+		magnitude = magnitude / 10;
+	} while (magnitude > 0);
+
+	if (negative) {
+		start--;
+		*start = '-';
+	}
+
+	return start;
+}
+
+//--------------------------------------------------------------------------------
+// Starts a nested object.
+void JSONWriter::beginObject() {
+	begin(false);
+}
+
+//--------------------------------------------------------------------------------
+// Starts a nested array.
+void JSONWriter::beginArray() {
+	begin(true);
+}
+
+//--------------------------------------------------------------------------------
+// Ends the innermost object or array.
+void JSONWriter::end() {
+	if ((out == NULL) || ((state & B00000100) != 0)) {
+		return;
+	}
+
+	// Nothing to end or a key without a value
+	if ((depth == 0) || ((state & B00000001) != 0)) {
+		fail();
+		return;
+	}
+
+	const uint16_t levelBit = 1 << (depth - 1);
+	out->print(((arrayLevels & levelBit) != 0) ? ']' : '}');
+	depth--;
+}
+
+//--------------------------------------------------------------------------------
+// Closes all open objects and arrays.
+void JSONWriter::close() {
+	while ((depth > 0) && isValid()) {
+		end();
+	}
+}
+
+//--------------------------------------------------------------------------------
+// Writes a key of the next value in an object.
+void JSONWriter::key(const char* key) {
+	if (!openKey()) {
+		return;
+	}
+
+	printEscapedString(key);
+	out->print(':');
+}
+
+//--------------------------------------------------------------------------------
+// Writes a key of the next value in an object.
+void JSONWriter::key(const __FlashStringHelper* key) {
+	if (!openKey()) {
+		return;
+	}
+
+	printEscapedString(key);
+	out->print(':');
+}
+
+//--------------------------------------------------------------------------------
+// Writes a value.
+void JSONWriter::value(const char* value) {
+	if (!openValue()) {
+		return;
+	}
+
+	printEscapedString(value);
+}
+
+//--------------------------------------------------------------------------------
+// Writes a value.
+void JSONWriter::value(const __FlashStringHelper* value) {
+	if (!openValue()) {
+		return;
+	}
+
+	printEscapedString(value);
+}
+
+//--------------------------------------------------------------------------------
+// Writes a value.
+void JSONWriter::value(int value) {
+	if (!openValue()) {
+		return;
+	}
+
+	out->print(value);
+}
+
+//--------------------------------------------------------------------------------
+// Writes a value.
+void JSONWriter::value(unsigned int value) {
+	if (!openValue()) {
+		return;
+	}
+
+	out->print(value);
+}
+
+//--------------------------------------------------------------------------------
+// Writes a value.
+void JSONWriter::value(long value) {
+	if (!openValue()) {
+		return;
+	}
+
+	out->print(value);
+}
+
+//--------------------------------------------------------------------------------
+// Writes a value.
+void JSONWriter::value(unsigned long value) {
+	if (!openValue()) {
+		return;
+	}
+
+	out->print(value);
+}
+
+//--------------------------------------------------------------------------------
+// Writes a value.
+void JSONWriter::value(double value, int digits) {
+	if (!openValue()) {
+		return;
+	}
+
+	printNumber(value, digits);
+}
+
+//--------------------------------------------------------------------------------
+// Writes a value.
+void JSONWriter::value(bool value) {
+	if (!openValue()) {
+		return;
+	}
+
+	out->print(value ? F("true") : F("false"));
+}
+
+//--------------------------------------------------------------------------------
+// Writes a null value.
+void JSONWriter::nullValue() {
+	if (!openValue()) {
+		return;
+	}
+
+	out->print(F("null"));
+}
+
+//--------------------------------------------------------------------------------
+// Writes an array of numbers as a value.
+void JSONWriter::array(const uint8_t* values, int count) {
+	printArray(values, count);
+}
+
+//--------------------------------------------------------------------------------
+// Writes an array of numbers as a value.
+void JSONWriter::array(const int* values, int count) {
+	printArray(values, count);
+}
+
+//--------------------------------------------------------------------------------
+// Writes an array of numbers as a value.
+void JSONWriter::array(const unsigned int* values, int count) {
+	printArray(values, count);
+}
+
+//--------------------------------------------------------------------------------
+// Writes an array of numbers as a value.
+void JSONWriter::array(const long* values, int count) {
+	printArray(values, count);
+}
+
+//--------------------------------------------------------------------------------
+// Writes an array of numbers as a value.
+void JSONWriter::array(const unsigned long* values, int count) {
+	printArray(values, count);
+}
+
+//--------------------------------------------------------------------------------
+// Writes an array of real numbers as a value.
+void JSONWriter::array(const float* values, int count, int digits) {
+	printRealArray(values, count, digits);
+}
+
+//--------------------------------------------------------------------------------
+// Writes an array of real numbers as a value.
+void JSONWriter::array(const double* values, int count, int digits) {
+	printRealArray(values, count, digits);
+}
+
 /********************************************************************************
  * XML format printer for generating an object with key-value pairs.
  ********************************************************************************/
@@ -364,6 +786,7 @@ bool XMLMapPrinter::continueEntry() {
 // Closes printing of a new key-value pair.
 bool XMLMapPrinter::closeEntry() {
 	out->println(F("\"/>"));
+	return true;
 }
 
 //--------------------------------------------------------------------------------
@@ -649,3 +1072,76 @@ void XMLMapPrinter::add(const __FlashStringHelper* key, bool value) {
 	out->print(value ? F("true") : F("false"));
 	closeEntry();
 }
+
+/********************************************************************************
+ * Print object that coalesces small writes in a buffer.
+ ********************************************************************************/
+
+//--------------------------------------------------------------------------------
+// Constructs a buffered print that writes to given Print object using given buffer.
+BufferedPrint::BufferedPrint(Print* print, uint8_t* buffer, int bufferSize) :
+		out(print), buffer(buffer), bufferSize(bufferSize), bufferedBytes(0) {
+
+	if (buffer == NULL) {
+		this->bufferSize = 0;
+	}
+}
+
+//--------------------------------------------------------------------------------
+// Destructs the buffered print (and writes all buffered bytes).
+BufferedPrint::~BufferedPrint() {
+	flush();
+}
+
+//--------------------------------------------------------------------------------
+// Writes a byte.
+size_t BufferedPrint::write(uint8_t data) {
+	if (out == NULL) {
+		return 0;
+	}
+
+	if (bufferSize <= 0) {
+		return out->write(data);
+	}
+
+	if (bufferedBytes >= bufferSize) {
+		flush();
+	}
+
+	buffer[bufferedBytes] = data;
+	bufferedBytes++;
+	return 1;
+}
+
+//--------------------------------------------------------------------------------
+// Writes a block of bytes.
+size_t BufferedPrint::write(const uint8_t* data, size_t size) {
+	if (out == NULL) {
+		return 0;
+	}
+
+	// Large blocks are written directly
+	if (size >= (size_t) bufferSize) {
+		flush();
+		return out->write(data, size);
+	}
+
+	// Move data to buffer
+	if (bufferedBytes + size > (size_t) bufferSize) {
+		flush();
+	}
+
+	memcpy(buffer + bufferedBytes, data, size);
+	bufferedBytes += size;
+	return size;
+}
+
+//--------------------------------------------------------------------------------
+// Writes all buffered bytes to the output.
+void BufferedPrint::flush() {
+	if ((out != NULL) && (bufferedBytes > 0)) {
+		out->write(buffer, bufferedBytes);
+	}
+
+	bufferedBytes = 0;
+}
@@ -22,6 +22,12 @@ namespace acp_network_libs_handling_srv {
 		//--------------------------------------------------------------------------------
 		// Realizes closing actions.
 		virtual void finalize() = 0;
+
+		//--------------------------------------------------------------------------------
+		// Returns the number of clients that the server serves concurrently.
+		virtual uint8_t getClientSlots() {
+			return 1;
+		}
 	};
 
 	/********************************************************************************
@@ -35,8 +41,70 @@ namespace acp_network_libs_handling_srv {
 		virtual void setServer(LoopingServer* server) = 0;
 
 		//--------------------------------------------------------------------------------
-		// Handles a client.
+		// Handles a client. If the client remains connected after handling, the server
+		// keeps the connection and handles the client again (with isNew set to false)
+		// when new data are available.
 		virtual void handle(Client& client, bool isNew) = 0;
+
+		//--------------------------------------------------------------------------------
+		// Returns maximal idle time in milliseconds of a kept connection or 0, if the
+		// connections are not kept.
+		virtual unsigned long getKeepAliveTimeout() {
+			return 0;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns the number of clients that can be served concurrently by advancing their
+		// processing (see advance) or 0, if clients can be only handled one by one.
+		virtual uint8_t getConnectionSlots() {
+			return 0;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Advances processing of a client served in given connection slot without waiting
+		// for data. Returns true, if the client remains connected and should be advanced
+		// again, false, if the server should close and release the client.
+		virtual bool advance(Client& client, uint8_t /*slot*/, bool isNew) {
+			handle(client, isNew);
+			return false;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns whether the client served in given connection slot is idle (waits for
+		// a new request), so that its connection can be closed in favour of a new client.
+		virtual bool isIdle(uint8_t /*slot*/) {
+			return true;
+		}
+	};
+
+	/********************************************************************************
+	 * Lookup of client addresses among addresses of clients with priority. Only the
+	 * enabled lookup calls remoteIP() of the client, so that clients without this
+	 * method can be used if priority clients are disabled.
+	 ********************************************************************************/
+	template<bool ENABLED> class PriorityLookup {
+	public:
+		template<typename CLIENT> static bool contains(CLIENT& /*client*/, const IPAddress* /*addresses*/, uint8_t /*count*/) {
+			return false;
+		}
+	};
+
+	template<> class PriorityLookup<true> {
+	public:
+		template<typename CLIENT> static bool contains(CLIENT& client, const IPAddress* addresses, uint8_t count) {
+			if (count == 0) {
+				return false;
+			}
+
+			const IPAddress address = client.remoteIP();
+			for (int i = 0; i < count; i++) {
+				if (addresses[i] == address) {
+					return true;
+				}
+			}
+
+			return false;
+		}
 	};
 }
 
@@ -48,13 +116,76 @@ template<typename SERVER, typename CLIENT> class SingleClientServer: public SERV
 private:
 	// Client handler used by this server.
 	acp_network_libs_handling_srv::ClientHandlerWithServerSupport* clientHandler;
+
+	// Client whose connection is kept after handling (persistent connection) or whose
+	// request is in progress (if the handler advances clients).
+	CLIENT keptClient;
+
+	// Indicates whether there is a kept client.
+	bool hasKeptClient;
+
+	// Time of the last activity of the kept client.
+	unsigned long keptClientActivityTime;
+
+	// Indicates whether the handler advances the client without waiting for data.
+	bool advancing;
+
+	//--------------------------------------------------------------------------------
+	// Closes the kept client.
+	void closeKeptClient() {
+		if (hasKeptClient) {
+			keptClient.stop();
+			hasKeptClient = false;
+		}
+	}
+
+	//--------------------------------------------------------------------------------
+	// Stores the client as a kept client, if the handler did not close its connection.
+	void keepClient(CLIENT& client) {
+		if (client.connected() && (clientHandler->getKeepAliveTimeout() > 0)) {
+			keptClient = client;
+			hasKeptClient = true;
+			keptClientActivityTime = millis();
+		} else {
+			client.stop();
+		}
+	}
+
+	//--------------------------------------------------------------------------------
+	// Realizes looping actions, if the handler advances the client (the looper never
+	// waits for data, so that other loopers are not blocked).
+	void advanceClients() {
+		// Advance processing of the current client
+		if (hasKeptClient && !clientHandler->advance(keptClient, 0, false)) {
+			closeKeptClient();
+		}
+
+		CLIENT client = this->available();
+		if (client) {
+			if (hasKeptClient) {
+				// The new client waits until the request of the current client is served
+				if ((client == keptClient) || !clientHandler->isIdle(0)) {
+					return;
+				}
+
+				closeKeptClient();
+			}
+
+			keptClient = client;
+			hasKeptClient = true;
+			if (!clientHandler->advance(keptClient, 0, true)) {
+				closeKeptClient();
+			}
+		}
+	}
 public:
 
 	//--------------------------------------------------------------------------------
 	// Constructs a single client server with associated client handler and listening
 	// at given port.
-	SingleClientServer(uint16_t port, acp_network_libs_handling_srv::ClientHandlerWithServerSupport& clientHandler):SERVER(port) {
+	SingleClientServer(uint16_t port, acp_network_libs_handling_srv::ClientHandlerWithServerSupport& clientHandler):SERVER(port), hasKeptClient(false), keptClientActivityTime(0) {
 		this->clientHandler = &clientHandler;
+		advancing = (this->clientHandler->getConnectionSlots() > 0);
 		this->clientHandler->setServer(this);
 	}
 
@@ -73,9 +204,35 @@ public:
 			return;
 		}
 
+		if (advancing) {
+			advanceClients();
+			return;
+		}
+
+		// Handle the kept client (persistent connection)
+		if (hasKeptClient) {
+			if (!keptClient.connected()) {
+				closeKeptClient();
+			} else if (keptClient.available() > 0) {
+				hasKeptClient = false;
+				clientHandler->handle(keptClient, false);
+				keepClient(keptClient);
+			} else if (millis() - keptClientActivityTime > clientHandler->getKeepAliveTimeout()) {
+				closeKeptClient();
+			}
+		}
+
 		CLIENT client = this->available();
 		if (client) {
+			if (hasKeptClient && (client == keptClient)) {
+				// Data of the kept client are handled in the next loop
+				return;
+			}
+
+			// Only one connection is kept, the idle connection is closed for a new client
+			closeKeptClient();
 			clientHandler->handle(client, true);
+			keepClient(client);
 			this->available();
 		}
 	}
@@ -83,6 +240,200 @@ public:
 	//--------------------------------------------------------------------------------
 	// Realizes closing actions.
 	virtual void finalize() {
+		closeKeptClient();
+		this->clientHandler = NULL;
+	}
+};
+
+/********************************************************************************
+ * Server that concurrently serves multiple clients. Processing of each client is
+ * advanced in every loop only with data that are already available, so that a slow
+ * client does not block other clients. With admission control, clients over the
+ * limit of served clients are immediately rejected with 503 Service Unavailable.
+ * If PRIORITY_CLIENTS is true, clients with priority addresses can use all connection
+ * slots (see setPriorityClients) and the CLIENT class must provide remoteIP() method.
+ ********************************************************************************/
+template<typename SERVER, typename CLIENT, int MAX_CLIENTS, bool PRIORITY_CLIENTS = false> class MultiClientServer: public SERVER, acp_network_libs_handling_srv::LoopingServer {
+private:
+	// Client handler used by this server.
+	acp_network_libs_handling_srv::ClientHandlerWithServerSupport* clientHandler;
+
+	// Clients served in connection slots.
+	CLIENT clients[MAX_CLIENTS];
+
+	// Indicates whether a connection slot is occupied by a client.
+	bool activeClients[MAX_CLIENTS];
+
+	// Number of usable connection slots.
+	uint8_t slots;
+
+	// Maximal number of served clients without priority (admission control).
+	uint8_t admissionLimit;
+
+	// Value of Retry-After header of the rejection response in seconds (0, if clients
+	// over the limit are not rejected but wait for a free slot).
+	uint16_t retryAfter;
+
+	// Addresses of clients with priority (can use all connection slots).
+	const IPAddress* priorityAddresses;
+
+	// Number of addresses of clients with priority.
+	uint8_t priorityAddressCount;
+
+	//--------------------------------------------------------------------------------
+	// Closes the client in a connection slot and releases the slot.
+	void releaseSlot(uint8_t slot) {
+		clients[slot].stop();
+		activeClients[slot] = false;
+	}
+
+	//--------------------------------------------------------------------------------
+	// Returns whether a client has a priority address.
+	bool isPriorityClient(CLIENT& client) {
+		return acp_network_libs_handling_srv::PriorityLookup<PRIORITY_CLIENTS>::contains(client, priorityAddresses,
+				priorityAddressCount);
+	}
+
+	//--------------------------------------------------------------------------------
+	// Rejects a client with a minimal 503 response (the request is not read).
+	void rejectClient(CLIENT& client) {
+		client.print(F("HTTP/1.1 503 Service Unavailable\r\nRetry-After: "));
+		client.print(retryAfter);
+		client.print(F("\r\nContent-Length: 0\r\nConnection: close\r\n\r\n"));
+		client.flush();
+
+		// Received data are discarded, so that the connection is not reset
+		uint8_t discardedData[16];
+		while (client.available() > 0) {
+			if (client.read(discardedData, sizeof(discardedData)) <= 0) {
+				break;
+			}
+		}
+
+		client.stop();
+	}
+
+	//--------------------------------------------------------------------------------
+	// Accepts a new client (if any) and returns its slot or -1, if no client is accepted.
+	int acceptClient() {
+		CLIENT client = this->available();
+		if (!client) {
+			return -1;
+		}
+
+		// Check whether the client is already served
+		int freeSlot = -1;
+		int servedClients = 0;
+		for (int i = 0; i < slots; i++) {
+			if (activeClients[i]) {
+				if (clients[i] == client) {
+					return -1;
+				}
+				servedClients++;
+			} else if (freeSlot < 0) {
+				freeSlot = i;
+			}
+		}
+
+		// Admission control (clients with priority wait for a free slot)
+		if ((retryAfter > 0) && (servedClients >= admissionLimit) && !isPriorityClient(client)) {
+			rejectClient(client);
+			return -1;
+		}
+
+		// If all slots are occupied, the client waits until a slot is released
+		if (freeSlot >= 0) {
+			clients[freeSlot] = client;
+			activeClients[freeSlot] = true;
+		}
+
+		return freeSlot;
+	}
+public:
+
+	//--------------------------------------------------------------------------------
+	// Constructs a multi client server with associated client handler and listening
+	// at given port.
+	MultiClientServer(uint16_t port, acp_network_libs_handling_srv::ClientHandlerWithServerSupport& clientHandler):SERVER(port) {
+		for (int i = 0; i < MAX_CLIENTS; i++) {
+			activeClients[i] = false;
+		}
+
+		this->clientHandler = &clientHandler;
+		slots = constrain(this->clientHandler->getConnectionSlots(), 1, MAX_CLIENTS);
+		admissionLimit = slots;
+		retryAfter = 0;
+		priorityAddresses = NULL;
+		priorityAddressCount = 0;
+		this->clientHandler->setServer(this);
+	}
+
+	//--------------------------------------------------------------------------------
+	// Enables admission control: if maxClients clients are served, new clients without
+	// priority are rejected with 503 Service Unavailable and given Retry-After value in
+	// seconds (retryAfter 0 disables admission control).
+	void setAdmissionControl(uint8_t maxClients, uint16_t retryAfter) {
+		this->admissionLimit = constrain(maxClients, 1, slots);
+		this->retryAfter = retryAfter;
+	}
+
+	//--------------------------------------------------------------------------------
+	// Sets addresses of clients with priority. The clients are never rejected by admission
+	// control and can use all connection slots. Requires PRIORITY_CLIENTS set to true.
+	void setPriorityClients(const IPAddress* addresses, uint8_t count) {
+		static_assert(PRIORITY_CLIENTS, "Priority clients require MultiClientServer with PRIORITY_CLIENTS set to true.");
+		priorityAddresses = addresses;
+		priorityAddressCount = (addresses != NULL) ? count : 0;
+	}
+
+	//--------------------------------------------------------------------------------
+	// Realizes initialization actions.
+	virtual void init() {
+		if (this->clientHandler != NULL) {
+			this->begin();
+		}
+	}
+
+	//--------------------------------------------------------------------------------
+	// Realizes all looping actions.
+	virtual void loop() {
+		if (this->clientHandler == NULL) {
+			return;
+		}
+
+		// Start processing of a new client
+		const int newSlot = acceptClient();
+		if (newSlot >= 0) {
+			if (!clientHandler->advance(clients[newSlot], newSlot, true)) {
+				releaseSlot(newSlot);
+			}
+		}
+
+		// Advance processing of served clients
+		for (int i = 0; i < slots; i++) {
+			if (activeClients[i] && (i != newSlot)) {
+				if (!clientHandler->advance(clients[i], i, false)) {
+					releaseSlot(i);
+				}
+			}
+		}
+	}
+
+	//--------------------------------------------------------------------------------
+	// Returns the number of clients that the server serves concurrently.
+	virtual uint8_t getClientSlots() {
+		return slots;
+	}
+
+	//--------------------------------------------------------------------------------
+	// Realizes closing actions.
+	virtual void finalize() {
+		for (int i = 0; i < slots; i++) {
+			if (activeClients[i]) {
+				releaseSlot(i);
+			}
+		}
+
 		this->clientHandler = NULL;
 	}
 };
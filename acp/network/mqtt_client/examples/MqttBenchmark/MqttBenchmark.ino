@@ -0,0 +1,103 @@
+//----------------------------------------------------------------------
+// Includes required to build the sketch (including ext. dependencies)
+#include <MqttBenchmark.h>
+#include <SPI.h>
+#include <Ethernet.h>
+//----------------------------------------------------------------------
+
+//----------------------------------------------------------------------
+// Summary of available objects:
+// mqtt (acp.network.mqtt_client)
+// benchTimer (acp.common.timer)
+//----------------------------------------------------------------------
+
+// Benchmark of publishing throughput against a local broker, e.g.:
+//   mosquitto -v
+//   mosquitto_sub -t 'bench/#' | pv -l -r > /dev/null
+// Results (messages per second) are printed to the serial line.
+
+// Number of messages published in each run
+#define MESSAGE_COUNT 1000
+
+byte mac[] = { 0xDE, 0xAD, 0xBE, 0xEF, 0xFE, 0xED };
+IPAddress ip(192, 168, 1, 177);
+EthernetClient ethClient;
+
+// QoS of the current run
+uint8_t benchQoS = 0;
+// Number of messages published in the current run
+unsigned int publishedCount;
+// Start time of the current run
+unsigned long startTime;
+
+//----------------------------------------------------------------------
+// Prints result of a run.
+void printResult(unsigned long elapsedTime) {
+  Serial.print(F("QoS "));
+  Serial.print(benchQoS);
+  Serial.print(F(": "));
+  Serial.print(MESSAGE_COUNT);
+  Serial.print(F(" messages in "));
+  Serial.print(elapsedTime);
+  Serial.print(F(" ms, "));
+  Serial.print(MESSAGE_COUNT * 1000.0 / elapsedTime);
+  Serial.println(F(" messages/s"));
+}
+
+//----------------------------------------------------------------------
+// Event callback for Program.OnStart
+void onStart() {
+  Serial.begin(115200);
+  Ethernet.begin(mac, ip);
+  mqtt.setClient(&ethClient);
+}
+
+//----------------------------------------------------------------------
+// Event callback for mqtt.OnConnected
+void onConnected() {
+  benchQoS = 0;
+  publishedCount = 0;
+  startTime = millis();
+  benchTimer.enable();
+}
+
+//----------------------------------------------------------------------
+// Event callback for benchTimer.OnTick
+void onBenchTick() {
+  if (!mqtt.isConnected()) {
+    benchTimer.disable();
+    return;
+  }
+
+  // Publish messages while they fit the buffers (QoS 1 messages wait for
+  // acknowledgements processed by the looper of the client)
+  while (publishedCount < MESSAGE_COUNT) {
+    Print* out = mqtt.startPublish(F("bench/value"), benchQoS);
+    if (out == NULL) {
+      return;
+    }
+
+    out->print(publishedCount);
+    if (!mqtt.endPublish()) {
+      return;
+    }
+
+    publishedCount++;
+  }
+
+  // Wait for all acknowledgements
+  if (mqtt.getUnacknowledged() > 0) {
+    return;
+  }
+
+  mqtt.flush();
+  printResult(millis() - startTime);
+
+  if (benchQoS == 0) {
+    benchQoS = 1;
+    publishedCount = 0;
+    startTime = millis();
+  } else {
+    benchTimer.disable();
+  }
+}
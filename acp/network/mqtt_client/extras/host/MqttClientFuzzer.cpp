@@ -0,0 +1,95 @@
+/********************************************************************************
+ * Fuzz target for packets received by MqttClientController.
+ *
+ * The client connects a broker that accepts the connection (CONNACK) and then
+ * sends the input, delivered in segments of 1-16 bytes (the looper runs after
+ * each segment) and a message of QoS 1 is published. The controller and the
+ * input are allocated for each run, so that the address sanitizer detects
+ * accesses beyond them. The target checks:
+ * - OnMessage gets a zero terminated topic and a payload within the packet,
+ * - OnWriteIntRegister gets only register identifiers in range 0-32767.
+ ********************************************************************************/
+
+#include <acp/network/mqtt_client/MqttClient.h>
+#include <HostCore.h>
+#include <MemoryClient.h>
+#include <stdio.h>
+
+using namespace acp_network_mqtt_client;
+
+// Size of the input buffer of the client
+#define INPUT_BUFFER_SIZE 40
+
+/********************************************************************************
+ * Broker connection that sends the input.
+ ********************************************************************************/
+class FuzzBroker: public MemoryClient<256> {
+public:
+	int connect(IPAddress, uint16_t) {
+		return 1;
+	}
+
+	int connect(const char*, uint16_t) {
+		return 1;
+	}
+};
+
+//--------------------------------------------------------------------------------
+// Event handlers
+
+static void onMessage(const char* topic, const uint8_t* payload, int length) {
+	if ((length < 0) || (length > INPUT_BUFFER_SIZE) || (strlen(topic) > INPUT_BUFFER_SIZE)) {
+		fprintf(stderr, "Invalid message (payload length %d)\n", length);
+		abort();
+	}
+
+	volatile uint8_t sum = 0;
+	for (int i = 0; i < length; i++) {
+		sum ^= payload[i];
+	}
+}
+
+static bool onWriteIntRegister(unsigned int registerId, long) {
+	if (registerId > 0x7FFF) {
+		fprintf(stderr, "Register %u out of range\n", registerId);
+		abort();
+	}
+
+	return registerId % 2 == 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+	typedef MqttClientController<64, INPUT_BUFFER_SIZE, 64> Controller;
+	Controller* controller = new Controller();
+	TMqttClient<64, INPUT_BUFFER_SIZE, 64> mqtt(*controller);
+	controller->messageEvent = onMessage;
+	controller->writeIntRegisterEvent = onWriteIntRegister;
+	controller->init(F("node"), F("broker"), 1883, NULL, NULL, 10, 0, 1000, F("r"));
+
+	// The broker accepts the connection and then sends the input
+	char* input = new char[4 + size];
+	memcpy(input, "\x20\x02\x00\x00", 4);
+	memcpy(input + 4, data, size);
+
+	FuzzBroker broker;
+	broker.reset(input, 4);
+	mqtt.setClient(&broker);
+	controller->mqttLooper();
+	controller->mqttLooper();
+
+	size_t position = 4;
+	while (position < 4 + size) {
+		position += 1 + (uint8_t) input[position] % 16;
+		if (position > 4 + size) {
+			position = 4 + size;
+		}
+
+		broker.extend(input, position);
+		controller->mqttLooper();
+		mqtt.publish(F("t"), "x", 1);
+	}
+
+	delete[] input;
+	delete controller;
+	return 0;
+}
@@ -0,0 +1,411 @@
+/********************************************************************************
+ * Test of MqttClientController against a scripted broker. The broker is a
+ * MemoryClient: the test appends packets of the broker to its input and decodes
+ * packets written by the client from its output. The simulated clock moves only
+ * by delay(). The test checks:
+ * - CONNECT, CONNACK and the subscription of the registry bridge,
+ * - coalescing of published messages for the publish delay,
+ * - commands of the registry bridge: register identifiers out of range 0-32767
+ *   and values out of range of long are ignored, accepted values are published,
+ * - received PUBLISH packets with a topic or packet identifier beyond the packet,
+ *   or longer than the input buffer, are ignored without losing the connection,
+ * - acknowledgement of QoS 1 messages and their resending (with the DUP flag)
+ *   after a reconnect,
+ * - keep alive (PINGREQ) and disconnecting a silent broker.
+ ********************************************************************************/
+
+#include <acp/network/mqtt_client/MqttClient.h>
+#include <HostCore.h>
+#include <MemoryClient.h>
+#include <limits.h>
+#include <stdio.h>
+
+using namespace acp_network_mqtt_client;
+
+/********************************************************************************
+ * Broker connection scripted by the test.
+ ********************************************************************************/
+class ScriptedBroker: public MemoryClient<4096> {
+private:
+	// Packets sent by the broker
+	char input[4096];
+	size_t inputLength;
+
+	// Position of the next undecoded packet sent by the client
+	unsigned long outputPosition;
+
+	// Number of connect calls
+	int connects;
+
+	//--------------------------------------------------------------------------------
+	// Appends bytes to the input.
+	void append(const void* data, size_t length) {
+		memcpy(input + inputLength, data, length);
+		inputLength += length;
+	}
+
+	//--------------------------------------------------------------------------------
+	// Appends a length-prefixed string to the input.
+	void appendString(const char* str, uint16_t length) {
+		const uint8_t lengthBytes[] = { (uint8_t) (length >> 8), (uint8_t) length };
+		append(lengthBytes, 2);
+		append(str, strlen(str));
+	}
+
+	//--------------------------------------------------------------------------------
+	// Appends the first byte and the remaining length of a packet to the input.
+	void appendFixedHeader(uint8_t header, unsigned long remainingLength) {
+		append(&header, 1);
+		do {
+			uint8_t encodedByte = remainingLength % 128;
+			remainingLength = remainingLength / 128;
+			if (remainingLength > 0) {
+				encodedByte |= 0x80;
+			}
+			append(&encodedByte, 1);
+		} while (remainingLength > 0);
+	}
+
+public:
+	ScriptedBroker() :
+			inputLength(0), outputPosition(0), connects(0) {
+		stop();
+	}
+
+	int connect(IPAddress, uint16_t) {
+		return connect("", 0);
+	}
+
+	int connect(const char*, uint16_t) {
+		connects++;
+		inputLength = 0;
+		outputPosition = 0;
+		reset(input, 0);
+		return 1;
+	}
+
+	//--------------------------------------------------------------------------------
+	// Returns the number of connect calls.
+	int getConnects() {
+		return connects;
+	}
+
+	//--------------------------------------------------------------------------------
+	// Sends a packet with given body to the client.
+	void send(uint8_t header, const void* body, unsigned long length) {
+		appendFixedHeader(header, length);
+		append(body, length);
+		extend(input, inputLength);
+	}
+
+	//--------------------------------------------------------------------------------
+	// Sends a PUBLISH packet to the client. The declared topic length can differ from
+	// the length of the topic.
+	void sendPublish(uint8_t qos, const char* topic, uint16_t topicLength, const char* payload, uint16_t packetId = 0) {
+		const size_t length = 2 + strlen(topic) + ((qos > 0) ? 2 : 0) + strlen(payload);
+		appendFixedHeader(MQTT_PUBLISH | (qos << 1), length);
+		appendString(topic, topicLength);
+		if (qos > 0) {
+			const uint8_t idBytes[] = { (uint8_t) (packetId >> 8), (uint8_t) packetId };
+			append(idBytes, 2);
+		}
+		append(payload, strlen(payload));
+		extend(input, inputLength);
+	}
+
+	//--------------------------------------------------------------------------------
+	// Sends a PUBLISH packet to the client.
+	void sendPublish(uint8_t qos, const char* topic, const char* payload, uint16_t packetId = 0) {
+		sendPublish(qos, topic, strlen(topic), payload, packetId);
+	}
+
+	//--------------------------------------------------------------------------------
+	// Decodes the next packet sent by the client. Returns false, if there is no
+	// complete packet.
+	bool receive(uint8_t& header, const uint8_t*& body, unsigned long& length) {
+		const uint8_t* output = (const uint8_t*) getOutput();
+		const unsigned long sent = getSentBytes();
+		if ((output == NULL) || (outputPosition >= sent)) {
+			return false;
+		}
+
+		unsigned long position = outputPosition + 1;
+		unsigned long remainingLength = 0;
+		unsigned long multiplier = 1;
+		while (true) {
+			if (position >= sent) {
+				return false;
+			}
+
+			const uint8_t encodedByte = output[position++];
+			remainingLength += (encodedByte & 0x7F) * multiplier;
+			multiplier *= 128;
+			if ((encodedByte & 0x80) == 0) {
+				break;
+			}
+		}
+
+		if (position + remainingLength > sent) {
+			return false;
+		}
+
+		header = output[outputPosition];
+		body = output + position;
+		length = remainingLength;
+		outputPosition = position + remainingLength;
+		return true;
+	}
+
+	//--------------------------------------------------------------------------------
+	// Returns whether the client sent no packets that were not received.
+	bool isOutputReceived() {
+		return outputPosition == getSentBytes();
+	}
+};
+
+MqttClientController<64, 48, 64> controller;
+TMqttClient<64, 48, 64> mqtt(controller);
+ScriptedBroker broker;
+
+// Number of failed checks
+static int failures = 0;
+
+// Number of OnConnected events
+static int connectedEvents = 0;
+
+// Last register write (OnWriteIntRegister) and the number of writes
+static unsigned int writtenRegister;
+static long writtenValue;
+static int registerWrites = 0;
+
+// Last received message (OnMessage) and the number of messages
+static char messageTopic[64];
+static char messagePayload[64];
+static int messages = 0;
+
+//--------------------------------------------------------------------------------
+// Reports a failed check.
+static void check(bool condition, const char* description) {
+	if (!condition) {
+		printf("FAIL: %s\n", description);
+		failures++;
+	}
+}
+
+//--------------------------------------------------------------------------------
+// Event handlers
+
+static void onConnected() {
+	connectedEvents++;
+}
+
+static bool onWriteIntRegister(unsigned int registerId, long value) {
+	writtenRegister = registerId;
+	writtenValue = value;
+	registerWrites++;
+	return registerId != 13;
+}
+
+static void onMessage(const char* topic, const uint8_t* payload, int length) {
+	snprintf(messageTopic, sizeof(messageTopic), "%s", topic);
+	snprintf(messagePayload, sizeof(messagePayload), "%.*s", length, (const char*) payload);
+	messages++;
+}
+
+//--------------------------------------------------------------------------------
+// Runs the looper a few times (without moving the clock).
+static void loop() {
+	for (int i = 0; i < 4; i++) {
+		controller.mqttLooper();
+	}
+}
+
+//--------------------------------------------------------------------------------
+// Receives the next packet of the client and checks its type (the first byte
+// without the DUP flag, if dupFlag is negative).
+static bool receivePacket(uint8_t header, const uint8_t*& body, unsigned long& length, int dupFlag = -1) {
+	uint8_t receivedHeader;
+	if (!broker.receive(receivedHeader, body, length)) {
+		return false;
+	}
+
+	if (dupFlag < 0) {
+		receivedHeader &= ~0x08;
+	} else if (dupFlag > 0) {
+		header |= 0x08;
+	}
+
+	return receivedHeader == header;
+}
+
+//--------------------------------------------------------------------------------
+// Receives the next PUBLISH packet of the client with given QoS and checks its
+// topic and payload.
+static bool receivePublish(uint8_t qos, const char* topic, const char* payload, int dupFlag = -1) {
+	const uint8_t* body;
+	unsigned long length;
+	if (!receivePacket(MQTT_PUBLISH | (qos << 1), body, length, dupFlag)) {
+		return false;
+	}
+
+	const size_t topicLength = ((size_t) body[0] << 8) | body[1];
+	const size_t payloadOffset = 2 + topicLength + ((qos > 0) ? 2 : 0);
+	return (topicLength == strlen(topic)) && (memcmp(body + 2, topic, topicLength) == 0)
+			&& (length - payloadOffset == strlen(payload)) && (memcmp(body + payloadOffset, payload, length - payloadOffset) == 0);
+}
+
+//--------------------------------------------------------------------------------
+// Receives the next PUBACK packet of the client and checks its packet identifier.
+static bool receivePublishAck(uint16_t packetId) {
+	const uint8_t* body;
+	unsigned long length;
+	return receivePacket(MQTT_PUBACK, body, length) && (length == 2) && ((((uint16_t) body[0] << 8) | body[1]) == packetId);
+}
+
+//--------------------------------------------------------------------------------
+// Sends a command of the registry bridge and returns whether it was passed to
+// OnWriteIntRegister.
+static bool sendCommand(const char* topic, const char* payload) {
+	const int writes = registerWrites;
+	const int receivedMessages = messages;
+	broker.sendPublish(0, topic, payload);
+	loop();
+	check(messages == receivedMessages, "command is not passed to OnMessage");
+	return registerWrites > writes;
+}
+
+int main() {
+	controller.connectedEvent = onConnected;
+	controller.writeIntRegisterEvent = onWriteIntRegister;
+	controller.messageEvent = onMessage;
+	controller.init(F("node"), F("broker"), 1883, F("user"), F("secret"), 10, 50, 1000, F("node/reg"));
+	mqtt.setClient(&broker);
+
+	const uint8_t* body;
+	unsigned long length;
+
+	// The connection is accepted and the registry bridge subscribes commands
+	loop();
+	check(broker.getConnects() == 1, "client connects the broker");
+	check(receivePacket(MQTT_CONNECT, body, length) && (length == 30) && (body[7] == 0xC2) && (body[9] == 10)
+			&& (memcmp(body + 12, "node", 4) == 0), "CONNECT with client id, credentials and keep alive");
+	const uint8_t connectionAccepted[] = { 0, 0 };
+	broker.send(MQTT_CONNACK, connectionAccepted, 2);
+	loop();
+	check(mqtt.isConnected() && (connectedEvents == 1), "CONNACK accepts the connection");
+	check(receivePacket(MQTT_SUBSCRIBE, body, length) && (length == 19) && (memcmp(body + 4, "node/reg/+/set", 14) == 0)
+			&& (body[18] == 1), "registry bridge subscribes commands");
+
+	// Published messages are coalesced for the publish delay
+	check(mqtt.publish(F("node/temperature"), 21L) && mqtt.publish("node/status", "ok"), "messages are published");
+	loop();
+	check(broker.isOutputReceived(), "messages wait for the publish delay");
+	delay(50);
+	loop();
+	check(receivePublish(0, "node/temperature", "21") && receivePublish(0, "node/status", "ok"), "messages are sent after the publish delay");
+
+	// Commands of the registry bridge
+	broker.sendPublish(1, "node/reg/5/set", "42", 7);
+	loop();
+	check((registerWrites == 1) && (writtenRegister == 5) && (writtenValue == 42), "command writes the register");
+	delay(50);
+	loop();
+	check(receivePublishAck(7), "command of QoS 1 is acknowledged");
+	check(receivePublish(0, "node/reg/5", "42"), "accepted value is published");
+	check(sendCommand("node/reg/13/set", "1") && (writtenRegister == 13), "value rejected by the register is passed to OnWriteIntRegister");
+
+	char value[32];
+	snprintf(value, sizeof(value), "%ld", LONG_MAX);
+	check(sendCommand("node/reg/32767/set", value) && (writtenRegister == 32767) && (writtenValue == LONG_MAX), "maximal register and value are accepted");
+	snprintf(value, sizeof(value), "-%lu", (unsigned long) LONG_MAX + 1);
+	check(sendCommand("node/reg/0/set", value) && (writtenRegister == 0) && (writtenValue == LONG_MIN), "minimal value is accepted");
+	snprintf(value, sizeof(value), "%lu", (unsigned long) LONG_MAX + 1);
+	check(!sendCommand("node/reg/6/set", value), "value above the range of long is ignored");
+	snprintf(value, sizeof(value), "-%lu", (unsigned long) LONG_MAX + 2);
+	check(!sendCommand("node/reg/6/set", value), "value below the range of long is ignored");
+	check(!sendCommand("node/reg/6/set", "99999999999999999999999"), "long value is ignored");
+	check(!sendCommand("node/reg/32768/set", "1"), "register out of range is ignored");
+	check(!sendCommand("node/reg/4294967302/set", "1"), "register overflowing unsigned int is ignored");
+	check(!sendCommand("node/reg/6/set", "x1") && !sendCommand("node/reg/6/set", "1x") && !sendCommand("node/reg/6/set", ""), "value that is not an integer is ignored");
+	delay(50);
+	loop();
+	snprintf(value, sizeof(value), "%ld", LONG_MAX);
+	check(receivePublish(0, "node/reg/32767", value), "maximal value is published");
+	snprintf(value, sizeof(value), "%ld", LONG_MIN);
+	check(receivePublish(0, "node/reg/0", value) && broker.isOutputReceived(), "only accepted values are published");
+	broker.sendPublish(0, "other/topic", "hello");
+	broker.sendPublish(0, "node/reg/6", "7");
+	loop();
+	check((messages == 2) && (strcmp(messageTopic, "node/reg/6") == 0) && (strcmp(messagePayload, "7") == 0), "other messages are passed to OnMessage");
+
+	// Malformed or too long PUBLISH packets are ignored
+	broker.sendPublish(0, "a/b", 0x8000, "payload");
+	broker.sendPublish(0, "a/b", 0xFFFF, "");
+	broker.sendPublish(1, "node/reg/5/set", 14, "", 0);
+	const uint8_t noPacketId[] = { 0, 3, 'a', '/', 'b', 0 };
+	broker.send(MQTT_PUBLISH | 0x02, noPacketId, 5);
+	uint8_t longPacket[100];
+	memset(longPacket, 'x', sizeof(longPacket));
+	longPacket[0] = 0;
+	longPacket[1] = 3;
+	broker.send(MQTT_PUBLISH, longPacket, sizeof(longPacket));
+	broker.sendPublish(0, "a/c", "last");
+	loop();
+	check(mqtt.isConnected() && (messages == 3) && (strcmp(messageTopic, "a/c") == 0) && (strcmp(messagePayload, "last") == 0),
+			"malformed packets are ignored");
+	delay(50);
+	loop();
+	check(receivePublishAck(0) && broker.isOutputReceived(), "only the complete packet of QoS 1 is acknowledged");
+
+	// Messages of QoS 1 wait for acknowledgement and are resent after a reconnect
+	check(mqtt.publish(F("node/event"), "first", 1) && (mqtt.getUnacknowledged() == 1), "message of QoS 1 waits for PUBACK");
+	mqtt.flush();
+	check(receivePublish(1, "node/event", "first", 0), "message of QoS 1 is sent");
+	const uint8_t firstAck[] = { 0, 2 };
+	broker.send(MQTT_PUBACK, firstAck, 2);
+	loop();
+	check(mqtt.getUnacknowledged() == 0, "PUBACK removes the message");
+	check(mqtt.publish(F("node/event"), "second", 1), "second message of QoS 1 is published");
+	mqtt.flush();
+	check(receivePublish(1, "node/event", "second", 0), "second message of QoS 1 is sent");
+	broker.stop();
+	loop();
+	check(!mqtt.isConnected(), "closed connection is detected");
+	check(!mqtt.publish(F("node/temperature"), 22L) && mqtt.publish(F("node/event"), "third", 1), "offline messages of QoS 1 are stored");
+	check(mqtt.getUnacknowledged() == 2, "unacknowledged messages are kept");
+	delay(999);
+	loop();
+	check(broker.getConnects() == 1, "reconnect waits for the reconnect delay");
+	delay(1);
+	loop();
+	check((broker.getConnects() == 2) && receivePacket(MQTT_CONNECT, body, length), "client reconnects the broker");
+	broker.send(MQTT_CONNACK, connectionAccepted, 2);
+	loop();
+	check(mqtt.isConnected() && (connectedEvents == 2) && receivePacket(MQTT_SUBSCRIBE, body, length), "reconnected client subscribes commands");
+	check(receivePublish(1, "node/event", "second", 1) && receivePublish(1, "node/event", "third", 0), "unacknowledged messages are resent");
+	const uint8_t resentAcks[] = { 0, 3, 0, 4 };
+	broker.send(MQTT_PUBACK, resentAcks, 2);
+	broker.send(MQTT_PUBACK, resentAcks + 2, 2);
+	loop();
+	check(mqtt.getUnacknowledged() == 0, "resent messages are acknowledged");
+
+	// Keep alive: PINGREQ after a quiet interval, a silent broker is disconnected
+	delay(9999);
+	loop();
+	check(broker.isOutputReceived(), "no PINGREQ before the keep alive interval");
+	delay(1);
+	loop();
+	check(receivePacket(MQTT_PINGREQ, body, length) && (length == 0), "PINGREQ after the keep alive interval");
+	const uint8_t noBody[] = { 0 };
+	broker.send(MQTT_PINGRESP, noBody, 0);
+	loop();
+	delay(14999);
+	loop();
+	check(mqtt.isConnected(), "broker that answered PINGREQ is not lost");
+	delay(1);
+	loop();
+	check(!mqtt.isConnected(), "silent broker is disconnected");
+
+	printf("%s: %d failed checks\n", (failures == 0) ? "OK" : "FAILED", failures);
+	return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,1111 @@
+#ifndef MODULES_ACP_NETWORK_MQTT_CLIENT_INCLUDE_MQTTCLIENT_H_
+#define MODULES_ACP_NETWORK_MQTT_CLIENT_INCLUDE_MQTTCLIENT_H_
+
+#include <acp/core.h>
+
+#include <Client.h>
+#include <limits.h>
+
+namespace acp_network_mqtt_client {
+
+	template<int OUTPUT_BUFFER_SIZE, int INPUT_BUFFER_SIZE, int QOS1_BUFFER_SIZE> class TMqttClient;
+	template<int OUTPUT_BUFFER_SIZE, int INPUT_BUFFER_SIZE, int QOS1_BUFFER_SIZE> class MqttClientController;
+
+	/********************************************************************************
+	 * Types of MQTT control packets (stored in the upper half of the first byte)
+	 ********************************************************************************/
+	enum MqttPacketType {
+		MQTT_CONNECT = 0x10,
+		MQTT_CONNACK = 0x20,
+		MQTT_PUBLISH = 0x30,
+		MQTT_PUBACK = 0x40,
+		MQTT_SUBSCRIBE = 0x82,
+		MQTT_SUBACK = 0x90,
+		MQTT_PINGREQ = 0xC0,
+		MQTT_PINGRESP = 0xD0,
+		MQTT_DISCONNECT = 0xE0
+	};
+
+	/********************************************************************************
+	 * Builder of MQTT packets in a static buffer. Complete packets are coalesced in
+	 * the buffer and written to the client by a single write. If a packet does not
+	 * fit the free space, the preceding packets are written to make room.
+	 ********************************************************************************/
+	template<int BUFFER_SIZE> class MqttPacketBuilder: public Print {
+	private:
+		// Bytes reserved for the remaining length of a packet that is being built
+		static const int LENGTH_GAP = 4;
+
+		// Buffer with packets
+		uint8_t buffer[BUFFER_SIZE];
+
+		// Number of bytes in the buffer
+		int length;
+
+		// Position of the packet that is being built (-1, if no packet is being built)
+		int packetStart;
+
+		// Indicates whether the packet that is being built does not fit the buffer
+		bool overflow;
+
+		// Indicates whether writing to the client failed
+		bool failed;
+
+		// Client that receives the packets
+		Client* client;
+
+		//--------------------------------------------------------------------------------
+		// Writes bytes to the client.
+		void writeToClient(const uint8_t* data, int size) {
+			if ((size <= 0) || failed) {
+				return;
+			}
+
+			if ((client == NULL) || (client->write(data, size) != (size_t) size)) {
+				failed = true;
+			}
+		}
+
+		//--------------------------------------------------------------------------------
+		// Writes complete packets to the client and moves the packet that is being built
+		// to the start of the buffer.
+		void writeCompletePackets() {
+			const int completeBytes = (packetStart >= 0) ? packetStart : length;
+			writeToClient(buffer, completeBytes);
+			memmove(buffer, buffer + completeBytes, length - completeBytes);
+			length -= completeBytes;
+			if (packetStart >= 0) {
+				packetStart = 0;
+			}
+		}
+	public:
+		//--------------------------------------------------------------------------------
+		// Constructs the packet builder.
+		MqttPacketBuilder() :
+				length(0), packetStart(-1), overflow(false), failed(false), client(NULL) {
+			// Nothing to do
+		}
+
+		//--------------------------------------------------------------------------------
+		// Sets the client that receives the packets and discards all buffered bytes.
+		void reset(Client* client) {
+			this->client = client;
+			length = 0;
+			packetStart = -1;
+			overflow = false;
+			failed = false;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Starts a new packet with given first byte (type and flags).
+		void beginPacket(uint8_t header) {
+			if (BUFFER_SIZE - length < 1 + LENGTH_GAP) {
+				writeCompletePackets();
+			}
+
+			packetStart = length;
+			overflow = false;
+			buffer[length++] = header;
+			length += LENGTH_GAP;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Completes the packet that is being built. Returns false, if the packet does
+		// not fit the buffer (the packet is discarded).
+		bool endPacket() {
+			if (packetStart < 0) {
+				return false;
+			}
+
+			if (overflow) {
+				discardPacket();
+				return false;
+			}
+
+			// Encode remaining length (variable length encoding)
+			unsigned long remainingLength = length - packetStart - 1 - LENGTH_GAP;
+			uint8_t encodedLength[LENGTH_GAP];
+			int encodedBytes = 0;
+			do {
+				uint8_t encodedByte = remainingLength % 128;
+				remainingLength = remainingLength / 128;
+				if (remainingLength > 0) {
+					encodedByte |= 0x80;
+				}
+				encodedLength[encodedBytes++] = encodedByte;
+			} while (remainingLength > 0);
+
+			// Close the gap between the first byte and the rest of the packet
+			uint8_t* lengthPtr = buffer + packetStart + 1;
+			memmove(lengthPtr + encodedBytes, lengthPtr + LENGTH_GAP, length - packetStart - 1 - LENGTH_GAP);
+			memcpy(lengthPtr, encodedLength, encodedBytes);
+			length -= LENGTH_GAP - encodedBytes;
+
+			packetStart = -1;
+			return true;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Discards the packet that is being built.
+		void discardPacket() {
+			if (packetStart >= 0) {
+				length = packetStart;
+				packetStart = -1;
+			}
+			overflow = false;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns the last complete packet that ends at the end of the buffer.
+		inline const uint8_t* getLastPacket(int packetLength) {
+			return buffer + length - packetLength;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns the number of bytes of the packet that is being built (including the
+		// final encoding of the remaining length).
+		int getPacketLength() {
+			if (packetStart < 0) {
+				return 0;
+			}
+
+			const unsigned long remainingLength = length - packetStart - 1 - LENGTH_GAP;
+			int encodedBytes = 1;
+			for (unsigned long limit = 128; remainingLength >= limit; limit = limit * 128) {
+				encodedBytes++;
+			}
+
+			return 1 + encodedBytes + remainingLength;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Appends a complete packet.
+		void writePacket(const uint8_t* data, int size) {
+			if (BUFFER_SIZE - length < size) {
+				writeCompletePackets();
+			}
+
+			if (size > BUFFER_SIZE) {
+				writeToClient(data, size);
+				return;
+			}
+
+			memcpy(buffer + length, data, size);
+			length += size;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Writes a byte.
+		virtual size_t write(uint8_t data) {
+			if (overflow) {
+				return 0;
+			}
+
+			if (length == BUFFER_SIZE) {
+				if (packetStart > 0) {
+					writeCompletePackets();
+				} else {
+					overflow = true;
+					return 0;
+				}
+			}
+
+			buffer[length++] = data;
+			return 1;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Writes a block of bytes.
+		virtual size_t write(const uint8_t* data, size_t size) {
+			for (size_t i = 0; i < size; i++) {
+				if (write(data[i]) == 0) {
+					return i;
+				}
+			}
+
+			return size;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Writes a 16-bit integer (big endian).
+		void writeUInt16(uint16_t value) {
+			write((uint8_t) (value >> 8));
+			write((uint8_t) (value & 0xFF));
+		}
+
+		//--------------------------------------------------------------------------------
+		// Writes a length-prefixed string.
+		void writeString(const char* str) {
+			const int strLength = strlen(str);
+			writeUInt16(strLength);
+			write((const uint8_t*) str, strLength);
+		}
+
+		//--------------------------------------------------------------------------------
+		// Writes a length-prefixed string stored in flash memory.
+		void writeString(const __FlashStringHelper* fstr) {
+			PGM_P p = reinterpret_cast<PGM_P>(fstr);
+			writeUInt16(strlen_P(p));
+			print(fstr);
+		}
+
+		//--------------------------------------------------------------------------------
+		// Writes all complete packets to the client.
+		virtual void flush() {
+			writeCompletePackets();
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns whether the buffer contains complete packets that were not written.
+		inline bool hasCompletePackets() {
+			return ((packetStart >= 0) ? packetStart : length) > 0;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns whether writing to the client failed.
+		inline bool hasFailed() {
+			return failed;
+		}
+	};
+
+	/********************************************************************************
+	 * Controller of the MQTT 3.1.1 client.
+	 ********************************************************************************/
+	template<int OUTPUT_BUFFER_SIZE, int INPUT_BUFFER_SIZE, int QOS1_BUFFER_SIZE> class MqttClientController {
+		friend class TMqttClient<OUTPUT_BUFFER_SIZE, INPUT_BUFFER_SIZE, QOS1_BUFFER_SIZE>;
+	private:
+		// Maximal length of the host name
+		static const int MAX_HOST_LENGTH = 64;
+
+		// Maximal identifier of a register (as in the registry access protocol)
+		static const unsigned int MAX_REGISTER_ID = 0x7FFF;
+
+		// States of the client
+		enum State {
+			DISCONNECTED, CONNECTING, CONNECTED
+		};
+
+		// Phases of receiving a packet
+		enum InputPhase {
+			FIXED_HEADER, REMAINING_LENGTH, PACKET_BODY
+		};
+
+		// Client used to connect the broker
+		Client* client;
+
+		// Identifier of the client (stored in flash memory)
+		const __FlashStringHelper* clientId;
+
+		// Host name of the broker (stored in flash memory)
+		const __FlashStringHelper* host;
+
+		// Port of the broker
+		uint16_t port;
+
+		// User name (stored in flash memory, NULL if not used)
+		const __FlashStringHelper* username;
+
+		// Password (stored in flash memory, NULL if not used)
+		const __FlashStringHelper* password;
+
+		// Keep alive interval in seconds (0 disables keep alive)
+		uint16_t keepAlive;
+
+		// Time in milliseconds for which published messages are coalesced before they
+		// are written to the client
+		unsigned long publishDelay;
+
+		// Delay in milliseconds between attempts to connect the broker
+		unsigned long reconnectDelay;
+
+		// Topic prefix of registers bridged to the OnWriteIntRegister event (stored in
+		// flash memory, NULL if the bridge is disabled)
+		const __FlashStringHelper* registryTopic;
+
+		// State of the client
+		State state;
+
+		// Time of the last change of the state
+		unsigned long stateTime;
+
+		// Time when the last packet was written to the client
+		unsigned long lastSendTime;
+
+		// Time when the last packet was received
+		unsigned long lastReceiveTime;
+
+		// Time when the oldest coalesced packet was built
+		unsigned long outputTime;
+
+		// Indicates whether the output contains packets waiting for the publish delay
+		bool outputPending;
+
+		// Identifier of the last packet with an identifier
+		uint16_t packetId;
+
+		// QoS of the message that is being published
+		uint8_t publishQoS;
+
+		// Builder of outgoing packets
+		MqttPacketBuilder<OUTPUT_BUFFER_SIZE> output;
+
+		// Buffer of the received packet (one extra byte terminates the payload)
+		uint8_t inputBuffer[INPUT_BUFFER_SIZE + 1];
+
+		// Phase of receiving a packet
+		InputPhase inputPhase;
+
+		// First byte of the received packet
+		uint8_t inputHeader;
+
+		// Remaining length of the received packet
+		unsigned long inputRemaining;
+
+		// Multiplier of the next byte of the remaining length
+		unsigned long inputMultiplier;
+
+		// Number of received bytes of the packet body
+		unsigned long inputReceived;
+
+		// Buffer with PUBLISH packets of QoS 1 waiting for acknowledgement
+		uint8_t qos1Buffer[QOS1_BUFFER_SIZE];
+
+		// Number of bytes in the buffer of QoS 1 packets
+		int qos1Length;
+
+		// Number of packets in the buffer of QoS 1 packets
+		int qos1Count;
+
+		// Number of published messages
+		unsigned long publishedMessages;
+
+		//--------------------------------------------------------------------------------
+		// Returns the number of bytes of a packet stored in a buffer (first byte, encoded
+		// remaining length and the rest of the packet) and position of the rest.
+		static int decodePacketLength(const uint8_t* packet, int& bodyOffset) {
+			unsigned long remainingLength = 0;
+			unsigned long multiplier = 1;
+			bodyOffset = 1;
+			while (true) {
+				const uint8_t encodedByte = packet[bodyOffset++];
+				remainingLength += (encodedByte & 0x7F) * multiplier;
+				multiplier *= 128;
+				if ((encodedByte & 0x80) == 0) {
+					break;
+				}
+			}
+
+			return bodyOffset + remainingLength;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns whether a string starts with given string stored in flash memory and
+		// moves the pointer behind the prefix.
+		static bool skipFString(const char*& str, const __FlashStringHelper* ifsh) {
+			PGM_P p = reinterpret_cast<PGM_P>(ifsh);
+			const char* readPtr = str;
+			while (true) {
+				const char c = pgm_read_byte(p);
+				if (c == 0) {
+					str = readPtr;
+					return true;
+				}
+
+				if (c != *readPtr) {
+					return false;
+				}
+
+				readPtr++;
+				p++;
+			}
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns identifier for a new packet.
+		uint16_t nextPacketId() {
+			packetId++;
+			if (packetId == 0) {
+				packetId = 1;
+			}
+
+			return packetId;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Writes coalesced packets to the client.
+		void flushOutput() {
+			if (!output.hasCompletePackets()) {
+				outputPending = false;
+				return;
+			}
+
+			output.flush();
+			outputPending = false;
+			lastSendTime = millis();
+			if (output.hasFailed()) {
+				disconnect();
+			}
+		}
+
+		//--------------------------------------------------------------------------------
+		// Marks that a complete packet was appended to the output.
+		void packetCompleted() {
+			if (!outputPending) {
+				outputPending = true;
+				outputTime = millis();
+			}
+		}
+
+		//--------------------------------------------------------------------------------
+		// Closes the connection.
+		void disconnect() {
+			if (client != NULL) {
+				client->stop();
+			}
+
+			state = DISCONNECTED;
+			stateTime = millis();
+			output.reset(client);
+			outputPending = false;
+			inputPhase = FIXED_HEADER;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Opens the connection and sends the CONNECT packet.
+		void connect() {
+			stateTime = millis();
+
+			char hostName[MAX_HOST_LENGTH + 1];
+			PGM_P p = reinterpret_cast<PGM_P>(host);
+			int length = 0;
+			while (length < MAX_HOST_LENGTH) {
+				const char c = pgm_read_byte(p++);
+				if (c == 0) {
+					break;
+				}
+				hostName[length++] = c;
+			}
+			hostName[length] = 0;
+
+			if (client->connect(hostName, port) <= 0) {
+				client->stop();
+				return;
+			}
+
+			state = CONNECTING;
+			lastReceiveTime = stateTime;
+			output.reset(client);
+			inputPhase = FIXED_HEADER;
+
+			uint8_t flags = 0x02; // Clean session
+			if (username != NULL) {
+				flags |= 0x80;
+				if (password != NULL) {
+					flags |= 0x40;
+				}
+			}
+
+			output.beginPacket(MQTT_CONNECT);
+			output.writeString(F("MQTT"));
+			output.write((uint8_t) 4); // Protocol level of MQTT 3.1.1
+			output.write(flags);
+			output.writeUInt16(keepAlive);
+			output.writeString(clientId);
+			if (username != NULL) {
+				output.writeString(username);
+				if (password != NULL) {
+					output.writeString(password);
+				}
+			}
+			output.endPacket();
+			flushOutput();
+		}
+
+		//--------------------------------------------------------------------------------
+		// Handles acceptance of the connection by the broker.
+		void handleConnectionAccepted() {
+			state = CONNECTED;
+			stateTime = millis();
+
+			// Subscribe commands for registers
+			if (registryTopic != NULL) {
+				output.beginPacket(MQTT_SUBSCRIBE);
+				output.writeUInt16(nextPacketId());
+				output.writeUInt16(strlen_P(reinterpret_cast<PGM_P>(registryTopic)) + 6);
+				output.print(registryTopic);
+				output.print(F("/+/set"));
+				output.write((uint8_t) 1);
+				output.endPacket();
+			}
+
+			// Resend unacknowledged messages of QoS 1 (with the DUP flag)
+			int position = 0;
+			while (position < qos1Length) {
+				int bodyOffset;
+				const int packetLength = decodePacketLength(qos1Buffer + position, bodyOffset);
+				output.writePacket(qos1Buffer + position, packetLength);
+				qos1Buffer[position] |= 0x08;
+				position += packetLength;
+			}
+
+			packetCompleted();
+			flushOutput();
+
+			if ((state == CONNECTED) && (connectedEvent != NULL)) {
+				connectedEvent();
+			}
+		}
+
+		//--------------------------------------------------------------------------------
+		// Removes the acknowledged message of QoS 1 with given packet identifier.
+		void handlePublishAck(uint16_t ackPacketId) {
+			int position = 0;
+			while (position < qos1Length) {
+				int bodyOffset;
+				const int packetLength = decodePacketLength(qos1Buffer + position, bodyOffset);
+				const uint16_t topicLength = ((uint16_t) qos1Buffer[position + bodyOffset] << 8) | qos1Buffer[position + bodyOffset + 1];
+				const uint8_t* idPtr = qos1Buffer + position + bodyOffset + 2 + topicLength;
+				if ((((uint16_t) idPtr[0] << 8) | idPtr[1]) == ackPacketId) {
+					memmove(qos1Buffer + position, qos1Buffer + position + packetLength, qos1Length - position - packetLength);
+					qos1Length -= packetLength;
+					qos1Count--;
+					return;
+				}
+
+				position += packetLength;
+			}
+		}
+
+		//--------------------------------------------------------------------------------
+		// Handles a received message. Commands for registers are passed to the
+		// OnWriteIntRegister event, other messages to the OnMessage event.
+		void handleMessage(const char* topic, const uint8_t* payload, int length) {
+			const char* readPtr = topic;
+			if ((registryTopic != NULL) && skipFString(readPtr, registryTopic) && (*readPtr == '/')) {
+				readPtr++;
+
+				// Identifiers out of the register range are not valid
+				unsigned int registerId = 0;
+				bool validId = true;
+				const char* idStart = readPtr;
+				while (('0' <= *readPtr) && (*readPtr <= '9')) {
+					const unsigned int digit = *readPtr - '0';
+					if (registerId > (MAX_REGISTER_ID - digit) / 10) {
+						validId = false;
+					} else {
+						registerId = registerId * 10 + digit;
+					}
+					readPtr++;
+				}
+
+				if ((readPtr != idStart) && skipFString(readPtr, F("/set")) && (*readPtr == 0)) {
+					if (!validId) {
+						return;
+					}
+
+					// Decode integer value (values out of range of the long type are not valid)
+					const char* valuePtr = (const char*) payload;
+					const bool negative = (*valuePtr == '-');
+					if (negative) {
+						valuePtr++;
+					}
+
+					const unsigned long limit = negative ? (unsigned long)LONG_MAX + 1 : (unsigned long)LONG_MAX;
+					unsigned long magnitude = 0;
+					const char* digitsStart = valuePtr;
+					while (('0' <= *valuePtr) && (*valuePtr <= '9')) {
+						const int digit = *valuePtr - '0';
+						if (magnitude > (limit - digit) / 10) {
+							return;
+						}
+
+						magnitude = magnitude * 10 + digit;
+						valuePtr++;
+					}
+
+					if ((valuePtr == digitsStart) || (*valuePtr != 0)) {
+						return;
+					}
+
+					const long value = negative ? (long)(0 - magnitude) : (long)magnitude;
+
+					// Publish the new value of the register after the write was accepted
+					if ((writeIntRegisterEvent != NULL) && writeIntRegisterEvent(registerId, value)) {
+						publishRegister(registerId, value);
+					}
+					return;
+				}
+			}
+
+			if (messageEvent != NULL) {
+				messageEvent(topic, payload, length);
+			}
+		}
+
+		//--------------------------------------------------------------------------------
+		// Handles a received PUBLISH packet stored in the input buffer.
+		void handlePublish() {
+			if (inputReceived < 2) {
+				return;
+			}
+
+			// The topic must be received completely (packets are stored only up to the buffer size)
+			const uint16_t topicLength = ((uint16_t) inputBuffer[0] << 8) | inputBuffer[1];
+			if (2UL + topicLength > inputReceived) {
+				return;
+			}
+
+			const uint8_t qos = (inputHeader >> 1) & 0x03;
+			const unsigned long headerLength = 2UL + topicLength + ((qos > 0) ? 2 : 0);
+			if (headerLength > inputReceived) {
+				return;
+			}
+
+			// Acknowledge message of QoS 1
+			if (qos == 1) {
+				output.beginPacket(MQTT_PUBACK);
+				output.write(inputBuffer + 2 + topicLength, 2);
+				output.endPacket();
+				packetCompleted();
+			}
+
+			// Move the topic to make room for the terminating zero
+			memmove(inputBuffer, inputBuffer + 2, topicLength);
+			inputBuffer[topicLength] = 0;
+			inputBuffer[inputReceived] = 0;
+
+			handleMessage((const char*) inputBuffer, inputBuffer + headerLength, inputReceived - headerLength);
+		}
+
+		//--------------------------------------------------------------------------------
+		// Handles a received packet stored in the input buffer.
+		void handlePacket() {
+			lastReceiveTime = millis();
+			switch (inputHeader & 0xF0) {
+			case MQTT_CONNACK:
+				if ((state == CONNECTING) && (inputReceived >= 2) && (inputBuffer[1] == 0)) {
+					handleConnectionAccepted();
+				} else {
+					disconnect();
+				}
+				break;
+			case MQTT_PUBLISH:
+				if (state == CONNECTED) {
+					handlePublish();
+				}
+				break;
+			case MQTT_PUBACK:
+				if (inputReceived >= 2) {
+					handlePublishAck(((uint16_t) inputBuffer[0] << 8) | inputBuffer[1]);
+				}
+				break;
+			default:
+				// SUBACK and PINGRESP require no action
+				break;
+			}
+		}
+
+		//--------------------------------------------------------------------------------
+		// Receives available packets.
+		void receivePackets() {
+			while ((state != DISCONNECTED) && (client->available() > 0)) {
+				if (inputPhase == PACKET_BODY) {
+					// Receive the body (bytes beyond the buffer are discarded)
+					uint8_t discardBuffer[16];
+					const unsigned long remaining = inputRemaining - inputReceived;
+					int readBytes;
+					if (inputReceived < (unsigned long) INPUT_BUFFER_SIZE) {
+						const unsigned long space = INPUT_BUFFER_SIZE - inputReceived;
+						readBytes = client->read(inputBuffer + inputReceived, (remaining < space) ? remaining : space);
+					} else {
+						readBytes = client->read(discardBuffer, (remaining < sizeof(discardBuffer)) ? remaining : sizeof(discardBuffer));
+					}
+
+					if (readBytes <= 0) {
+						break;
+					}
+
+					inputReceived += readBytes;
+				} else {
+					const int c = client->read();
+					if (c < 0) {
+						break;
+					}
+
+					if (inputPhase == FIXED_HEADER) {
+						inputHeader = c;
+						inputRemaining = 0;
+						inputMultiplier = 1;
+						inputReceived = 0;
+						inputPhase = REMAINING_LENGTH;
+						continue;
+					}
+
+					inputRemaining += (c & 0x7F) * inputMultiplier;
+					inputMultiplier *= 128;
+					if (c & 0x80) {
+						continue;
+					}
+
+					inputPhase = PACKET_BODY;
+				}
+
+				if (inputReceived == inputRemaining) {
+					inputPhase = FIXED_HEADER;
+					if (inputRemaining <= (unsigned long) INPUT_BUFFER_SIZE) {
+						handlePacket();
+					} else {
+						// Too long packet is ignored
+						lastReceiveTime = millis();
+					}
+				}
+			}
+		}
+
+		//--------------------------------------------------------------------------------
+		// Starts a PUBLISH packet.
+		Print* startPublish(uint8_t qos, bool retain) {
+			if ((client == NULL) || (qos > 1)) {
+				return NULL;
+			}
+
+			// Messages of QoS 0 are sent only to connected broker, messages of QoS 1 are
+			// stored until they are acknowledged
+			if ((qos == 0) && (state != CONNECTED)) {
+				return NULL;
+			}
+
+			publishQoS = qos;
+			output.beginPacket(MQTT_PUBLISH | (qos << 1) | (retain ? 0x01 : 0x00));
+			return &output;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Writes identifier of a PUBLISH packet after the topic.
+		void writePublishId() {
+			if (publishQoS > 0) {
+				output.writeUInt16(nextPacketId());
+			}
+		}
+
+		//--------------------------------------------------------------------------------
+		// Completes the PUBLISH packet.
+		bool endPublish() {
+			const int packetLength = output.getPacketLength();
+			if ((publishQoS > 0) && (packetLength > QOS1_BUFFER_SIZE - qos1Length)) {
+				output.discardPacket();
+				return false;
+			}
+
+			if (!output.endPacket()) {
+				return false;
+			}
+
+			publishedMessages++;
+
+			if (publishQoS > 0) {
+				memcpy(qos1Buffer + qos1Length, output.getLastPacket(packetLength), packetLength);
+				qos1Count++;
+				if (state == CONNECTED) {
+					// Stored copy is used only for resending
+					qos1Buffer[qos1Length] |= 0x08;
+					qos1Length += packetLength;
+				} else {
+					// Message is sent after the connection is accepted
+					qos1Length += packetLength;
+					output.reset(client);
+					return true;
+				}
+			}
+
+			packetCompleted();
+			if (output.hasFailed()) {
+				disconnect();
+			}
+			return true;
+		}
+	public:
+		// Event handler called when the connection is accepted by the broker
+		ACPEventHandler connectedEvent;
+
+		// Event handler that processes a received message
+		void (*messageEvent)(const char* topic, const uint8_t* payload, int length);
+
+		// Event handler that writes a register (registry bridge)
+		bool (*writeIntRegisterEvent)(unsigned int registerId, long value);
+
+		//--------------------------------------------------------------------------------
+		// Constructs the controller.
+		MqttClientController() {
+			client = NULL;
+			state = DISCONNECTED;
+			connectedEvent = NULL;
+			messageEvent = NULL;
+			writeIntRegisterEvent = NULL;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Initializes the controller.
+		void init(const __FlashStringHelper* clientId, const __FlashStringHelper* host, uint16_t port, const __FlashStringHelper* username,
+				const __FlashStringHelper* password, unsigned int keepAlive, unsigned long publishDelay, unsigned long reconnectDelay,
+				const __FlashStringHelper* registryTopic) {
+			this->clientId = clientId;
+			this->host = host;
+			this->port = port;
+			this->username = username;
+			this->password = password;
+			this->keepAlive = keepAlive;
+			this->publishDelay = publishDelay;
+			this->reconnectDelay = reconnectDelay;
+			this->registryTopic = registryTopic;
+
+			state = DISCONNECTED;
+			stateTime = millis() - reconnectDelay;
+			outputPending = false;
+			packetId = 0;
+			inputPhase = FIXED_HEADER;
+			qos1Length = 0;
+			qos1Count = 0;
+			publishedMessages = 0;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Publishes value of a register (registry bridge).
+		bool publishRegister(unsigned int registerId, long value) {
+			if (registryTopic == NULL) {
+				return false;
+			}
+
+			Print* out = startPublish(0, false);
+			if (out == NULL) {
+				return false;
+			}
+
+			// Topic: registryTopic/registerId
+			char idText[8];
+			int idLength = 0;
+			do {
+				idText[idLength++] = '0' + registerId % 10;
+				registerId = registerId / 10;
+			} while (registerId > 0);
+
+			output.writeUInt16(strlen_P(reinterpret_cast<PGM_P>(registryTopic)) + 1 + idLength);
+			out->print(registryTopic);
+			out->print('/');
+			while (idLength > 0) {
+				out->print(idText[--idLength]);
+			}
+			out->print(value);
+			return endPublish();
+		}
+
+		//--------------------------------------------------------------------------------
+		// Looper that maintains the connection and writes coalesced packets.
+		void mqttLooper() {
+			if (client == NULL) {
+				return;
+			}
+
+			unsigned long now = millis();
+			if (state == DISCONNECTED) {
+				if (now - stateTime >= reconnectDelay) {
+					connect();
+				}
+				return;
+			}
+
+			if (!client->connected()) {
+				disconnect();
+				return;
+			}
+
+			receivePackets();
+			if (state == DISCONNECTED) {
+				return;
+			}
+
+			now = millis();
+			if (state == CONNECTING) {
+				// The broker must accept the connection in reasonable time
+				if (now - stateTime >= ((keepAlive > 0) ? keepAlive * 1000UL : reconnectDelay)) {
+					disconnect();
+				}
+				return;
+			}
+
+			if (keepAlive > 0) {
+				// Broker that is silent for one and a half of the keep alive interval is lost
+				if (now - lastReceiveTime >= keepAlive * 1500UL) {
+					disconnect();
+					return;
+				}
+
+				if ((now - lastSendTime >= keepAlive * 1000UL) && !outputPending) {
+					output.beginPacket(MQTT_PINGREQ);
+					output.endPacket();
+					packetCompleted();
+					flushOutput();
+					return;
+				}
+			}
+
+			if (outputPending && (now - outputTime >= publishDelay)) {
+				flushOutput();
+			}
+		}
+	};
+
+	/********************************************************************************
+	 * MQTT client (view)
+	 ********************************************************************************/
+	template<int OUTPUT_BUFFER_SIZE, int INPUT_BUFFER_SIZE, int QOS1_BUFFER_SIZE> class TMqttClient {
+	private:
+		// The controller
+		MqttClientController<OUTPUT_BUFFER_SIZE, INPUT_BUFFER_SIZE, QOS1_BUFFER_SIZE> &controller;
+	public:
+		//--------------------------------------------------------------------------------
+		// Constructs view for the MQTT client.
+		TMqttClient(MqttClientController<OUTPUT_BUFFER_SIZE, INPUT_BUFFER_SIZE, QOS1_BUFFER_SIZE> &controller) :
+				controller(controller) {
+			// Nothing to do
+		}
+
+		//--------------------------------------------------------------------------------
+		// Sets the client (e.g., EthernetClient) used to connect the broker.
+		void setClient(Client* client) {
+			if (controller.client == client) {
+				return;
+			}
+
+			if (controller.client != NULL) {
+				controller.disconnect();
+			}
+
+			controller.client = client;
+			controller.output.reset(client);
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns whether the connection is accepted by the broker.
+		inline bool isConnected() {
+			return controller.state == MqttClientController<OUTPUT_BUFFER_SIZE, INPUT_BUFFER_SIZE, QOS1_BUFFER_SIZE>::CONNECTED;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Starts publishing of a message with given topic and returns the output for the
+		// payload (NULL, if the message cannot be published). Messages of QoS 0 require
+		// a connection, messages of QoS 1 are stored until they are acknowledged.
+		Print* startPublish(const char* topic, uint8_t qos = 0, bool retain = false) {
+			if (controller.startPublish(qos, retain) == NULL) {
+				return NULL;
+			}
+
+			controller.output.writeString(topic);
+			controller.writePublishId();
+			return &controller.output;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Starts publishing of a message with given topic and returns the output for the
+		// payload (NULL, if the message cannot be published).
+		Print* startPublish(const __FlashStringHelper* topic, uint8_t qos = 0, bool retain = false) {
+			if (controller.startPublish(qos, retain) == NULL) {
+				return NULL;
+			}
+
+			controller.output.writeString(topic);
+			controller.writePublishId();
+			return &controller.output;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Completes publishing of the message. Returns false, if the message does not
+		// fit the buffers.
+		inline bool endPublish() {
+			return controller.endPublish();
+		}
+
+		//--------------------------------------------------------------------------------
+		// Publishes a message with textual payload.
+		bool publish(const char* topic, const char* payload, uint8_t qos = 0, bool retain = false) {
+			Print* out = startPublish(topic, qos, retain);
+			if (out == NULL) {
+				return false;
+			}
+
+			out->print(payload);
+			return endPublish();
+		}
+
+		//--------------------------------------------------------------------------------
+		// Publishes a message with textual payload.
+		bool publish(const __FlashStringHelper* topic, const char* payload, uint8_t qos = 0, bool retain = false) {
+			Print* out = startPublish(topic, qos, retain);
+			if (out == NULL) {
+				return false;
+			}
+
+			out->print(payload);
+			return endPublish();
+		}
+
+		//--------------------------------------------------------------------------------
+		// Publishes a message with a number as payload.
+		bool publish(const __FlashStringHelper* topic, long value, uint8_t qos = 0, bool retain = false) {
+			Print* out = startPublish(topic, qos, retain);
+			if (out == NULL) {
+				return false;
+			}
+
+			out->print(value);
+			return endPublish();
+		}
+
+		//--------------------------------------------------------------------------------
+		// Publishes value of a register to topic RegistryTopic/registerId.
+		inline bool publishRegister(unsigned int registerId, long value) {
+			return controller.publishRegister(registerId, value);
+		}
+
+		//--------------------------------------------------------------------------------
+		// Subscribes a topic filter (subscriptions should be renewed in OnConnected).
+		bool subscribe(const __FlashStringHelper* topicFilter, uint8_t qos = 0) {
+			if (!isConnected() || (qos > 1)) {
+				return false;
+			}
+
+			controller.output.beginPacket(MQTT_SUBSCRIBE);
+			controller.output.writeUInt16(controller.nextPacketId());
+			controller.output.writeString(topicFilter);
+			controller.output.write(qos);
+			if (!controller.output.endPacket()) {
+				return false;
+			}
+
+			controller.packetCompleted();
+			return true;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Writes coalesced packets without waiting for the publish delay.
+		inline void flush() {
+			if (isConnected()) {
+				controller.flushOutput();
+			}
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns the number of messages of QoS 1 waiting for acknowledgement.
+		inline int getUnacknowledged() {
+			return controller.qos1Count;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns the number of published messages.
+		inline unsigned long getPublishedMessages() {
+			return controller.publishedMessages;
+		}
+	};
+}
+
+#endif /* MODULES_ACP_NETWORK_MQTT_CLIENT_INCLUDE_MQTTCLIENT_H_ */
@@ -0,0 +1,426 @@
+/********************************************************************************
+ * Load generator for an http server (wrk-style). A fixed number of connections
+ * send GET requests one after another for given duration. With keep-alive,
+ * requests of a connection reuse a persistent connection, otherwise each request
+ * opens a new connection. All connections are served by a single thread with
+ * poll().
+ * The generator reports requests per second and latency percentiles (the
+ * latency includes connecting, if the connection is not kept). A request whose
+ * idle persistent connection was closed by the server is repeated on a new
+ * connection and counted as a reconnect.
+ *
+ * Usage: HttpLoadGenerator host port path [-c connections] [-d seconds] [-k]
+ ********************************************************************************/
+
+#include <HostCore.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Timeout of a request in nanoseconds
+static const uint64_t TIMEOUT = 5000000000ULL;
+
+// States of reading a response
+enum ResponseState {
+	STATUS_LINE, HEADER_LINE, CONTENT, CHUNK_SIZE, CHUNK_DATA, CHUNK_END, TRAILER_LINE, CONTENT_UNTIL_CLOSE, RESPONSE_READ
+};
+
+/********************************************************************************
+ * Connection that repeatedly sends requests and measures their latencies.
+ ********************************************************************************/
+struct Connection {
+	// Socket (-1, if not opened)
+	int fd;
+
+	// Indicates whether the socket is connecting
+	bool connecting;
+
+	// Indicates whether the current request reuses a persistent connection
+	bool reused;
+
+	// Start time of the current request
+	uint64_t startTime;
+
+	// State of reading the response
+	ResponseState state;
+
+	// Current line of the response (status, header or chunk size line)
+	std::string line;
+
+	// Content length (-1, if unknown)
+	long long contentLength;
+
+	// Indicates whether the content is chunked
+	bool chunked;
+
+	// Number of remaining bytes of the content or of the chunk
+	long long remaining;
+
+	// Indicates whether the server keeps the connection after the response
+	bool connectionKept;
+};
+
+// Address of the server
+static struct sockaddr_in address;
+
+// Sent request
+static std::string request;
+
+// Indicates whether persistent connections are used
+static bool keepAlive = false;
+
+// Measured latencies in nanoseconds
+static std::vector<uint64_t> latencies;
+
+// Number of failed requests
+static long errors = 0;
+
+// Number of requests repeated on a new connection, because the server closed the idle
+// persistent connection (e.g., SingleClientServer closes it for a new client)
+static long reconnects = 0;
+
+// Number of received bytes of responses
+static uint64_t receivedBytes = 0;
+
+//--------------------------------------------------------------------------------
+// Closes the socket of a connection.
+static void closeSocket(Connection& connection) {
+	if (connection.fd >= 0) {
+		close(connection.fd);
+		connection.fd = -1;
+	}
+}
+
+//--------------------------------------------------------------------------------
+// Starts reading of a response.
+static void startResponse(Connection& connection) {
+	connection.state = STATUS_LINE;
+	connection.line.clear();
+	connection.contentLength = -1;
+	connection.chunked = false;
+	connection.remaining = 0;
+	connection.connectionKept = false;
+}
+
+//--------------------------------------------------------------------------------
+// Sends the request. Returns false, if sending failed.
+static bool sendRequest(Connection& connection) {
+	startResponse(connection);
+	size_t sent = 0;
+	while (sent < request.length()) {
+		const ssize_t result = send(connection.fd, request.data() + sent, request.length() - sent, MSG_NOSIGNAL);
+		if (result < 0) {
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR)) {
+				continue;
+			}
+			return false;
+		}
+		sent += result;
+	}
+
+	return true;
+}
+
+//--------------------------------------------------------------------------------
+// Sends the current request of a connection (opens the socket, if necessary).
+static void sendOrConnect(Connection& connection) {
+	connection.reused = (connection.fd >= 0);
+	if (connection.fd >= 0) {
+		connection.connecting = false;
+		if (!sendRequest(connection)) {
+			reconnects++;
+			closeSocket(connection);
+			sendOrConnect(connection);
+		}
+		return;
+	}
+
+	connection.fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (connection.fd < 0) {
+		perror("socket");
+		exit(1);
+	}
+
+	int enabled = 1;
+	setsockopt(connection.fd, IPPROTO_TCP, TCP_NODELAY, &enabled, sizeof(enabled));
+	fcntl(connection.fd, F_SETFL, fcntl(connection.fd, F_GETFL) | O_NONBLOCK);
+	connection.connecting = true;
+	if ((connect(connection.fd, (struct sockaddr*) &address, sizeof(address)) != 0) && (errno != EINPROGRESS)) {
+		errors++;
+		closeSocket(connection);
+	}
+}
+
+//--------------------------------------------------------------------------------
+// Starts a new request of a connection.
+static void startRequest(Connection& connection) {
+	connection.startTime = hostNanos();
+	sendOrConnect(connection);
+}
+
+//--------------------------------------------------------------------------------
+// Processes a header line of the response.
+static void processHeader(Connection& connection) {
+	const size_t colonIdx = connection.line.find(':');
+	if (colonIdx == std::string::npos) {
+		return;
+	}
+
+	std::string name = connection.line.substr(0, colonIdx);
+	std::string value = connection.line.substr(colonIdx + 1);
+	std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+	std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+	if (name == "content-length") {
+		connection.contentLength = atoll(value.c_str());
+	} else if (name == "transfer-encoding") {
+		connection.chunked = (value.find("chunked") != std::string::npos);
+	} else if (name == "connection") {
+		connection.connectionKept = (value.find("keep-alive") != std::string::npos);
+	}
+}
+
+//--------------------------------------------------------------------------------
+// Processes a completed line of the response. Returns false, if the response is
+// not valid.
+static bool processLine(Connection& connection) {
+	switch (connection.state) {
+	case STATUS_LINE:
+		if ((connection.line.compare(0, 5, "HTTP/") != 0) || (connection.line.length() < 10)
+				|| (connection.line[9] != '2')) {
+			fprintf(stderr, "Unexpected status: %s\n", connection.line.c_str());
+			return false;
+		}
+		connection.connectionKept = (connection.line.compare(0, 9, "HTTP/1.1 ") == 0);
+		connection.state = HEADER_LINE;
+		break;
+	case HEADER_LINE:
+		if (!connection.line.empty()) {
+			processHeader(connection);
+		} else if (connection.chunked) {
+			connection.state = CHUNK_SIZE;
+		} else if (connection.contentLength >= 0) {
+			connection.remaining = connection.contentLength;
+			connection.state = (connection.remaining > 0) ? CONTENT : RESPONSE_READ;
+		} else {
+			connection.connectionKept = false;
+			connection.state = CONTENT_UNTIL_CLOSE;
+		}
+		break;
+	case CHUNK_SIZE:
+		connection.remaining = strtoll(connection.line.c_str(), NULL, 16);
+		connection.state = (connection.remaining > 0) ? CHUNK_DATA : TRAILER_LINE;
+		break;
+	case CHUNK_END:
+		connection.state = CHUNK_SIZE;
+		break;
+	case TRAILER_LINE:
+		if (connection.line.empty()) {
+			connection.state = RESPONSE_READ;
+		}
+		break;
+	default:
+		break;
+	}
+
+	connection.line.clear();
+	return true;
+}
+
+//--------------------------------------------------------------------------------
+// Processes received bytes of the response. Returns false, if the response is not
+// valid.
+static bool processData(Connection& connection, const char* data, size_t length) {
+	receivedBytes += length;
+	const char* const dataEnd = data + length;
+	while ((data != dataEnd) && (connection.state != RESPONSE_READ)) {
+		switch (connection.state) {
+		case CONTENT:
+		case CHUNK_DATA: {
+			const long long count = std::min<long long>(connection.remaining, dataEnd - data);
+			data += count;
+			connection.remaining -= count;
+			if (connection.remaining == 0) {
+				connection.state = (connection.state == CONTENT) ? RESPONSE_READ : CHUNK_END;
+			}
+			break;
+		}
+		case CONTENT_UNTIL_CLOSE:
+			data = dataEnd;
+			break;
+		default:
+			if (*data == '\n') {
+				if (!processLine(connection)) {
+					return false;
+				}
+			} else if (*data != '\r') {
+				connection.line += *data;
+			}
+			data++;
+			break;
+		}
+	}
+
+	return true;
+}
+
+//--------------------------------------------------------------------------------
+// Completes the current request of a connection and starts the next one.
+static void completeRequest(Connection& connection, bool succeeded) {
+	if (succeeded) {
+		latencies.push_back(hostNanos() - connection.startTime);
+	} else {
+		errors++;
+	}
+
+	if (!succeeded || !keepAlive || !connection.connectionKept) {
+		closeSocket(connection);
+	}
+	startRequest(connection);
+}
+
+//--------------------------------------------------------------------------------
+// Processes a poll event of a connection.
+static void processEvent(Connection& connection) {
+	if (connection.connecting) {
+		int error = 0;
+		socklen_t errorLength = sizeof(error);
+		getsockopt(connection.fd, SOL_SOCKET, SO_ERROR, &error, &errorLength);
+		connection.connecting = false;
+		if ((error != 0) || !sendRequest(connection)) {
+			completeRequest(connection, false);
+		}
+		return;
+	}
+
+	char buffer[16384];
+	const ssize_t length = recv(connection.fd, buffer, sizeof(buffer), 0);
+	if (length > 0) {
+		if (!processData(connection, buffer, length)) {
+			completeRequest(connection, false);
+		} else if (connection.state == RESPONSE_READ) {
+			completeRequest(connection, true);
+		}
+	} else if ((length == 0) || ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))) {
+		if (connection.reused && (connection.state == STATUS_LINE) && connection.line.empty()) {
+			// The idle persistent connection was closed, the request is repeated
+			reconnects++;
+			closeSocket(connection);
+			sendOrConnect(connection);
+			return;
+		}
+
+		// Closed connection completes only the content terminated by closing
+		completeRequest(connection, (length == 0) && (connection.state == CONTENT_UNTIL_CLOSE));
+	}
+}
+
+int main(int argc, char* argv[]) {
+	if (argc < 4) {
+		printf("Usage: HttpLoadGenerator host port path [-c connections] [-d seconds] [-k]\n");
+		return 1;
+	}
+
+	int connectionCount = 1;
+	int duration = 10;
+	for (int i = 4; i < argc; i++) {
+		if (strcmp(argv[i], "-k") == 0) {
+			keepAlive = true;
+		} else if ((strcmp(argv[i], "-c") == 0) && (i + 1 < argc)) {
+			connectionCount = std::max(atoi(argv[++i]), 1);
+		} else if ((strcmp(argv[i], "-d") == 0) && (i + 1 < argc)) {
+			duration = atoi(argv[++i]);
+		} else {
+			printf("Unknown option: %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	// Resolve the address of the server
+	struct addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	struct addrinfo* result;
+	if (getaddrinfo(argv[1], NULL, &hints, &result) != 0) {
+		printf("Unknown host: %s\n", argv[1]);
+		return 1;
+	}
+	address = *(struct sockaddr_in*) result->ai_addr;
+	address.sin_port = htons(atoi(argv[2]));
+	freeaddrinfo(result);
+
+	request = std::string("GET ") + argv[3] + " HTTP/1.1\r\nHost: " + argv[1] + "\r\nConnection: "
+			+ (keepAlive ? "keep-alive" : "close") + "\r\n\r\n";
+
+	// Run the load
+	std::vector<Connection> connections(connectionCount);
+	std::vector<struct pollfd> pollFds(connectionCount);
+	const uint64_t startTime = hostNanos();
+	const uint64_t endTime = startTime + (uint64_t) duration * 1000000000ULL;
+	for (int i = 0; i < connectionCount; i++) {
+		connections[i].fd = -1;
+		startRequest(connections[i]);
+	}
+
+	uint64_t now;
+	while ((now = hostNanos()) < endTime) {
+		for (int i = 0; i < connectionCount; i++) {
+			Connection& connection = connections[i];
+			if (connection.fd < 0) {
+				startRequest(connection);
+			} else if (now - connection.startTime > TIMEOUT) {
+				completeRequest(connection, false);
+			}
+
+			pollFds[i].fd = connection.fd;
+			pollFds[i].events = connection.connecting ? POLLOUT : POLLIN;
+			pollFds[i].revents = 0;
+		}
+
+		if (poll(pollFds.data(), connectionCount, 100) <= 0) {
+			continue;
+		}
+
+		for (int i = 0; i < connectionCount; i++) {
+			if ((pollFds[i].revents != 0) && (pollFds[i].fd == connections[i].fd)) {
+				processEvent(connections[i]);
+			}
+		}
+	}
+	const double elapsedSeconds = (hostNanos() - startTime) / 1e9;
+
+	for (int i = 0; i < connectionCount; i++) {
+		closeSocket(connections[i]);
+	}
+
+	// Report
+	std::sort(latencies.begin(), latencies.end());
+	const size_t requestCount = latencies.size();
+	printf("Target:      http://%s:%s%s\n", argv[1], argv[2], argv[3]);
+	printf("Connections: %d%s\n", connectionCount, keepAlive ? " (keep-alive)" : " (connection per request)");
+	printf("Duration:    %.2f s\n", elapsedSeconds);
+	printf("Requests:    %zu (%ld errors, %ld reconnects)\n", requestCount, errors, reconnects);
+	printf("Requests/s:  %.2f\n", requestCount / elapsedSeconds);
+	printf("Transfer/s:  %.2f kB\n", receivedBytes / elapsedSeconds / 1024);
+	if (requestCount > 0) {
+		printf("Latency:\n");
+		const int percentiles[] = { 50, 75, 90, 99 };
+		for (unsigned int i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); i++) {
+			const long idx = (long) ((percentiles[i] * requestCount + 99) / 100) - 1;
+			printf("  p%-4d %10.3f ms\n", percentiles[i], latencies[std::max(idx, 0L)] / 1e6);
+		}
+		printf("  max   %10.3f ms\n", latencies[requestCount - 1] / 1e6);
+	}
+
+	return 0;
+}
@@ -0,0 +1,90 @@
+/********************************************************************************
+ * Host build of TSimpleHttpClientHandler served by SingleClientServer or
+ * MultiClientServer on a POSIX socket (see PosixNetwork.h), as a target of
+ * HttpLoadGenerator. The simulated clock follows the real time (delay() of the
+ * handler does not sleep, it only moves the simulated clock forward).
+ *
+ * Usage: HttpLoadServer [port] [single|multi]
+ *
+ * Paths: /chunked  content of unknown length (1 KB, chunked for HTTP/1.1)
+ *        other     small content with known length
+ ********************************************************************************/
+
+#include <acp/network/simple_http_client_handler/SimpleHttpClientHandler.h>
+#include <acp/network/libs/handling_servers/Servers.h>
+#include <HostCore.h>
+#include <PosixNetwork.h>
+#include <signal.h>
+#include <stdio.h>
+
+using namespace acp_network_simple_http_client_handler;
+
+// Number of concurrently served connections of the multi client server
+#define MAX_CONNECTIONS 4
+
+SimpleHttpHandlingController<512, 3000, 256, MAX_CONNECTIONS> controller;
+TSimpleHttpClientHandler<512, 3000, 256, MAX_CONNECTIONS> handler(controller);
+
+// Indicates whether the server runs (cleared by SIGINT or SIGTERM)
+static volatile sig_atomic_t running = 1;
+
+//--------------------------------------------------------------------------------
+// Stops the server.
+static void stopServer(int) {
+	running = 0;
+}
+
+//--------------------------------------------------------------------------------
+// Produces the response of a path.
+void processRequest(HttpRequest& request, HttpResponse& response) {
+	if (strcmp(request.getUrl(), "/chunked") == 0) {
+		Print* out = response.startContent("text/plain");
+		for (int i = 0; i < 16; i++) {
+			out->print(F("0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcde\n"));
+		}
+		return;
+	}
+
+	response.setContentLength(13);
+	response.startContent("text/plain")->print(F("Hello, world!"));
+}
+
+//--------------------------------------------------------------------------------
+// Runs a server until it is stopped.
+template<class SERVER> static int run(SERVER& server) {
+	server.init();
+	if (!server.listening()) {
+		perror("HttpLoadServer");
+		return 1;
+	}
+
+	while (running) {
+		hostSyncClock();
+		server.loop();
+		server.wait(1);
+	}
+
+	server.finalize();
+	return 0;
+}
+
+int main(int argc, char* argv[]) {
+	const uint16_t port = (argc > 1) ? atoi(argv[1]) : 8080;
+	const bool multi = (argc > 2) && (strcmp(argv[2], "multi") == 0);
+
+	signal(SIGINT, stopServer);
+	signal(SIGTERM, stopServer);
+
+	controller.processRequestEvent = processRequest;
+	controller.init(NULL, false, 5000, 100, 0, 0);
+	printf("Listening at port %u (%s client server)\n", port, multi ? "multi" : "single");
+	fflush(stdout);
+
+	if (multi) {
+		static MultiClientServer<PosixServer, PosixClient, MAX_CONNECTIONS> server(port, handler);
+		return run(server);
+	}
+
+	static SingleClientServer<PosixServer, PosixClient> server(port, handler);
+	return run(server);
+}
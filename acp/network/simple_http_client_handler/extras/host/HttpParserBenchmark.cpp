@@ -0,0 +1,109 @@
+/********************************************************************************
+ * Benchmark of the request parser of TSimpleHttpClientHandler: requests per
+ * second versus the number of header fields. Requests are parsed from memory
+ * either at once or delivered in 64-byte segments (the handler is advanced
+ * after each segment), for a small and a large request buffer.
+ ********************************************************************************/
+
+#include <acp/network/simple_http_client_handler/SimpleHttpClientHandler.h>
+#include <HostCore.h>
+#include <MemoryClient.h>
+#include <stdio.h>
+
+using namespace acp_network_simple_http_client_handler;
+
+SimpleHttpHandlingController<256, 3000, 64, 1> smallController;
+TSimpleHttpClientHandler<256, 3000, 64, 1> smallHandler(smallController);
+
+SimpleHttpHandlingController<2048, 3000, 64, 1> largeController;
+TSimpleHttpClientHandler<2048, 3000, 64, 1> largeHandler(largeController);
+
+// Number of GET parameters seen by the request handler (prevents optimizing out)
+static long seenParameters = 0;
+
+//--------------------------------------------------------------------------------
+// Produces a small response with the url.
+void processRequest(HttpRequest& request, HttpResponse& response) {
+	while (request.hasNextGetParameter()) {
+		request.nextGetParameter();
+		seenParameters++;
+	}
+
+	response.setContentLength(2);
+	response.startContent("text/plain")->print("OK");
+}
+
+//--------------------------------------------------------------------------------
+// Creates a GET request with given number of header fields.
+static int createRequest(char* buffer, int bufferSize, int headerCount) {
+	int length = snprintf(buffer, bufferSize,
+			"GET /sensors/temperature?id=12&format=json HTTP/1.1\r\nHost: 192.168.1.10\r\n");
+	for (int i = 0; i < headerCount; i++) {
+		length += snprintf(buffer + length, bufferSize - length,
+				"X-Header-%d: value-%d-abcdefghijklmnop\r\n", i, i);
+		if (i == headerCount / 2) {
+			length += snprintf(buffer + length, bufferSize - length,
+					"Origin: http://example.org\r\n");
+		}
+	}
+	length += snprintf(buffer + length, bufferSize - length, "\r\n");
+	return length;
+}
+
+//--------------------------------------------------------------------------------
+// Measures requests per second of a handler for a request.
+template<class HANDLER> static double measure(HANDLER& handler,
+		const char* request, int requestLength, int segmentSize, long requests) {
+	MemoryClient<256> client;
+	const uint64_t start = hostNanos();
+	for (long i = 0; i < requests; i++) {
+		if (segmentSize <= 0) {
+			client.reset(request, requestLength);
+			handler.handle(client, true);
+		} else {
+			int delivered = (segmentSize < requestLength) ? segmentSize : requestLength;
+			client.reset(request, delivered);
+			bool alive = handler.advance(client, 0, true);
+			while (alive && (delivered < requestLength)) {
+				delivered += segmentSize;
+				if (delivered > requestLength) {
+					delivered = requestLength;
+				}
+				client.extend(request, delivered);
+				alive = handler.advance(client, 0, false);
+			}
+		}
+
+		if (client.getSentBytes() == 0) {
+			printf("No response\n");
+			exit(1);
+		}
+	}
+
+	return requests / ((hostNanos() - start) / 1e9);
+}
+
+int main() {
+	smallController.processRequestEvent = processRequest;
+	smallController.init(NULL, true, 0, 1, 0, 0);
+	largeController.processRequestEvent = processRequest;
+	largeController.init(NULL, true, 0, 1, 0, 0);
+
+	const long requests = 200000;
+	const int headerCounts[] = { 0, 5, 10, 20, 40 };
+	char request[4096];
+
+	printf("%8s %8s %14s %14s %14s %14s\n", "headers", "bytes", "256 B at once",
+			"256 B 64 B seg", "2 KB at once", "2 KB 64 B seg");
+	for (unsigned int i = 0; i < sizeof(headerCounts) / sizeof(headerCounts[0]); i++) {
+		const int length = createRequest(request, sizeof(request), headerCounts[i]);
+		printf("%8d %8d %14.0f %14.0f %14.0f %14.0f\n", headerCounts[i], length,
+				measure(smallHandler, request, length, 0, requests),
+				measure(smallHandler, request, length, 64, requests),
+				measure(largeHandler, request, length, 0, requests),
+				measure(largeHandler, request, length, 64, requests));
+	}
+
+	printf("(requests/s, %ld GET parameters seen)\n", seenParameters);
+	return 0;
+}
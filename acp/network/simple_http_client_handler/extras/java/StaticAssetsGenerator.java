@@ -0,0 +1,383 @@
+package net.acprog.modules.network;
+
+import java.io.ByteArrayOutputStream;
+import java.io.File;
+import java.io.IOException;
+import java.io.PrintWriter;
+import java.nio.charset.StandardCharsets;
+import java.nio.file.Files;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.Collections;
+import java.util.Comparator;
+import java.util.HashMap;
+import java.util.LinkedHashMap;
+import java.util.List;
+import java.util.Map;
+import java.util.zip.CRC32;
+import java.util.zip.GZIPOutputStream;
+
+/**
+ * Generator of a C++ header with a table of static assets (HttpStaticAsset)
+ * stored in flash memory. All files in a web directory are included. Textual
+ * files are stored gzipped, if the compression reduces their size. The entity
+ * tag of an asset is computed from the stored content. A file index.html is
+ * also available at the path of its directory.
+ * 
+ * A gzipped asset is stored only in the compressed form. The responder answers
+ * a client that does not accept gzip (no gzip in Accept-Encoding or gzip with
+ * quality value 0) with 406 Not Acceptable. Browsers accept gzip, command line
+ * clients may require an option (e.g., curl --compressed).
+ *
+ * Usage: StaticAssetsGenerator webDirectory outputHeader [tableName]
+ */
+public class StaticAssetsGenerator {
+
+	/**
+	 * Generated asset.
+	 */
+	private static final class Asset {
+		/**
+		 * Path of the asset.
+		 */
+		final String path;
+
+		/**
+		 * Index of the stored content.
+		 */
+		final int contentIdx;
+
+		/**
+		 * Constructs an asset.
+		 *
+		 * @param path
+		 *            the path of asset.
+		 * @param contentIdx
+		 *            the index of stored content.
+		 */
+		Asset(String path, int contentIdx) {
+			this.path = path;
+			this.contentIdx = contentIdx;
+		}
+	}
+
+	/**
+	 * Stored content of a file.
+	 */
+	private static final class Content {
+		/**
+		 * Content type.
+		 */
+		final String contentType;
+
+		/**
+		 * Stored (possibly gzipped) bytes.
+		 */
+		final byte[] data;
+
+		/**
+		 * Indicates whether the data are gzipped.
+		 */
+		final boolean gzipped;
+
+		/**
+		 * Constructs a stored content.
+		 *
+		 * @param contentType
+		 *            the content type.
+		 * @param data
+		 *            the stored bytes.
+		 * @param gzipped
+		 *            true, if the data are gzipped, false otherwise.
+		 */
+		Content(String contentType, byte[] data, boolean gzipped) {
+			this.contentType = contentType;
+			this.data = data;
+			this.gzipped = gzipped;
+		}
+	}
+
+	/**
+	 * Content types of file extensions.
+	 */
+	private final static Map<String, String> CONTENT_TYPES = new HashMap<String, String>();
+
+	/**
+	 * Content types that are stored gzipped.
+	 */
+	private final static List<String> COMPRESSIBLE_TYPES = Arrays.asList("text/html", "text/css",
+			"application/javascript", "application/json", "image/svg+xml", "text/plain", "text/csv", "application/xml");
+
+	/**
+	 * Maximal number of bytes printed on a line of the generated header.
+	 */
+	private final static int BYTES_PER_LINE = 16;
+
+	static {
+		CONTENT_TYPES.put("html", "text/html");
+		CONTENT_TYPES.put("htm", "text/html");
+		CONTENT_TYPES.put("css", "text/css");
+		CONTENT_TYPES.put("js", "application/javascript");
+		CONTENT_TYPES.put("json", "application/json");
+		CONTENT_TYPES.put("svg", "image/svg+xml");
+		CONTENT_TYPES.put("txt", "text/plain");
+		CONTENT_TYPES.put("csv", "text/csv");
+		CONTENT_TYPES.put("xml", "application/xml");
+		CONTENT_TYPES.put("png", "image/png");
+		CONTENT_TYPES.put("jpg", "image/jpeg");
+		CONTENT_TYPES.put("jpeg", "image/jpeg");
+		CONTENT_TYPES.put("gif", "image/gif");
+		CONTENT_TYPES.put("ico", "image/x-icon");
+		CONTENT_TYPES.put("woff", "font/woff");
+		CONTENT_TYPES.put("woff2", "font/woff2");
+	}
+
+	/**
+	 * Stored contents.
+	 */
+	private final List<Content> contents = new ArrayList<Content>();
+
+	/**
+	 * Generated assets.
+	 */
+	private final List<Asset> assets = new ArrayList<Asset>();
+
+	/**
+	 * Adds all files in a directory (and its subdirectories) as assets.
+	 *
+	 * @param directory
+	 *            the directory.
+	 * @param path
+	 *            the path of the directory (ends with slash).
+	 * @throws IOException
+	 *             if reading of a file failed.
+	 */
+	public void addDirectory(File directory, String path) throws IOException {
+		File[] files = directory.listFiles();
+		if (files == null) {
+			throw new IOException("Directory " + directory + " cannot be read.");
+		}
+
+		Arrays.sort(files);
+		for (File file : files) {
+			if (file.isHidden()) {
+				continue;
+			}
+
+			if (file.isDirectory()) {
+				addDirectory(file, path + file.getName() + "/");
+			} else {
+				addFile(file, path + file.getName());
+				if (file.getName().equals("index.html")) {
+					assets.add(new Asset(path, contents.size() - 1));
+				}
+			}
+		}
+	}
+
+	/**
+	 * Adds a file as an asset.
+	 *
+	 * @param file
+	 *            the file.
+	 * @param path
+	 *            the path of asset.
+	 * @throws IOException
+	 *             if reading of the file failed.
+	 */
+	public void addFile(File file, String path) throws IOException {
+		byte[] data = Files.readAllBytes(file.toPath());
+		String contentType = getContentType(file.getName());
+
+		// Compress textual content
+		boolean gzipped = false;
+		if (COMPRESSIBLE_TYPES.contains(contentType)) {
+			byte[] compressedData = gzip(data);
+			if (compressedData.length < data.length) {
+				data = compressedData;
+				gzipped = true;
+			}
+		}
+
+		contents.add(new Content(contentType, data, gzipped));
+		assets.add(new Asset(path, contents.size() - 1));
+	}
+
+	/**
+	 * Writes the header with the table of assets.
+	 *
+	 * @param output
+	 *            the output header file.
+	 * @param tableName
+	 *            the name of generated table.
+	 * @throws IOException
+	 *             if writing of the header failed.
+	 */
+	public void writeHeader(File output, String tableName) throws IOException {
+		// Assets are sorted by paths in order of strcmp (bytes of UTF-8 encoding)
+		List<Asset> sortedAssets = new ArrayList<Asset>(assets);
+		Collections.sort(sortedAssets, new Comparator<Asset>() {
+			@Override
+			public int compare(Asset a1, Asset a2) {
+				byte[] p1 = a1.path.getBytes(StandardCharsets.UTF_8);
+				byte[] p2 = a2.path.getBytes(StandardCharsets.UTF_8);
+				for (int i = 0; i < Math.min(p1.length, p2.length); i++) {
+					if (p1[i] != p2[i]) {
+						return (p1[i] & 0xFF) - (p2[i] & 0xFF);
+					}
+				}
+
+				return p1.length - p2.length;
+			}
+		});
+
+		String guard = tableName.toUpperCase() + "_H_";
+		try (PrintWriter out = new PrintWriter(output, "UTF-8")) {
+			out.println("// Generated by StaticAssetsGenerator. Do not edit.");
+			out.println("#ifndef " + guard);
+			out.println("#define " + guard);
+			out.println();
+			out.println("#include <acp/network/simple_http_client_handler/SimpleHttpClientHandler.h>");
+			out.println();
+
+			// Content types
+			Map<String, String> contentTypeNames = new LinkedHashMap<String, String>();
+			for (Content content : contents) {
+				if (!contentTypeNames.containsKey(content.contentType)) {
+					String name = tableName + "_type" + contentTypeNames.size();
+					contentTypeNames.put(content.contentType, name);
+					out.println("static const char " + name + "[] PROGMEM = " + toCString(content.contentType) + ";");
+				}
+			}
+			out.println();
+
+			// Contents and entity tags
+			for (int i = 0; i < contents.size(); i++) {
+				Content content = contents.get(i);
+				out.println("static const char " + tableName + "_etag" + i + "[] PROGMEM = " + toCString(computeETag(content)) + ";");
+				out.print("static const uint8_t " + tableName + "_data" + i + "[] PROGMEM = {");
+				for (int j = 0; j < content.data.length; j++) {
+					if (j % BYTES_PER_LINE == 0) {
+						out.println();
+						out.print("\t");
+					}
+					out.print(String.format("0x%02X", content.data[j] & 0xFF));
+					if (j + 1 < content.data.length) {
+						out.print(j % BYTES_PER_LINE == BYTES_PER_LINE - 1 ? "," : ", ");
+					}
+				}
+				out.println();
+				out.println("};");
+				out.println();
+			}
+
+			// Paths
+			for (int i = 0; i < sortedAssets.size(); i++) {
+				out.println("static const char " + tableName + "_path" + i + "[] PROGMEM = " + toCString(sortedAssets.get(i).path) + ";");
+			}
+			out.println();
+
+			// Table of assets
+			out.println("static const acp_network_simple_http_client_handler::HttpStaticAsset " + tableName + "[] PROGMEM = {");
+			for (int i = 0; i < sortedAssets.size(); i++) {
+				Asset asset = sortedAssets.get(i);
+				Content content = contents.get(asset.contentIdx);
+				out.print("\t{" + tableName + "_path" + i + ", " + contentTypeNames.get(content.contentType) + ", ");
+				out.print(tableName + "_etag" + asset.contentIdx + ", " + tableName + "_data" + asset.contentIdx + ", ");
+				out.print(content.data.length + "UL, ");
+				out.print(content.gzipped ? "acp_network_simple_http_client_handler::HttpStaticAsset::GZIP" : "0");
+				out.println(i + 1 < sortedAssets.size() ? "}," : "}");
+			}
+			out.println("};");
+			out.println();
+			out.println("static const int " + tableName + "Count = " + sortedAssets.size() + ";");
+			out.println();
+			out.println("#endif");
+		}
+	}
+
+	/**
+	 * Returns content type of a file.
+	 *
+	 * @param fileName
+	 *            the name of file.
+	 * @return the content type.
+	 */
+	private static String getContentType(String fileName) {
+		int dotIdx = fileName.lastIndexOf('.');
+		if (dotIdx >= 0) {
+			String contentType = CONTENT_TYPES.get(fileName.substring(dotIdx + 1).toLowerCase());
+			if (contentType != null) {
+				return contentType;
+			}
+		}
+
+		return "application/octet-stream";
+	}
+
+	/**
+	 * Compresses data using gzip.
+	 *
+	 * @param data
+	 *            the data.
+	 * @return the compressed data.
+	 * @throws IOException
+	 *             if compression failed.
+	 */
+	private static byte[] gzip(byte[] data) throws IOException {
+		ByteArrayOutputStream output = new ByteArrayOutputStream();
+		try (GZIPOutputStream gzipOutput = new GZIPOutputStream(output)) {
+			gzipOutput.write(data);
+		}
+
+		return output.toByteArray();
+	}
+
+	/**
+	 * Computes quoted entity tag of a stored content.
+	 *
+	 * @param content
+	 *            the stored content.
+	 * @return the entity tag.
+	 */
+	private static String computeETag(Content content) {
+		CRC32 crc = new CRC32();
+		crc.update(content.data);
+		return String.format("\"%08x-%x\"", crc.getValue(), content.data.length);
+	}
+
+	/**
+	 * Returns a C string literal with given value.
+	 *
+	 * @param value
+	 *            the value.
+	 * @return the string literal.
+	 */
+	private static String toCString(String value) {
+		StringBuilder result = new StringBuilder("\"");
+		for (byte b : value.getBytes(StandardCharsets.UTF_8)) {
+			int c = b & 0xFF;
+			if ((c == '"') || (c == '\\')) {
+				result.append('\\').append((char) c);
+			} else if ((c < 0x20) || (c >= 0x7F)) {
+				result.append(String.format("\\%03o", c));
+			} else {
+				result.append((char) c);
+			}
+		}
+
+		return result.append('"').toString();
+	}
+
+	public static void main(String[] args) throws IOException {
+		if ((args.length < 2) || (args.length > 3)) {
+			System.out.println("Usage: StaticAssetsGenerator webDirectory outputHeader [tableName]");
+			return;
+		}
+
+		String tableName = (args.length == 3) ? args[2] : "webAssets";
+		StaticAssetsGenerator generator = new StaticAssetsGenerator();
+		generator.addDirectory(new File(args[0]), "/");
+		generator.writeHeader(new File(args[1]), tableName);
+	}
+}
@@ -4,14 +4,22 @@
 #include <acp/core.h>
 #include <acp/debug/tracer/Tracer.h>
 #include <acp/network/libs/handling_servers/Servers.h>
+#include <acp/network/libs/format_printers/FormatPrinters.h>
+#include <acp/utils/buffer_pool/BufferPool.h>
 
 #include <Client.h>
+#include <limits.h>
 
 namespace acp_network_simple_http_client_handler {
 
-	template<int BUFFER_SIZE, long TIMEOUT> class TSimpleHttpClientHandler;
-	template<int BUFFER_SIZE, long TIMEOUT> class SimpleHttpHandlingController;
+	template<int BUFFER_SIZE, long TIMEOUT, int OUTPUT_BUFFER_SIZE, int MAX_CONNECTIONS, bool POOLED_BUFFERS = false,
+			int MAX_PARAMETERS = 8> class TSimpleHttpClientHandler;
+	template<int BUFFER_SIZE, long TIMEOUT, int OUTPUT_BUFFER_SIZE, int MAX_CONNECTIONS, bool POOLED_BUFFERS = false,
+			int MAX_PARAMETERS = 8> class SimpleHttpHandlingController;
 	struct RequestProcessingData;
+	class HttpRequest;
+	class HttpResponse;
+	class WebSocket;
 
 	/********************************************************************************
 	 * Configuration of features applied to process an http request
@@ -30,6 +38,13 @@ namespace acp_network_simple_http_client_handler {
 		const __FlashStringHelper* authentication;
 		// Indicates whether CORS (Cross-origin resource sharing) is enabled
 		bool enableCORS;
+		// Indicates whether entity tags of the If-None-Match header are retrieved from the request
+		// Usage: saving memory
+		bool storeIfNoneMatch;
+		// Indicates whether the request body is passed to the application in chunks as it
+		// is received (post parameters are not stored)
+		// Usage: receiving bodies larger than the request buffer
+		bool streamBody;
 	};
 
 	/********************************************************************************
@@ -81,7 +96,7 @@ namespace acp_network_simple_http_client_handler {
 	{
 		enum Type
 		{
-			GET, POST, OPTIONS
+			GET, POST, OPTIONS, PUT, DELETE
 		};
 		Type t_;
 		HttpMethod(Type t) : t_(t) {}
@@ -110,17 +125,91 @@ namespace acp_network_simple_http_client_handler {
 		// Origin header (usually sent in CORS requests)
 		const char* originHeader;
 		// Content-length header (negative number if not set in http headers)
-		int contentLength;
+		long contentLength;
+		// Indicates whether the client requests a persistent connection
+		bool keepAlive;
+		// Indicates whether the request uses HTTP/1.1 protocol
+		bool http11;
+		// If-None-Match header (entity tags of cached content)
+		const char* ifNoneMatchHeader;
+		// Indicates whether the client accepts gzip content coding
+		bool acceptsGzip;
+		// Indicates whether the client requests upgrade to the WebSocket protocol
+		bool webSocketUpgrade;
+		// Sec-WebSocket-Key header (key of the WebSocket opening handshake)
+		const char* webSocketKey;
+		// First byte position of the requested range (negative for a suffix range or if no range is requested)
+		long rangeFirst;
+		// Last byte position of the requested range (length of a suffix range, negative for an open range or if no range is requested)
+		long rangeLast;
+
+		// Index of decoded GET and POST parameters (see HttpRequest::getParameter)
+		HttpParameter* parameters;
+		// Capacity of the index of parameters
+		uint8_t parameterCapacity;
+		// Number of indexed parameters (negative, if the parameters are not indexed)
+		int8_t parameterCount;
+		// Indicates whether some parameters did not fit the index
+		bool parameterOverflow;
 
 		// Receive buffer
 		uint8_t* buffer;
 		// Size of buffer
 		int bufferSize;
-		// Number of unprocessed received bytes stored in received buffer.
+		// Number of received bytes stored in receive buffer.
 		int bufferedBytes;
+		// Position of the first unprocessed byte in receive buffer (bytes before the read
+		// position are processed and released when the buffer is full).
+		int readPosition;
+
+		// Constructor with default values
+		RequestProcessingData():method(HttpMethod::GET), url(NULL), getParameters(NULL), postParameters(NULL), originHeader(NULL), contentLength(-1),
+				keepAlive(false), http11(false), ifNoneMatchHeader(NULL), acceptsGzip(false), webSocketUpgrade(false), webSocketKey(NULL),
+				rangeFirst(-1), rangeLast(-1), parameters(NULL), parameterCapacity(0), parameterCount(-1), parameterOverflow(false) {}
+
+		//--------------------------------------------------------------------------------
+		// Returns whether the client requests upgrade to the WebSocket protocol
+		inline bool isWebSocketUpgrade() const {
+			return webSocketUpgrade && (webSocketKey != NULL) && http11 && (method == HttpMethod::GET);
+		}
+	};
+
+	/********************************************************************************
+	 * Internal state of a connection served by the http client handler
+	 ********************************************************************************/
+	struct ConnectionState {
+		// Phase of request processing
+		enum Phase {IDLE, REQUEST_LINE, HEADER_FIELDS, SKIP_LINE, CONTENT, STREAMED_BODY, EVENT_STREAM, WEB_SOCKET} phase;
+		// Data retrieved from the request
+		RequestProcessingData requestData;
+		// Features applied to process the request
+		Features features;
+		// Indicates whether the request is authenticated
+		bool authenticated;
+		// Number of requests served over the connection
+		uint8_t servedRequests;
+		// Time when the connection became idle (waiting for the next request)
+		unsigned long idleStartTime;
+		// Time of the last progress in receiving the request (used to detect timeout)
+		unsigned long activityTime;
+		// Number of bytes of a streamed body that have not been received yet
+		unsigned long remainingBodyBytes;
+		// Sequence number of the last event published to an event stream
+		unsigned long eventSequence;
+		// Opcode of the first frame of a fragmented WebSocket message (0, if no message is received)
+		uint8_t webSocketOpcode;
+		// Time in microseconds when the current phase started (used by metrics)
+		unsigned long phaseStartTime;
+		// Buffer for storing all request related data (URL, parameters, etc.)
+		uint8_t* requestBuffer;
+		// Storage of the index of request parameters
+		HttpParameter* parameterIndex;
+		// Handler of the route matching the request (NULL, if no route matches)
+		void (*routeHandler)(HttpRequest& request, HttpResponse& response);
 
 		// Constructor with default values
-		RequestProcessingData():url(NULL), getParameters(NULL), postParameters(NULL), method(HttpMethod::GET), originHeader(NULL), contentLength(-1) {}
+		ConnectionState():phase(IDLE), authenticated(false), servedRequests(0), idleStartTime(0), activityTime(0), remainingBodyBytes(0),
+				eventSequence(0), webSocketOpcode(0), phaseStartTime(0), requestBuffer(NULL), parameterIndex(NULL), routeHandler(NULL) {}
 	};
 
 	/********************************************************************************
@@ -225,6 +314,113 @@ namespace acp_network_simple_http_client_handler {
 
 			return result;
 		}
+
+		//--------------------------------------------------------------------------------
+		// Decodes parameters of a query string to the index (while the index is not full).
+		// Parameters that do not fit the index are marked as an overflow of the index.
+		void indexParameters(char* &queryString) {
+			while ((queryString != NULL) && (*queryString != 0)) {
+				if (requestData.parameterCount >= requestData.parameterCapacity) {
+					requestData.parameterOverflow = true;
+					return;
+				}
+
+				requestData.parameters[requestData.parameterCount] = decodeNextParameter(queryString);
+				requestData.parameterCount++;
+			}
+		}
+
+		//--------------------------------------------------------------------------------
+		// Decodes unprocessed GET and POST parameters to the index in one pass, if they
+		// are not indexed yet.
+		void ensureIndexedParameters() {
+			if (requestData.parameterCount < 0) {
+				requestData.parameterCount = 0;
+				indexParameters(requestData.getParameters);
+				indexParameters(requestData.postParameters);
+			}
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns indexed parameter with given name or NULL, if there is no such parameter.
+		// Unprocessed parameters are decoded to the index in one pass when the method is
+		// invoked for the first time.
+		template<typename STRING> HttpParameter* findParameter(STRING name) {
+			ensureIndexedParameters();
+			for (int i = 0; i < requestData.parameterCount; i++) {
+				if (requestData.parameters[i].nameEquals(name)) {
+					return &requestData.parameters[i];
+				}
+			}
+
+			return NULL;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Parses integer value of a parameter.
+		template<typename STRING> long parseInt(STRING name, long defaultValue) {
+			const HttpParameter* parameter = findParameter(name);
+			if (parameter == NULL) {
+				return defaultValue;
+			}
+
+			const char* valuePtr = parameter->value;
+			const bool negative = (*valuePtr == '-');
+			if ((*valuePtr == '-') || (*valuePtr == '+')) {
+				valuePtr++;
+			}
+
+			if (*valuePtr == 0) {
+				return defaultValue;
+			}
+
+			// Values out of range of the long type are not valid
+			const unsigned long limit = negative ? (unsigned long)LONG_MAX + 1 : (unsigned long)LONG_MAX;
+			unsigned long result = 0;
+			while (*valuePtr != 0) {
+				if ((*valuePtr < '0') || (*valuePtr > '9')) {
+					return defaultValue;
+				}
+
+				const int digit = *valuePtr - '0';
+				if (result > (limit - digit) / 10) {
+					return defaultValue;
+				}
+
+				result = result * 10 + digit;
+				valuePtr++;
+			}
+
+			return negative ? (long)(0 - result) : (long)result;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns whether a string is equal to a string stored in flash memory.
+		static bool equalsFString(const char* str, const __FlashStringHelper* fstr) {
+			return (strcmp_P(str, reinterpret_cast<PGM_P>(fstr)) == 0);
+		}
+
+		//--------------------------------------------------------------------------------
+		// Parses boolean value of a parameter.
+		template<typename STRING> bool parseBool(STRING name, bool defaultValue) {
+			const HttpParameter* parameter = findParameter(name);
+			if (parameter == NULL) {
+				return defaultValue;
+			}
+
+			// Parameter without value (e.g., a flag) is true
+			const char* value = parameter->value;
+			if ((*value == 0) || equalsFString(value, F("1")) || equalsFString(value, F("true")) || equalsFString(value, F("on"))
+					|| equalsFString(value, F("yes"))) {
+				return true;
+			}
+
+			if (equalsFString(value, F("0")) || equalsFString(value, F("false")) || equalsFString(value, F("off")) || equalsFString(value, F("no"))) {
+				return false;
+			}
+
+			return defaultValue;
+		}
 	public:
 		//--------------------------------------------------------------------------------
 		// Constructs bundle with request data.
@@ -244,6 +440,36 @@ namespace acp_network_simple_http_client_handler {
 			return requestData.url;
 		}
 
+		//--------------------------------------------------------------------------------
+		// Returns length of the request body or a negative number, if not known
+		inline long getContentLength() {
+			return requestData.contentLength;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns entity tags of the If-None-Match header or NULL, if not received
+		inline const char* getIfNoneMatch() {
+			return requestData.ifNoneMatchHeader;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns whether the client accepts gzip content coding
+		inline bool acceptsGzip() {
+			return requestData.acceptsGzip;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns whether the client requests a range of bytes (see HttpResponse::sendContent)
+		inline bool hasRange() {
+			return (requestData.rangeFirst >= 0) || (requestData.rangeLast >= 0);
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns whether the client requests upgrade to the WebSocket protocol
+		inline bool isWebSocketUpgrade() {
+			return requestData.isWebSocketUpgrade();
+		}
+
 		//--------------------------------------------------------------------------------
 		// Returns whether url starts with given string.
 		bool urlStartsWith(const char* str) {
@@ -312,493 +538,2780 @@ namespace acp_network_simple_http_client_handler {
 		inline HttpParameter nextPostParameter() {
 			return decodeNextParameter(requestData.postParameters);
 		}
-	};
-
-	/********************************************************************************
-	 * Response builder
-	 ********************************************************************************/
-	class HttpResponse {
-	private:
-		// Client that produces the response
-		Client* client;
-
-		// Allow origin field required to support CORS
-		const char* corsAllowOrigin;
-
-		// State of the output.
-		// bit 0 - http status printed
-		// bit 1 - http headers closed
-		// bit 2 - allow-credentials for CORS enabled/disabled
-		uint8_t state;
 
 		//--------------------------------------------------------------------------------
-		// Ensures that the status line was printed.
-		void ensureStatusPrinted() {
-			if ((state & B00000001) == B00000001) {
-				return;
-			}
-
-			setStatus(200, F("OK"));
+		// Returns value of a GET or POST parameter (GET parameters are searched first) or
+		// NULL, if there is no such parameter. The first lookup decodes all unprocessed
+		// parameters (at most MaxParameters) to an index, so that they are no longer
+		// available by nextGetParameter and nextPostParameter. Parameters beyond the
+		// capacity of the index are not found (see hasUnindexedParameters).
+		inline const char* getParameter(const char* name) {
+			const HttpParameter* parameter = findParameter(name);
+			return (parameter != NULL) ? parameter->value : NULL;
 		}
 
 		//--------------------------------------------------------------------------------
-		// Closes the header section in generated http response.
-		void closeHeaders() {
-			ensureStatusPrinted();
-
-			// Generate headers for CORS
-			if (corsAllowOrigin != NULL) {
-				header(F("Access-Control-Allow-Origin"), corsAllowOrigin);
-				if ((state & B00000100) == B00000100) {
-					header(F("Access-Control-Allow-Credentials"), F("true"));
-					header(F("Access-Control-Allow-Headers"), F("Authorization"));
-				}
-			}
-
-			// Required closing of connection after completing the request.
-			client->println(F("Connection: close"));
-
-			// Print separation line after header fields.
-			client->println();
-
-			// Set that headers are closed.
-			state |= B00000010;
+		// Returns value of a GET or POST parameter or NULL, if there is no such parameter.
+		inline const char* getParameter(const __FlashStringHelper* name) {
+			const HttpParameter* parameter = findParameter(name);
+			return (parameter != NULL) ? parameter->value : NULL;
 		}
 
-	public:
 		//--------------------------------------------------------------------------------
-		// Constructs an http response for given client.
-		HttpResponse(Client* client, const char* corsAllowOrigin, bool corsAllowCredentials):client(client), corsAllowOrigin(corsAllowOrigin), state(0) {
-			if (corsAllowCredentials) {
-				state |= B00000100;
-			}
+		// Returns whether a GET or POST parameter is present.
+		inline bool hasParameter(const char* name) {
+			return (findParameter(name) != NULL);
 		}
 
 		//--------------------------------------------------------------------------------
-		// Sets the response status.
-		void setStatus(int statusCode, const char* reasonPhrase) {
-			// Check whether http status has been printed
-			if ((state & B00000001) == B00000001) {
-				return;
-			}
-
-			client->print(F("HTTP/1.1 "));
-			client->print(statusCode);
-			client->print(' ');
-			client->println(reasonPhrase);
-			state |= B00000001;
+		// Returns whether a GET or POST parameter is present.
+		inline bool hasParameter(const __FlashStringHelper* name) {
+			return (findParameter(name) != NULL);
 		}
 
 		//--------------------------------------------------------------------------------
-		// Sets the response status.
-		void setStatus(int statusCode, const __FlashStringHelper* reasonPhrase) {
-			// Check whether http status has been printed
-			if ((state & B00000001) == B00000001) {
-				return;
-			}
-
-			client->print(F("HTTP/1.1 "));
-			client->print(statusCode);
-			client->print(' ');
-			client->println(reasonPhrase);
-			state |= B00000001;
+		// Returns whether some GET or POST parameters did not fit the index of parameters.
+		// If so, a parameter that is not found may be present in the request.
+		inline bool hasUnindexedParameters() {
+			ensureIndexedParameters();
+			return requestData.parameterOverflow;
 		}
 
 		//--------------------------------------------------------------------------------
-		// Send an http header.
-		void header(const char* fieldName, const char* fieldValue) {
-			// Check whether headers can be sent
-			if ((state & B00000010) == B00000010) {
-				return;
-			}
-
-			ensureStatusPrinted();
-			client->print(fieldName);
-			client->print(':');
-			client->print(' ');
-			client->println(fieldValue);
+		// Returns integer value of a parameter or defaultValue, if the parameter is not
+		// present or its value is not a decimal integer in range of the long type.
+		inline long getInt(const char* name, long defaultValue) {
+			return parseInt(name, defaultValue);
 		}
 
 		//--------------------------------------------------------------------------------
-		// Send an http header.
-		void header(const __FlashStringHelper* fieldName, const char* fieldValue) {
-			// Check whether headers can be sent
-			if ((state & B00000010) == B00000010) {
-				return;
-			}
-
-			ensureStatusPrinted();
-			client->print(fieldName);
-			client->print(':');
-			client->print(' ');
-			client->println(fieldValue);
+		// Returns integer value of a parameter or defaultValue, if the parameter is not
+		// present or its value is not a decimal integer in range of the long type.
+		inline long getInt(const __FlashStringHelper* name, long defaultValue) {
+			return parseInt(name, defaultValue);
 		}
 
 		//--------------------------------------------------------------------------------
-		// Send an http header.
-		void header(const __FlashStringHelper* fieldName, const __FlashStringHelper* fieldValue) {
-			// Check whether headers can be sent
-			if ((state & B00000010) == B00000010) {
-				return;
-			}
-
-			ensureStatusPrinted();
-			client->print(fieldName);
-			client->print(':');
-			client->print(' ');
-			client->println(fieldValue);
+		// Returns boolean value of a parameter (1, true, on, yes or empty value for true
+		// and 0, false, off, no for false) or defaultValue, if the parameter is not present
+		// or its value is not recognized.
+		inline bool getBool(const char* name, bool defaultValue) {
+			return parseBool(name, defaultValue);
 		}
 
 		//--------------------------------------------------------------------------------
-		// Returns Print object for writing header fields.
-		Print* getHeaderPrint() {
-			// Check whether headers can be sent
-			if ((state & B00000010) == B00000010) {
-				return NULL;
-			}
+		// Returns boolean value of a parameter or defaultValue, if the parameter is not
+		// present or its value is not recognized.
+		inline bool getBool(const __FlashStringHelper* name, bool defaultValue) {
+			return parseBool(name, defaultValue);
+		}
+	};
 
-			ensureStatusPrinted();
-			return client;
+	/********************************************************************************
+	 * Print that encodes written data as chunks of the chunked transfer coding
+	 ********************************************************************************/
+	class ChunkedPrint: public Print {
+	private:
+		// Output
+		Print* out;
+
+		// Indicates whether a chunk has been written
+		bool chunkWritten;
+	public:
+		//--------------------------------------------------------------------------------
+		// Constructs a chunked print that writes chunks to given Print object.
+		ChunkedPrint(Print* print):out(print), chunkWritten(false) {
+			// Nothing to do
 		}
 
 		//--------------------------------------------------------------------------------
-		// Starts production of the response content with undefined content type.
-		inline Print* startContent() {
-			return startContent((const char*)NULL);
+		// Writes a byte as a chunk.
+		virtual size_t write(uint8_t data) {
+			return write(&data, 1);
 		}
 
 		//--------------------------------------------------------------------------------
-		// Starts production of the response content of given type and returns pointer to
-		// a Print object to which the content should be printed/written.
-		Print* startContent(const char* contentType) {
-			// If header are closed, we do nothing
-			if ((state & B00000010) == B00000010) {
-				return client;
+		// Writes a block of bytes as a chunk.
+		virtual size_t write(const uint8_t* data, size_t size) {
+			if (size == 0) {
+				return 0;
 			}
 
-			// Produce content type
-			if (contentType != NULL) {
-				header(F("Content-Type"), contentType);
+			// Construct chunk size line (preceded by the end of the previous chunk)
+			char sizeLine[2 + 2 * sizeof(size_t) + 2];
+			char* linePtr = sizeLine + sizeof(sizeLine);
+			*(--linePtr) = '\n';
+			*(--linePtr) = '\r';
+			size_t value = size;
+			do {
+				const uint8_t digit = value & 0x0F;
+				*(--linePtr) = (digit < 10) ? ('0' + digit) : ('A' + digit - 10);
+				value >>= 4;
+			} while (value > 0);
+
+			if (chunkWritten) {
+				*(--linePtr) = '\n';
+				*(--linePtr) = '\r';
 			}
 
-			closeHeaders();
-			return client;
+			out->write((const uint8_t*)linePtr, sizeLine + sizeof(sizeLine) - linePtr);
+			chunkWritten = true;
+			return out->write(data, size);
 		}
 
 		//--------------------------------------------------------------------------------
-		// Starts production of the response content of given type and returns pointer to
-		// a Print object to which the content should be printed/written.
-		Print* startContent(const __FlashStringHelper* contentType) {
-			// If header are closed, we do nothing
-			if ((state & B00000010) == B00000010) {
-				return client;
-			}
-
-			// Produce content type
-			if (contentType != NULL) {
-				header(F("Content-Type"), contentType);
+		// Writes the last (empty) chunk that terminates the content.
+		void finish() {
+			if (chunkWritten) {
+				out->print(F("\r\n0\r\n\r\n"));
+			} else {
+				out->print(F("0\r\n\r\n"));
 			}
-
-			closeHeaders();
-			return client;
 		}
+
+		using Print::write;
 	};
 
 	/********************************************************************************
-	 * Controller for a simple http client handler.
+	 * SHA-1 message digest (used by the WebSocket opening handshake)
 	 ********************************************************************************/
-	template<int BUFFER_SIZE, long TIMEOUT> class SimpleHttpHandlingController {
-		friend class TSimpleHttpClientHandler<BUFFER_SIZE, TIMEOUT>;
+	class Sha1Digest {
 	private:
-		// Server managed by (associated with) this client handler.
-		acp_network_libs_handling_srv::LoopingServer* server;
+		// Intermediate hash value
+		uint32_t hash[5];
 
-		// State of the controller
-		// bit 0 indicates whether the associated server was initialized
-		// bit 1 indicates whether CORS support is enabled
-		uint8_t state;
+		// Block of the message that is not processed yet
+		uint8_t block[64];
 
-		// Authentication settings (see Features struct for more details)
-		const __FlashStringHelper* authentication;
+		// Number of bytes in the block
+		uint8_t blockLength;
+
+		// Length of the message in bytes
+		uint32_t messageLength;
 
 		//--------------------------------------------------------------------------------
-		// Reads at most given number of bytes from client to buffer.
-		int readBytes(Client& client, uint8_t* buffer, int length) {
-			const bool useBlockRead = true;
-			if (useBlockRead) {
-				return client.read(buffer, length);
-			} else {
-				int receivedBytes = 0;
-				while (client.connected() && client.available() && (receivedBytes < length)) {
-					int ch = client.read();
-					if (ch >= 0) {
-						*buffer = (char)ch;
-						buffer++;
-						receivedBytes++;
-					}
-				}
-				return receivedBytes;
-			}
+		// Rotates a word to the left.
+		static inline uint32_t rotateLeft(uint32_t value, uint8_t bits) {
+			return (value << bits) | (value >> (32 - bits));
 		}
 
 		//--------------------------------------------------------------------------------
-		// Fills the line buffer (the reading finishes when end of line is reached or the buffer is filled)
-		// and returns the length of the line prefix (including the LF character).
-		// Returns 0, if the client closes the session
-		// Returns -1, if the line is too long to fit into the buffer
-		// Returns -2, if timeout with respect to requestStartTime occurred
-		int readLine(Client& client, uint8_t* buffer, int& bufferedBytes, const int bufferSize, unsigned long requestStartTime) {
-			// Check whether the buffer contains the LF character
-			if (bufferedBytes > 0) {
-				uint8_t* dataPtr = buffer;
-				uint8_t* const dataEnd = buffer+bufferedBytes;
-				while (dataPtr != dataEnd) {
-					if (*dataPtr == '\n') {
-						return dataPtr - buffer + 1;
-					}
-					dataPtr++;
-				}
+		// Processes the complete block (the message schedule is computed in 16 words).
+		void processBlock() {
+			uint32_t w[16];
+			for (int i = 0; i < 16; i++) {
+				w[i] = ((uint32_t)block[4 * i] << 24) | ((uint32_t)block[4 * i + 1] << 16) | ((uint32_t)block[4 * i + 2] << 8)
+						| (uint32_t)block[4 * i + 3];
 			}
 
-			// Read data from client
-			int freeSize = bufferSize - bufferedBytes;
-			while (client.connected() && (freeSize > 0)) {
-				// Check timeout
-				if (millis() - requestStartTime > TIMEOUT) {
-					return -2;
+			uint32_t a = hash[0];
+			uint32_t b = hash[1];
+			uint32_t c = hash[2];
+			uint32_t d = hash[3];
+			uint32_t e = hash[4];
+			for (int i = 0; i < 80; i++) {
+				if (i >= 16) {
+					w[i & 15] = rotateLeft(w[(i + 13) & 15] ^ w[(i + 8) & 15] ^ w[(i + 2) & 15] ^ w[i & 15], 1);
 				}
 
-				// Request number of available bytes
-				int availableBytes = client.available();
-				if (availableBytes > 0) {
-					// Eliminate the buffer overflow
-					if (availableBytes > freeSize) {
-						availableBytes = freeSize;
-					}
-
-					// Read data
-					uint8_t* dataPtr = buffer+bufferedBytes;
-					const int receivedBytes = readBytes(client, dataPtr, availableBytes);
-					if ((receivedBytes < 0) || (receivedBytes > availableBytes)) {
-						// Something went wrong - disconnect client
-						closeConnection(client);
-						ACP_TRACE(F("HTTP: Wrong state."));
-						return 0;
-					}
-
-					bufferedBytes += receivedBytes;
-					freeSize -= receivedBytes;
-					uint8_t* const dataEnd = buffer+bufferedBytes;
-
-					// Check whether received data contain a new line separator
-					while (dataPtr != dataEnd) {
-						if (*dataPtr == '\n') {
-							return dataPtr - buffer + 1;
-						}
-						dataPtr++;
-					}
+				uint32_t f;
+				if (i < 20) {
+					f = ((b & c) | (~b & d)) + 0x5A827999UL;
+				} else if (i < 40) {
+					f = (b ^ c ^ d) + 0x6ED9EBA1UL;
+				} else if (i < 60) {
+					f = ((b & c) | (b & d) | (c & d)) + 0x8F1BBCDCUL;
 				} else {
-					ACP_TRACE(F("HTTP: Waiting for data."));
-					delay(1);
+					f = (b ^ c ^ d) + 0xCA62C1D6UL;
 				}
+
+				const uint32_t temp = rotateLeft(a, 5) + f + e + w[i & 15];
+				e = d;
+				d = c;
+				c = rotateLeft(b, 30);
+				b = a;
+				a = temp;
 			}
 
-			return (freeSize == 0) ? -1 : 0;
+			hash[0] += a;
+			hash[1] += b;
+			hash[2] += c;
+			hash[3] += d;
+			hash[4] += e;
+			blockLength = 0;
+		}
+	public:
+		//--------------------------------------------------------------------------------
+		// Constructs digest of an empty message.
+		Sha1Digest():blockLength(0), messageLength(0) {
+			hash[0] = 0x67452301UL;
+			hash[1] = 0xEFCDAB89UL;
+			hash[2] = 0x98BADCFEUL;
+			hash[3] = 0x10325476UL;
+			hash[4] = 0xC3D2E1F0UL;
 		}
 
 		//--------------------------------------------------------------------------------
-		// Read the data until incoming bytes do not contain the LF character.
-		void skipToLineEnd(Client& client, uint8_t* buffer, int& bufferedBytes, const int bufferSize, unsigned long requestStartTime) {
-			// Read data from client
-			while (client.connected()) {
-				// Check timeout
-				if (millis() - requestStartTime > TIMEOUT) {
-					return;
-				}
+		// Appends a byte to the message.
+		void write(uint8_t data) {
+			block[blockLength++] = data;
+			messageLength++;
+			if (blockLength == 64) {
+				processBlock();
+			}
+		}
 
-				int availableBytes = client.available();
-				if (availableBytes > 0) {
-					// Eliminate the buffer overflow
-					if (availableBytes > bufferSize) {
-						availableBytes = bufferSize;
-					}
+		//--------------------------------------------------------------------------------
+		// Appends a string to the message.
+		void write(const char* str) {
+			while (*str != 0) {
+				write((uint8_t)*str);
+				str++;
+			}
+		}
 
-					// Read data
-					bufferedBytes = readBytes(client, buffer, availableBytes);
-					if ((bufferedBytes < 0) || (bufferedBytes > availableBytes)) {
-						// Something went wrong - disconnect client
-						closeConnection(client);
-						ACP_TRACE(F("HTTP: Wrong state."));
-						return;
-					}
+		//--------------------------------------------------------------------------------
+		// Appends a string stored in flash memory to the message.
+		void write(const __FlashStringHelper* str) {
+			PGM_P strPtr = reinterpret_cast<PGM_P>(str);
+			char c;
+			while ((c = pgm_read_byte(strPtr)) != 0) {
+				write((uint8_t)c);
+				strPtr++;
+			}
+		}
 
-					uint8_t* dataPtr = buffer;
-					uint8_t* const dataEnd = buffer+bufferedBytes;
+		//--------------------------------------------------------------------------------
+		// Completes the message and stores its 20-byte digest.
+		void finish(uint8_t* digest) {
+			const uint32_t messageBits = messageLength * 8;
+			write((uint8_t)0x80);
+			while (blockLength != 56) {
+				write((uint8_t)0x00);
+			}
 
-					// Check whether received data contain a new line separator
-					while (dataPtr != dataEnd) {
-						if (*dataPtr == '\n') {
-							dataPtr++;
-							break;
-						}
-						dataPtr++;
-					}
+			for (int i = 0; i < 4; i++) {
+				write((uint8_t)0x00);
+			}
 
-					// If LF is detected, we copy
-					if (dataPtr != dataEnd) {
-						// Copy data received after the LF character to the beginning of the buffer
-						bufferedBytes = dataEnd - dataPtr;
-						while (dataPtr != dataEnd) {
-							*buffer = *dataPtr;
-							dataPtr++;
-							buffer++;
-						}
-						return;
-					}
-				} else {
-					ACP_TRACE(F("HTTP: Waiting for data."));
-					delay(1);
-				}
+			for (int i = 3; i >= 0; i--) {
+				write((uint8_t)(messageBits >> (8 * i)));
+			}
+
+			for (int i = 0; i < 20; i++) {
+				digest[i] = (uint8_t)(hash[i / 4] >> (24 - 8 * (i % 4)));
 			}
 		}
+	};
 
+	/********************************************************************************
+	 * Seekable source of response content (see HttpResponse::sendContent)
+	 ********************************************************************************/
+	class HttpDataSource {
+	public:
 		//--------------------------------------------------------------------------------
-		// Closes the client
-		void closeConnection(Client& client) {
-			client.flush();
-			delay(1);
-			client.stop();
+		// Returns the length of the data in bytes.
+		virtual unsigned long getLength() = 0;
+
+		//--------------------------------------------------------------------------------
+		// Moves the read position to given byte. Returns false, if the position cannot
+		// be set.
+		virtual bool seek(unsigned long position) = 0;
+
+		//--------------------------------------------------------------------------------
+		// Reads at most size bytes from the read position to the buffer and returns the
+		// number of read bytes (0 or a negative number, if no data can be read).
+		virtual int read(uint8_t* buffer, int size) = 0;
+	};
+
+	/********************************************************************************
+	 * Data source reading a block of memory (SRAM).
+	 ********************************************************************************/
+	class MemoryDataSource: public HttpDataSource {
+	private:
+		// Data
+		const uint8_t* data;
+
+		// Length of data in bytes
+		unsigned long length;
+
+		// Read position
+		unsigned long position;
+	public:
+		//--------------------------------------------------------------------------------
+		// Constructs data source for given block of memory.
+		MemoryDataSource(const uint8_t* data, unsigned long length):data(data), length(length), position(0) {
+			// Nothing to do
 		}
 
 		//--------------------------------------------------------------------------------
-		// Removes given number of bytes from the beginning of the buffer.
-		void removeBufferPrefix(uint8_t* buffer, int& bufferedBytes, int prefixLength) {
-			uint8_t* dataPtr = buffer + prefixLength;
-			uint8_t* const dataEnd = buffer + bufferedBytes;
-			while (dataPtr != dataEnd) {
-				*buffer = *dataPtr;
-				buffer++;
-				dataPtr++;
+		// Returns the length of the data in bytes.
+		virtual unsigned long getLength() {
+			return length;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Moves the read position to given byte.
+		virtual bool seek(unsigned long position) {
+			if (position > length) {
+				return false;
+			}
+
+			this->position = position;
+			return true;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Reads at most size bytes from the read position to the buffer.
+		virtual int read(uint8_t* buffer, int size) {
+			if ((unsigned long)size > length - position) {
+				size = length - position;
 			}
 
-			bufferedBytes -= prefixLength;
+			memcpy(buffer, data + position, size);
+			position += size;
+			return size;
 		}
+	};
 
+	/********************************************************************************
+	 * Data source reading a file of a file system (e.g. File of the SD library or
+	 * any other class with methods size, seek and read of a block).
+	 ********************************************************************************/
+	template<typename FILE> class FileDataSource: public HttpDataSource {
+	private:
+		// The file
+		FILE& file;
+	public:
 		//--------------------------------------------------------------------------------
-		// Locates character in block of memory.
-		// Returns the index of the first occurrence or -1, if the character is not found.
-		int locateCharacter(const uint8_t* ptr, int value, int num) {
-			for (int i=0; i<num; i++) {
-				if (*ptr == value) {
-					return i;
+		// Constructs data source for an open file.
+		FileDataSource(FILE& file):file(file) {
+			// Nothing to do
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns the size of the file in bytes.
+		virtual unsigned long getLength() {
+			return file.size();
+		}
+
+		//--------------------------------------------------------------------------------
+		// Moves the read position in the file to given byte.
+		virtual bool seek(unsigned long position) {
+			return file.seek(position);
+		}
+
+		//--------------------------------------------------------------------------------
+		// Reads at most size bytes from the file to the buffer.
+		virtual int read(uint8_t* buffer, int size) {
+			return file.read(buffer, size);
+		}
+	};
+
+	/********************************************************************************
+	 * Options of an http response given by the request and the handler settings.
+	 ********************************************************************************/
+	struct HttpResponseOptions {
+		// Allow origin field required to support CORS (NULL, if not required)
+		const char* corsAllowOrigin;
+
+		// Indicates whether allow-credentials for CORS is enabled
+		bool corsAllowCredentials;
+
+		// Indicates whether the connection is kept alive after the response
+		bool keepAlive;
+
+		// Indicates whether content of unknown length is sent using chunked transfer coding
+		bool chunkedAllowed;
+
+		// Indicates whether the response can start an event stream
+		bool eventStreamAllowed;
+
+		HttpResponseOptions():corsAllowOrigin(NULL), corsAllowCredentials(false), keepAlive(false), chunkedAllowed(false),
+				eventStreamAllowed(false) {}
+	};
+
+	/********************************************************************************
+	 * Response builder
+	 ********************************************************************************/
+	class HttpResponse {
+		template<int BUFFER_SIZE, long TIMEOUT, int OUTPUT_BUFFER_SIZE, int MAX_CONNECTIONS, bool POOLED_BUFFERS, int MAX_PARAMETERS>
+				friend class SimpleHttpHandlingController;
+	private:
+		// Client that produces the response
+		Client* client;
+
+		// Buffered output to the client
+		acp_network_libs_format_printers::BufferedPrint output;
+
+		// Output encoding content of unknown length in chunks
+		ChunkedPrint chunkedOutput;
+
+		// Allow origin field required to support CORS
+		const char* corsAllowOrigin;
+
+		// Length of the response content (negative number if not known)
+		long contentLength;
+
+		// Key of the WebSocket opening handshake (NULL, if the request is not an upgrade request)
+		const char* webSocketKey;
+
+		// Requested range of bytes (see RequestProcessingData)
+		long rangeFirst;
+		long rangeLast;
+
+		// State of the output.
+		// bit 0 - http status printed
+		// bit 1 - http headers closed
+		// bit 2 - allow-credentials for CORS enabled/disabled
+		// bit 3 - connection is kept alive after the response
+		// bit 4 - chunked transfer coding is allowed for content of unknown length
+		// bit 5 - event stream is allowed
+		// bit 6 - content is an event stream
+		// bit 7 - connection is upgraded to the WebSocket protocol
+		uint8_t state;
+
+		//--------------------------------------------------------------------------------
+		// Ensures that the status line was printed.
+		void ensureStatusPrinted() {
+			if ((state & B00000001) == B00000001) {
+				return;
+			}
+
+			setStatus(200, F("OK"));
+		}
+
+		//--------------------------------------------------------------------------------
+		// Closes the header section in generated http response.
+		void closeHeaders() {
+			ensureStatusPrinted();
+
+			// Generate headers for CORS
+			if (corsAllowOrigin != NULL) {
+				header(F("Access-Control-Allow-Origin"), corsAllowOrigin);
+				if ((state & B00000100) == B00000100) {
+					header(F("Access-Control-Allow-Credentials"), F("true"));
+					header(F("Access-Control-Allow-Headers"), F("Authorization"));
 				}
+			}
 
-				ptr++;
+			// Persistent connection requires known length of the content or chunked content
+			if ((state & B01000000) == B01000000) {
+				// Event stream is not delimited, it ends when the connection is closed
+				state &= B11100111;
+				output.println(F("Cache-Control: no-cache"));
+			} else if (contentLength >= 0) {
+				state &= B11101111;
+				output.print(F("Content-Length: "));
+				output.println(contentLength);
+			} else if ((state & B00010000) == B00010000) {
+				output.println(F("Transfer-Encoding: chunked"));
+			} else {
+				state &= B11110111;
 			}
 
-			return -1;
+			// Closing of connection after completing the request (if required).
+			if ((state & B00001000) == B00001000) {
+				output.println(F("Connection: keep-alive"));
+			} else if ((state & B01000000) == 0) {
+				output.println(F("Connection: close"));
+			}
+
+			// Print separation line after header fields.
+			output.println();
+
+			// Content of unknown length is encoded in chunks
+			if ((state & B00010000) == B00010000) {
+				output.setOutput(&chunkedOutput);
+			}
+
+			// Set that headers are closed.
+			state |= B00000010;
 		}
 
 		//--------------------------------------------------------------------------------
-		// Checks whether the content of a buffer starts with a given string.
-		bool startsWithFString(const uint8_t* ptr, const __FlashStringHelper* ifsh) {
-			PGM_P p = reinterpret_cast<PGM_P>(ifsh);
-			while (true) {
-				const unsigned char c = pgm_read_byte(p);
-				if (c == 0) {
-					return true;
+		// Completes the response: closes headers (if not closed) of a response without
+		// content and returns whether the connection is kept alive.
+		bool complete() {
+			if ((state & B00000010) == 0) {
+				if (contentLength < 0) {
+					contentLength = 0;
 				}
+				closeHeaders();
+			}
 
-				if (c != *ptr) {
+			output.flush();
+			if ((state & B00010000) == B00010000) {
+				chunkedOutput.finish();
+			}
+
+			return ((state & B11001000) != 0);
+		}
+
+		//--------------------------------------------------------------------------------
+		// Sends the status and header fields of content read from a data source and moves
+		// the read position to the first sent byte. Returns the number of bytes to be sent
+		// or a negative number, if the response has no content.
+		long startDataContent(HttpDataSource& source) {
+			const unsigned long length = source.getLength();
+			unsigned long first = 0;
+			unsigned long last = length - 1;
+			const bool partial = (rangeFirst >= 0) || (rangeLast >= 0);
+			if (partial) {
+				if (rangeFirst < 0) {
+					// Suffix range with given number of the last bytes
+					first = ((unsigned long)rangeLast < length) ? length - rangeLast : 0;
+				} else {
+					first = rangeFirst;
+					if ((rangeLast >= 0) && ((unsigned long)rangeLast < length)) {
+						last = rangeLast;
+					}
+				}
+
+				// Range starting behind the data (including an empty suffix range) cannot be satisfied
+				if (first >= length) {
+					setStatus(416, F("Range Not Satisfiable"));
+					output.print(F("Content-Range: bytes */"));
+					output.println(length);
+					setContentLength(0);
+					return -1;
+				}
+			}
+
+			if ((length > 0) && !source.seek(first)) {
+				setStatus(500, F("Internal Server Error"));
+				setContentLength(0);
+				return -1;
+			}
+
+			if (partial) {
+				setStatus(206, F("Partial Content"));
+				output.print(F("Content-Range: bytes "));
+				output.print(first);
+				output.print('-');
+				output.print(last);
+				output.print('/');
+				output.println(length);
+			}
+
+			header(F("Accept-Ranges"), F("bytes"));
+			const long contentLength = (length > 0) ? last - first + 1 : 0;
+			setContentLength(contentLength);
+			return contentLength;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Copies given number of bytes from a data source to the content. Returns false,
+		// if the data source provided less bytes (the connection is closed after
+		// the incomplete content).
+		bool copyDataContent(Print* out, HttpDataSource& source, long length) {
+			uint8_t block[64];
+			while (length > 0) {
+				const int readBytes = source.read(block, (length < (long)sizeof(block)) ? (int)length : (int)sizeof(block));
+				if (readBytes <= 0) {
+					state &= B11110111;
 					return false;
 				}
 
-				ptr++;
-				p++;
+				out->write(block, readBytes);
+				length -= readBytes;
 			}
+
+			return true;
 		}
 
 		//--------------------------------------------------------------------------------
-		// Handles an invalid state.
-		void handleInvalidState(Client& client, int errorCode, unsigned long requestStartTime) {
-			// Log error
-			if (errorCode == 0) {
-				ACP_TRACE(F("HTTP: client disconnected before request completed."));
-			} else if (errorCode == -1) {
-				ACP_TRACE(F("HTTP: request (receive) buffer congested."));
-			} else if (errorCode == -2) {
-				ACP_TRACE(F("HTTP: timeout."));
-			} else {
-				ACP_TRACE(F("HTTP: unexpected error (%d)."), errorCode);
+		// Returns whether the content is an event stream.
+		inline bool isEventStream() {
+			return ((state & B01000000) == B01000000);
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns whether the connection is upgraded to the WebSocket protocol.
+		inline bool isWebSocket() {
+			return ((state & B10000000) == B10000000);
+		}
+
+	public:
+		//--------------------------------------------------------------------------------
+		// Constructs an http response for given client with output buffered in given buffer.
+		HttpResponse(Client* client, uint8_t* outputBuffer, int outputBufferSize, const HttpResponseOptions& options):client(client),
+				output(client, outputBuffer, outputBufferSize), chunkedOutput(client), corsAllowOrigin(options.corsAllowOrigin),
+				contentLength(-1), webSocketKey(NULL), rangeFirst(-1), rangeLast(-1), state(0) {
+			if (options.corsAllowCredentials) {
+				state |= B00000100;
 			}
 
-			// If the client is not connected, it is not possible to inform the client
-			if (!client.connected()) {
+			if (options.keepAlive) {
+				state |= B00001000;
+			}
+
+			if (options.chunkedAllowed) {
+				state |= B00010000;
+			}
+
+			if (options.eventStreamAllowed) {
+				state |= B00100000;
+			}
+		}
+
+		//--------------------------------------------------------------------------------
+		// Sets the response status.
+		void setStatus(int statusCode, const char* reasonPhrase) {
+			// Check whether http status has been printed
+			if ((state & B00000001) == B00000001) {
 				return;
 			}
 
-			client.println(F("HTTP/1.1 500 Internal Error"));
-			client.println(F("Connection: close"));
-			closeConnection(client);
+			output.print(F("HTTP/1.1 "));
+			output.print(statusCode);
+			output.print(' ');
+			output.println(reasonPhrase);
+			state |= B00000001;
 		}
 
 		//--------------------------------------------------------------------------------
-		// Realizes basic http authentication (including the 401 response, if necessary)
-		// Returns true, if the user is authorized, false otherwise.
-		bool handleBasicAuthentication(Client& client, const uint8_t* authHeaderField, const __FlashStringHelper* authSetting) {
-			if (authSetting == NULL) {
-				return true;
+		// Sets the response status.
+		void setStatus(int statusCode, const __FlashStringHelper* reasonPhrase) {
+			// Check whether http status has been printed
+			if ((state & B00000001) == B00000001) {
+				return;
 			}
 
-			PGM_P settingPtr = reinterpret_cast<PGM_P>(authSetting);
-			bool authenticated = true;
+			output.print(F("HTTP/1.1 "));
+			output.print(statusCode);
+			output.print(' ');
+			output.println(reasonPhrase);
+			state |= B00000001;
+		}
 
-			// Check basic authentication method
-			while ((*authHeaderField != 0) && (*authHeaderField != ':')) {
-				authHeaderField++;
+		//--------------------------------------------------------------------------------
+		// Send an http header.
+		void header(const char* fieldName, const char* fieldValue) {
+			// Check whether headers can be sent
+			if ((state & B00000010) == B00000010) {
+				return;
 			}
 
-			if (*authHeaderField != 0) {
-				authHeaderField++;
+			ensureStatusPrinted();
+			output.print(fieldName);
+			output.print(':');
+			output.print(' ');
+			output.println(fieldValue);
+		}
+
+		//--------------------------------------------------------------------------------
+		// Send an http header.
+		void header(const __FlashStringHelper* fieldName, const char* fieldValue) {
+			// Check whether headers can be sent
+			if ((state & B00000010) == B00000010) {
+				return;
 			}
 
-			while (*authHeaderField == ' ') {
-				authHeaderField++;
+			ensureStatusPrinted();
+			output.print(fieldName);
+			output.print(':');
+			output.print(' ');
+			output.println(fieldValue);
+		}
+
+		//--------------------------------------------------------------------------------
+		// Send an http header.
+		void header(const __FlashStringHelper* fieldName, const __FlashStringHelper* fieldValue) {
+			// Check whether headers can be sent
+			if ((state & B00000010) == B00000010) {
+				return;
 			}
 
-			if (startsWithFString((const uint8_t*)authHeaderField, F("Basic "))) {
-				authHeaderField += 6;
+			ensureStatusPrinted();
+			output.print(fieldName);
+			output.print(':');
+			output.print(' ');
+			output.println(fieldValue);
+		}
+
+		//--------------------------------------------------------------------------------
+		// Sets length of the response content in bytes. The length must be set before
+		// the content is started and exactly given number of bytes must be printed
+		// as the content. The content of known length is sent without chunked transfer
+		// coding. If the length is not set, HTTP/1.1 clients receive the content in chunks.
+		void setContentLength(unsigned long length) {
+			// Check whether headers can be sent
+			if ((state & B00000010) == B00000010) {
+				return;
+			}
+
+			contentLength = length;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns Print object for writing header fields.
+		Print* getHeaderPrint() {
+			// Check whether headers can be sent
+			if ((state & B00000010) == B00000010) {
+				return NULL;
+			}
+
+			ensureStatusPrinted();
+			return &output;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Starts an event stream (server-sent events). The connection remains open after
+		// the response and events published by the handler are written to the stream.
+		// Returns Print object for writing initial events (see HttpEventWriter) or NULL, if
+		// the event stream cannot be started (the limit of event streams is reached or
+		// the client is not handled by a multi client server).
+		Print* startEventStream() {
+			// Check whether headers can be sent and an event stream is allowed
+			if (((state & B00000010) == B00000010) || ((state & B00100000) == 0)) {
+				return NULL;
+			}
+
+			state |= B01000000;
+			return startContent(F("text/event-stream"));
+		}
+
+		//--------------------------------------------------------------------------------
+		// Accepts upgrade of the connection to the WebSocket protocol (see
+		// HttpRequest::isWebSocketUpgrade). After the response, messages of the client are
+		// processed by the handler (see WebSocket). Returns false, if the upgrade cannot be
+		// accepted (the request is not an upgrade request, the limit of event streams is
+		// reached or the client is not handled by a multi client server).
+		bool acceptWebSocket() {
+			// Check whether the status can be sent and an upgrade is allowed
+			if (((state & B00000011) != 0) || ((state & B00100000) == 0) || (webSocketKey == NULL)) {
+				return false;
+			}
+
+			// Compute accept value from the key and the protocol GUID
+			Sha1Digest sha1;
+			sha1.write(webSocketKey);
+			sha1.write(F("258EAFA5-E914-47DA-95CA-C5AB0DC85B11"));
+			uint8_t digest[21];
+			sha1.finish(digest);
+			digest[20] = 0;
+
+			// Encode the digest in base64 (20 bytes are encoded as 27 characters and padding)
+			char acceptValue[29];
+			for (int i = 0; i < 7; i++) {
+				const uint32_t bits = ((uint32_t)digest[3 * i] << 16) | ((uint32_t)digest[3 * i + 1] << 8) | (uint32_t)digest[3 * i + 2];
+				for (int j = 0; j < 4; j++) {
+					const uint8_t value = (bits >> (18 - 6 * j)) & 0x3F;
+					char c;
+					if (value < 26) {
+						c = 'A' + value;
+					} else if (value < 52) {
+						c = 'a' + (value - 26);
+					} else if (value < 62) {
+						c = '0' + (value - 52);
+					} else {
+						c = (value == 62) ? '+' : '/';
+					}
+					acceptValue[4 * i + j] = c;
+				}
+			}
+			acceptValue[27] = '=';
+			acceptValue[28] = 0;
+
+			setStatus(101, F("Switching Protocols"));
+			header(F("Upgrade"), F("websocket"));
+			header(F("Connection"), F("Upgrade"));
+			header(F("Sec-WebSocket-Accept"), acceptValue);
+			output.println();
+
+			// Headers are closed, the connection is neither chunked nor closed
+			state = (state & B11100111) | B10000010;
+			return true;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Sends content of given type read from a seekable data source. A range of bytes
+		// requested by the client (see HttpRequest::hasRange) is sent as partial content
+		// (206) and a range outside of the data is rejected (416), so that clients can
+		// resume interrupted downloads. The method must be invoked before the status or
+		// any header field is sent. Returns false, if the content was not sent completely.
+		bool sendContent(HttpDataSource& source, const char* contentType) {
+			// Check whether the status can be sent
+			if ((state & B00000011) != 0) {
+				return false;
+			}
+
+			const long length = startDataContent(source);
+			if (length < 0) {
+				return false;
+			}
+
+			return copyDataContent(startContent(contentType), source, length);
+		}
+
+		//--------------------------------------------------------------------------------
+		// Sends content of given type read from a seekable data source (see above).
+		bool sendContent(HttpDataSource& source, const __FlashStringHelper* contentType) {
+			// Check whether the status can be sent
+			if ((state & B00000011) != 0) {
+				return false;
+			}
+
+			const long length = startDataContent(source);
+			if (length < 0) {
+				return false;
+			}
+
+			return copyDataContent(startContent(contentType), source, length);
+		}
+
+		//--------------------------------------------------------------------------------
+		// Starts production of the response content with undefined content type.
+		inline Print* startContent() {
+			return startContent((const char*)NULL);
+		}
+
+		//--------------------------------------------------------------------------------
+		// Starts production of the response content of given type and returns pointer to
+		// a Print object to which the content should be printed/written.
+		Print* startContent(const char* contentType) {
+			// If header are closed, we do nothing
+			if ((state & B00000010) == B00000010) {
+				return &output;
+			}
+
+			// Produce content type
+			if (contentType != NULL) {
+				header(F("Content-Type"), contentType);
+			}
+
+			closeHeaders();
+			return &output;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Starts production of the response content of given type and returns pointer to
+		// a Print object to which the content should be printed/written.
+		Print* startContent(const __FlashStringHelper* contentType) {
+			// If header are closed, we do nothing
+			if ((state & B00000010) == B00000010) {
+				return &output;
+			}
+
+			// Produce content type
+			if (contentType != NULL) {
+				header(F("Content-Type"), contentType);
+			}
+
+			closeHeaders();
+			return &output;
+		}
+	};
+
+	/********************************************************************************
+	 * Endpoint of a WebSocket connection. Messages are sent in frames, the printed
+	 * content of a message is sent in fragments when the output buffer is full.
+	 ********************************************************************************/
+	class WebSocket: public Print {
+		template<int BUFFER_SIZE, long TIMEOUT, int OUTPUT_BUFFER_SIZE, int MAX_CONNECTIONS, bool POOLED_BUFFERS, int MAX_PARAMETERS>
+				friend class SimpleHttpHandlingController;
+	public:
+		// Opcodes of WebSocket frames
+		enum Opcode {CONTINUATION = 0x00, TEXT = 0x01, BINARY = 0x02, CLOSE = 0x08, PING = 0x09, PONG = 0x0A};
+	private:
+		// Client of the connection
+		Client* client;
+
+		// Url of the upgraded request
+		const char* url;
+
+		// Buffer for the content of a message
+		uint8_t* buffer;
+
+		// Size of the buffer
+		int bufferSize;
+
+		// Number of bytes stored in the buffer
+		int bufferedBytes;
+
+		// State of the endpoint.
+		// bit 0 - message is started
+		// bit 1 - started message is binary
+		// bit 2 - fragment of the started message has been sent
+		// bit 3 - close frame has been sent
+		uint8_t state;
+
+		//--------------------------------------------------------------------------------
+		// Writes a frame with given payload (frames sent by a server are not masked).
+		void writeFrame(uint8_t opcode, bool final, const uint8_t* payload, unsigned long length) {
+			uint8_t header[10];
+			int headerLength = 2;
+			header[0] = final ? (0x80 | opcode) : opcode;
+			if (length < 126) {
+				header[1] = length;
+			} else if (length <= 0xFFFF) {
+				header[1] = 126;
+				header[2] = (uint8_t)(length >> 8);
+				header[3] = (uint8_t)length;
+				headerLength = 4;
+			} else {
+				header[1] = 127;
+				for (int i = 0; i < 8; i++) {
+					header[9 - i] = (i < 4) ? (uint8_t)(length >> (8 * i)) : 0;
+				}
+				headerLength = 10;
+			}
+
+			client->write(header, headerLength);
+			if (length > 0) {
+				client->write(payload, length);
+			}
+		}
+
+		//--------------------------------------------------------------------------------
+		// Sends content of the started message as a fragment.
+		void writeFragment(const uint8_t* data, int length, bool final) {
+			const uint8_t opcode = ((state & B00000100) == B00000100) ? CONTINUATION : (((state & B00000010) == B00000010) ? BINARY : TEXT);
+			writeFrame(opcode, final, data, length);
+			state |= B00000100;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Constructs an endpoint for given client using given buffer for message content.
+		WebSocket(Client* client, const char* url, uint8_t* buffer, int bufferSize):client(client), url(url), buffer(buffer),
+				bufferSize(bufferSize), bufferedBytes(0), state(0) {
+			// Nothing to do
+		}
+	public:
+		//--------------------------------------------------------------------------------
+		// Returns url of the request that opened the connection.
+		inline const char* getUrl() {
+			return url;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Starts a new message and returns Print object for printing its content (the
+		// endpoint itself). Previously started message is completed.
+		Print* startMessage(bool binary) {
+			endMessage();
+			state |= B00000001;
+			if (binary) {
+				state |= B00000010;
+			}
+
+			return this;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Completes the started message.
+		void endMessage() {
+			if ((state & B00000001) == 0) {
+				return;
+			}
+
+			writeFragment(buffer, bufferedBytes, true);
+			bufferedBytes = 0;
+			state &= B11111000;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Sends a text message.
+		void send(const char* text) {
+			endMessage();
+			writeFrame(TEXT, true, (const uint8_t*)text, strlen(text));
+		}
+
+		//--------------------------------------------------------------------------------
+		// Sends a text message stored in flash memory.
+		void send(const __FlashStringHelper* text) {
+			startMessage(false)->print(text);
+			endMessage();
+		}
+
+		//--------------------------------------------------------------------------------
+		// Sends a binary message.
+		void send(const uint8_t* data, int length) {
+			endMessage();
+			writeFrame(BINARY, true, data, length);
+		}
+
+		//--------------------------------------------------------------------------------
+		// Closes the connection with given status code (1000 for normal closure).
+		void close(uint16_t statusCode) {
+			if ((state & B00001000) == B00001000) {
+				return;
+			}
+
+			endMessage();
+			const uint8_t payload[2] = {(uint8_t)(statusCode >> 8), (uint8_t)statusCode};
+			writeFrame(CLOSE, true, payload, 2);
+			state |= B00001000;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns whether the connection is closed.
+		inline bool isClosed() {
+			return ((state & B00001000) == B00001000);
+		}
+
+		//--------------------------------------------------------------------------------
+		// Writes a byte to the content of the started message (a text message is started,
+		// if no message is started).
+		virtual size_t write(uint8_t data) {
+			return write(&data, 1);
+		}
+
+		//--------------------------------------------------------------------------------
+		// Writes a block of bytes to the content of the started message (a text message is
+		// started, if no message is started).
+		virtual size_t write(const uint8_t* data, size_t size) {
+			if ((state & B00001000) == B00001000) {
+				return 0;
+			}
+
+			state |= B00000001;
+			if (bufferSize <= 0) {
+				writeFragment(data, size, false);
+				return size;
+			}
+
+			size_t written = 0;
+			while (written < size) {
+				if (bufferedBytes == bufferSize) {
+					writeFragment(buffer, bufferedBytes, false);
+					bufferedBytes = 0;
+				}
+
+				const size_t freeSpace = (size_t)(bufferSize - bufferedBytes);
+				const size_t blockSize = ((size - written) < freeSpace) ? (size - written) : freeSpace;
+				memcpy(buffer + bufferedBytes, data + written, blockSize);
+				bufferedBytes += blockSize;
+				written += blockSize;
+			}
+
+			return size;
+		}
+
+		using Print::write;
+	};
+
+	/********************************************************************************
+	 * Writer of server-sent events to an event stream
+	 ********************************************************************************/
+	class HttpEventWriter {
+	private:
+		// Output of the event stream
+		Print* out;
+	public:
+		//--------------------------------------------------------------------------------
+		// Constructs writer of events to given output.
+		HttpEventWriter(Print* out):out(out) {
+			// Nothing to do
+		}
+
+		//--------------------------------------------------------------------------------
+		// Starts an event with given name (NULL for a message event) and returns Print
+		// object for printing single-line data of the event.
+		Print* startEvent(const __FlashStringHelper* eventName) {
+			if (eventName != NULL) {
+				out->print(F("event: "));
+				out->println(eventName);
+			}
+
+			out->print(F("data: "));
+			return out;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Completes the started event.
+		void endEvent() {
+			out->println();
+			out->println();
+		}
+
+		//--------------------------------------------------------------------------------
+		// Sends an event with given name (NULL for a message event) and single-line data.
+		void send(const __FlashStringHelper* eventName, const char* data) {
+			startEvent(eventName)->print(data);
+			endEvent();
+		}
+
+		//--------------------------------------------------------------------------------
+		// Sends an event with given name (NULL for a message event) and single-line data.
+		void send(const __FlashStringHelper* eventName, const __FlashStringHelper* data) {
+			startEvent(eventName)->print(data);
+			endEvent();
+		}
+	};
+
+	/********************************************************************************
+	 * Route of the http client handler. Routes form a table stored in flash memory
+	 * (PROGMEM) that is sorted by paths (in order of strcmp). A path ending with '*'
+	 * matches all urls starting with the path prefix. If more routes match an url,
+	 * the exact path is preferred to the longest matching prefix.
+	 ********************************************************************************/
+	struct HttpRoute {
+		// Accepted request methods (bit mask)
+		enum Methods {
+			ANY_METHOD = 0, GET = B00000001, POST = B00000010, PUT = B00000100, DELETE = B00001000
+		};
+
+		// Flags modifying features applied to process a request
+		enum FeatureFlags {
+			NO_GET_PARAMETERS = B00000001, NO_POST_PARAMETERS = B00000010, ENABLE_CORS = B00000100, DISABLE_CORS = B00001000,
+			NO_AUTHENTICATION = B00010000, STREAM_BODY = B00100000
+		};
+
+		// Path pattern (string stored in flash memory)
+		const char* path;
+		// Accepted request methods (0 accepts all methods)
+		uint8_t methods;
+		// Flags modifying default features of request processing
+		uint8_t features;
+		// Authentication settings replacing the default settings (NULL keeps the default settings)
+		const __FlashStringHelper* authentication;
+		// Handler that processes the request
+		void (*handler)(HttpRequest& request, HttpResponse& response);
+	};
+
+	/********************************************************************************
+	 * Static asset (file) stored in flash memory. Tables of assets sorted by paths
+	 * (in order of strcmp) are produced by the StaticAssetsGenerator tool (extras).
+	 ********************************************************************************/
+	struct HttpStaticAsset {
+		// Flags of the asset
+		enum Flags {
+			GZIP = B00000001
+		};
+
+		// Path of the asset (string stored in flash memory)
+		const char* path;
+		// Content type (string stored in flash memory)
+		const char* contentType;
+		// Quoted entity tag of the content (string stored in flash memory)
+		const char* etag;
+		// Content of the asset (stored in flash memory)
+		const uint8_t* data;
+		// Length of the content in bytes
+		unsigned long length;
+		// Flags of the asset
+		uint8_t flags;
+	};
+
+	/********************************************************************************
+	 * Responder sending static assets stored in flash memory. Browsers revalidate
+	 * cached assets using entity tags and an unchanged asset is not sent again.
+	 ********************************************************************************/
+	class StaticAssetResponder {
+	private:
+		// Table of assets stored in flash memory (sorted by paths)
+		const HttpStaticAsset* assets;
+
+		// Number of assets in the table
+		int assetCount;
+
+		//--------------------------------------------------------------------------------
+		// Returns whether the If-None-Match header matches given entity tag.
+		bool etagMatches(const char* ifNoneMatch, const char* etag) {
+			if (ifNoneMatch == NULL) {
+				return false;
+			}
+
+			if ((ifNoneMatch[0] == '*') && (ifNoneMatch[1] == 0)) {
+				return true;
+			}
+
+			// Quoted entity tag is searched in the list (weak tags match too)
+			return strstr_P(ifNoneMatch, etag) != NULL;
+		}
+	public:
+		//--------------------------------------------------------------------------------
+		// Constructs responder for a table of assets stored in flash memory.
+		StaticAssetResponder(const HttpStaticAsset* assets, int assetCount):assets(assets), assetCount(assetCount) {
+			// Nothing to do
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns the index of the asset with given path or -1, if there is no such asset.
+		int find(const char* path) {
+			if (path == NULL) {
+				return -1;
+			}
+
+			int from = 0;
+			int to = assetCount;
+			while (from < to) {
+				const int middle = from + (to - from) / 2;
+				const char* assetPath;
+				memcpy_P(&assetPath, &(assets[middle].path), sizeof(assetPath));
+				const int cmp = strcmp_P(path, assetPath);
+				if (cmp == 0) {
+					return middle;
+				}
+
+				if (cmp < 0) {
+					to = middle;
+				} else {
+					from = middle + 1;
+				}
+			}
+
+			return -1;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Sends the asset with the requested url. Returns false, if there is no such asset
+		// (the response is not modified). A gzipped asset is stored only compressed, so a
+		// client that does not accept gzip gets 406 Not Acceptable.
+		bool respond(HttpRequest& request, HttpResponse& response) {
+			const int assetIdx = find(request.getUrl());
+			if (assetIdx < 0) {
+				return false;
+			}
+
+			HttpStaticAsset asset;
+			memcpy_P(&asset, assets + assetIdx, sizeof(HttpStaticAsset));
+			const bool gzipped = ((asset.flags & HttpStaticAsset::GZIP) != 0);
+
+			// Compressed content cannot be sent to a client that does not accept it
+			if (gzipped && !request.acceptsGzip()) {
+				response.setStatus(406, F("Not Acceptable"));
+				return true;
+			}
+
+			// Validate content cached by the client
+			const bool notModified = etagMatches(request.getIfNoneMatch(), asset.etag);
+			if (notModified) {
+				response.setStatus(304, F("Not Modified"));
+			}
+
+			// Cached content must be always revalidated
+			response.header(F("ETag"), reinterpret_cast<const __FlashStringHelper*>(asset.etag));
+			response.header(F("Cache-Control"), F("no-cache"));
+			if (gzipped) {
+				response.header(F("Content-Encoding"), F("gzip"));
+				response.header(F("Vary"), F("Accept-Encoding"));
+			}
+
+			// Response to a validation request has no content
+			response.setContentLength(asset.length);
+			if (notModified) {
+				return true;
+			}
+
+			// Send content in blocks copied from flash memory
+			Print* out = response.startContent(reinterpret_cast<const __FlashStringHelper*>(asset.contentType));
+			uint8_t block[32];
+			unsigned long offset = 0;
+			while (offset < asset.length) {
+				const size_t blockSize = (asset.length - offset < sizeof(block)) ? (size_t)(asset.length - offset) : sizeof(block);
+				memcpy_P(block, asset.data + offset, blockSize);
+				out->write(block, blockSize);
+				offset += blockSize;
+			}
+
+			return true;
+		}
+	};
+
+	/********************************************************************************
+	 * Timing of request processing phases and counters of failed requests. The
+	 * metrics are collected by the handler, if they are set (see setMetrics).
+	 ********************************************************************************/
+	class HttpMetrics {
+	public:
+		// Measured phases of request processing
+		enum Phase {
+			// Receiving of the request line (since the first byte of the request)
+			REQUEST_LINE = 0,
+			// Receiving of header fields
+			HEADER_FIELDS = 1,
+			// Receiving of the request body (requests with content only)
+			BODY = 2,
+			// Production of the response by the application
+			PROCESSING = 3,
+			// Closing of a non-persistent connection
+			CLOSING = 4
+		};
+
+		// Number of measured phases
+		static const uint8_t PHASE_COUNT = 5;
+
+		// Number of counted error codes (0, -1, -2, -10, -20, -30 and other codes)
+		static const uint8_t ERROR_CODE_COUNT = 7;
+	private:
+		// Statistics of durations of a phase in microseconds
+		struct PhaseStatistics {
+			// Number of measurements
+			unsigned long count;
+			// Whole seconds of the total duration
+			unsigned long totalSeconds;
+			// Microseconds of the total duration (less than one second)
+			unsigned long totalMicros;
+			// Minimal duration
+			unsigned long minTime;
+			// Maximal duration
+			unsigned long maxTime;
+		};
+
+		// Statistics of phases
+		PhaseStatistics phases[PHASE_COUNT];
+
+		// Counters of failed requests by error codes
+		unsigned long errors[ERROR_CODE_COUNT];
+
+		// Maximal time in microseconds of a single invocation of the server looper
+		unsigned long maxHoldTime;
+
+		//--------------------------------------------------------------------------------
+		// Returns name of a phase.
+		static const __FlashStringHelper* getPhaseName(uint8_t phase) {
+			switch (phase) {
+			case REQUEST_LINE:
+				return F("request_line");
+			case HEADER_FIELDS:
+				return F("header_fields");
+			case BODY:
+				return F("body");
+			case PROCESSING:
+				return F("processing");
+			default:
+				return F("closing");
+			}
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns error code counted at given index of error counters.
+		static int getErrorCode(uint8_t errorIdx) {
+			switch (errorIdx) {
+			case 0:
+				return 0;
+			case 1:
+				return -1;
+			case 2:
+				return -2;
+			default:
+				return -10 * (errorIdx - 2);
+			}
+		}
+
+		//--------------------------------------------------------------------------------
+		// Prints a duration in microseconds as seconds.
+		static void printSeconds(Print* out, unsigned long seconds, unsigned long micros) {
+			out->print(seconds);
+			out->print('.');
+			for (unsigned long order = 100000UL; order > 1; order /= 10) {
+				if (micros < order) {
+					out->print('0');
+				}
+			}
+			out->print(micros);
+		}
+
+		//--------------------------------------------------------------------------------
+		// Prints header (help and type) of a metric.
+		static void printMetricHeader(Print* out, const __FlashStringHelper* name, const __FlashStringHelper* type, const __FlashStringHelper* help) {
+			out->print(F("# HELP "));
+			out->print(name);
+			out->print(' ');
+			out->println(help);
+			out->print(F("# TYPE "));
+			out->print(name);
+			out->print(' ');
+			out->println(type);
+		}
+
+		//--------------------------------------------------------------------------------
+		// Prints name of a metric with label of a phase.
+		static void printPhaseMetric(Print* out, const __FlashStringHelper* name, uint8_t phase) {
+			out->print(name);
+			out->print(F("{phase=\""));
+			out->print(getPhaseName(phase));
+			out->print(F("\"} "));
+		}
+	public:
+		//--------------------------------------------------------------------------------
+		// Constructs empty metrics.
+		HttpMetrics() {
+			reset();
+		}
+
+		//--------------------------------------------------------------------------------
+		// Resets all statistics and counters.
+		void reset() {
+			for (int i = 0; i < PHASE_COUNT; i++) {
+				phases[i].count = 0;
+				phases[i].totalSeconds = 0;
+				phases[i].totalMicros = 0;
+				phases[i].minTime = 0xFFFFFFFFUL;
+				phases[i].maxTime = 0;
+			}
+
+			for (int i = 0; i < ERROR_CODE_COUNT; i++) {
+				errors[i] = 0;
+			}
+
+			maxHoldTime = 0;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Records duration of a phase in microseconds.
+		void recordPhase(uint8_t phase, unsigned long duration) {
+			if (phase >= PHASE_COUNT) {
+				return;
+			}
+
+			PhaseStatistics& statistics = phases[phase];
+			statistics.count++;
+			statistics.totalSeconds += duration / 1000000UL;
+			statistics.totalMicros += duration % 1000000UL;
+			if (statistics.totalMicros >= 1000000UL) {
+				statistics.totalSeconds++;
+				statistics.totalMicros -= 1000000UL;
+			}
+
+			if (duration < statistics.minTime) {
+				statistics.minTime = duration;
+			}
+
+			if (duration > statistics.maxTime) {
+				statistics.maxTime = duration;
+			}
+		}
+
+		//--------------------------------------------------------------------------------
+		// Records time in microseconds for which the handler held the CPU in a single
+		// invocation of the server looper.
+		inline void recordHoldTime(unsigned long duration) {
+			if (duration > maxHoldTime) {
+				maxHoldTime = duration;
+			}
+		}
+
+		//--------------------------------------------------------------------------------
+		// Records a request that failed with given error code (see handleInvalidState).
+		void recordError(int errorCode) {
+			uint8_t errorIdx = ERROR_CODE_COUNT - 1;
+			for (uint8_t i = 0; i < ERROR_CODE_COUNT - 1; i++) {
+				if (getErrorCode(i) == errorCode) {
+					errorIdx = i;
+					break;
+				}
+			}
+
+			errors[errorIdx]++;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns number of measurements of a phase.
+		inline unsigned long getCount(uint8_t phase) {
+			return (phase < PHASE_COUNT) ? phases[phase].count : 0;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns minimal duration of a phase in microseconds.
+		inline unsigned long getMinTime(uint8_t phase) {
+			return ((phase < PHASE_COUNT) && (phases[phase].count > 0)) ? phases[phase].minTime : 0;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns average duration of a phase in microseconds.
+		unsigned long getAverageTime(uint8_t phase) {
+			if ((phase >= PHASE_COUNT) || (phases[phase].count == 0)) {
+				return 0;
+			}
+
+			const PhaseStatistics& statistics = phases[phase];
+			return (statistics.totalSeconds / statistics.count) * 1000000UL
+					+ ((statistics.totalSeconds % statistics.count) * 1000000UL + statistics.totalMicros) / statistics.count;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns maximal duration of a phase in microseconds.
+		inline unsigned long getMaxTime(uint8_t phase) {
+			return (phase < PHASE_COUNT) ? phases[phase].maxTime : 0;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns maximal time in microseconds for which the handler held the CPU.
+		inline unsigned long getMaxHoldTime() {
+			return maxHoldTime;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns number of requests that failed with given error code.
+		unsigned long getErrorCount(int errorCode) {
+			for (uint8_t i = 0; i < ERROR_CODE_COUNT - 1; i++) {
+				if (getErrorCode(i) == errorCode) {
+					return errors[i];
+				}
+			}
+
+			return errors[ERROR_CODE_COUNT - 1];
+		}
+
+		//--------------------------------------------------------------------------------
+		// Prints the metrics in Prometheus text format.
+		void print(Print* out) {
+			printMetricHeader(out, F("http_phase_duration_seconds"), F("summary"), F("Duration of request processing phases."));
+			for (uint8_t i = 0; i < PHASE_COUNT; i++) {
+				printPhaseMetric(out, F("http_phase_duration_seconds_sum"), i);
+				printSeconds(out, phases[i].totalSeconds, phases[i].totalMicros);
+				out->println();
+				printPhaseMetric(out, F("http_phase_duration_seconds_count"), i);
+				out->println(phases[i].count);
+			}
+
+			printMetricHeader(out, F("http_phase_duration_min_seconds"), F("gauge"), F("Minimal duration of request processing phases."));
+			for (uint8_t i = 0; i < PHASE_COUNT; i++) {
+				printPhaseMetric(out, F("http_phase_duration_min_seconds"), i);
+				const unsigned long minTime = getMinTime(i);
+				printSeconds(out, minTime / 1000000UL, minTime % 1000000UL);
+				out->println();
+			}
+
+			printMetricHeader(out, F("http_phase_duration_max_seconds"), F("gauge"), F("Maximal duration of request processing phases."));
+			for (uint8_t i = 0; i < PHASE_COUNT; i++) {
+				printPhaseMetric(out, F("http_phase_duration_max_seconds"), i);
+				printSeconds(out, phases[i].maxTime / 1000000UL, phases[i].maxTime % 1000000UL);
+				out->println();
+			}
+
+			printMetricHeader(out, F("http_handler_max_hold_seconds"), F("gauge"),
+					F("Maximal time for which the handler held the CPU in a single looper invocation."));
+			out->print(F("http_handler_max_hold_seconds "));
+			printSeconds(out, maxHoldTime / 1000000UL, maxHoldTime % 1000000UL);
+			out->println();
+
+			printMetricHeader(out, F("http_request_errors_total"), F("counter"), F("Failed requests by error code."));
+			for (uint8_t i = 0; i < ERROR_CODE_COUNT; i++) {
+				out->print(F("http_request_errors_total{code=\""));
+				if (i < ERROR_CODE_COUNT - 1) {
+					out->print(getErrorCode(i));
+				} else {
+					out->print(F("other"));
+				}
+				out->print(F("\"} "));
+				out->println(errors[i]);
+			}
+		}
+
+		//--------------------------------------------------------------------------------
+		// Produces response with the metrics in Prometheus text format (can be used by
+		// a route handler).
+		void respond(HttpResponse& response) {
+			print(response.startContent(F("text/plain; version=0.0.4")));
+		}
+	};
+
+	/********************************************************************************
+	 * Controller for a simple http client handler.
+	 ********************************************************************************/
+	template<int BUFFER_SIZE, long TIMEOUT, int OUTPUT_BUFFER_SIZE, int MAX_CONNECTIONS, bool POOLED_BUFFERS, int MAX_PARAMETERS>
+			class SimpleHttpHandlingController {
+		friend class TSimpleHttpClientHandler<BUFFER_SIZE, TIMEOUT, OUTPUT_BUFFER_SIZE, MAX_CONNECTIONS, POOLED_BUFFERS, MAX_PARAMETERS>;
+	private:
+		// Server managed by (associated with) this client handler.
+		acp_network_libs_handling_srv::LoopingServer* server;
+
+		// State of the controller
+		// bit 0 indicates whether the associated server was initialized
+		// bit 1 indicates whether CORS support is enabled
+		uint8_t state;
+
+		// Authentication settings (see Features struct for more details)
+		const __FlashStringHelper* authentication;
+
+		// Maximal idle time in milliseconds of a persistent connection (0 disables persistent connections)
+		unsigned long keepAliveTimeout;
+
+		// Maximal number of requests served over a persistent connection
+		uint8_t maxKeepAliveRequests;
+
+		// Maximal number of concurrent event streams and WebSockets
+		uint8_t maxEventStreams;
+
+		// Interval in milliseconds between heartbeats sent to idle event streams and WebSockets (0 disables heartbeats)
+		unsigned long eventHeartbeat;
+
+		// Sequence number of the last published event
+		unsigned long eventSequence;
+
+		// Table of routes stored in flash memory (sorted by paths)
+		const HttpRoute* routes;
+
+		// Number of routes in the table
+		int routeCount;
+
+		// Metrics of request processing (NULL, if metrics are not collected)
+		HttpMetrics* metrics;
+
+		// Pool for leasing request and output buffers (used only with pooled buffers)
+		acp_utils_buffer_pool::BufferPool* bufferPool;
+
+		// Buffers for storing all request related data (URL, parameters, etc.), one buffer per connection slot.
+		// With pooled buffers, a connection leases its buffer from the pool only while a request is processed.
+		uint8_t requestBuffers[POOLED_BUFFERS ? 1 : MAX_CONNECTIONS][POOLED_BUFFERS ? 1 : BUFFER_SIZE + 1];
+
+		// Storage of indices of request parameters, one index per connection slot
+		HttpParameter parameterIndexes[MAX_CONNECTIONS][MAX_PARAMETERS];
+
+		// States of connections processed by the controller
+		ConnectionState connections[MAX_CONNECTIONS];
+
+		/********************************************************************************
+		 * Buffer for coalescing small writes of a response (leased from the pool or
+		 * allocated on the stack)
+		 ********************************************************************************/
+		class OutputBuffer {
+		private:
+			// Lease of the pooled buffer
+			acp_utils_buffer_pool::BufferLease lease;
+
+			// Buffer on the stack
+			uint8_t storage[(!POOLED_BUFFERS && (OUTPUT_BUFFER_SIZE > 0)) ? OUTPUT_BUFFER_SIZE : 1];
+		public:
+			OutputBuffer(acp_utils_buffer_pool::BufferPool* pool): lease(POOLED_BUFFERS ? pool : NULL, OUTPUT_BUFFER_SIZE) {
+				// Nothing to do
+			}
+
+			// Returns the buffer.
+			inline uint8_t* get() {
+				return POOLED_BUFFERS ? lease.get() : storage;
+			}
+
+			// Returns size of the buffer (0, if a pooled buffer is not available).
+			inline int size() {
+				return (POOLED_BUFFERS && (lease.get() == NULL)) ? 0 : OUTPUT_BUFFER_SIZE;
+			}
+		};
+
+		// Results of receiving a request (non-positive results are error codes, see handleInvalidState)
+		enum {REQUEST_RECEIVED = 1, REQUEST_INCOMPLETE = 2};
+
+		// Results of processing a WebSocket frame
+		enum {FRAME_PROCESSED, FRAME_INCOMPLETE, FRAME_CLOSED};
+
+		//--------------------------------------------------------------------------------
+		// Reads at most given number of bytes from client to buffer.
+		int readBytes(Client& client, uint8_t* buffer, int length) {
+			const bool useBlockRead = true;
+			if (useBlockRead) {
+				return client.read(buffer, length);
+			} else {
+				int receivedBytes = 0;
+				while (client.connected() && client.available() && (receivedBytes < length)) {
+					int ch = client.read();
+					if (ch >= 0) {
+						*buffer = (char)ch;
+						buffer++;
+						receivedBytes++;
+					}
+				}
+				return receivedBytes;
+			}
+		}
+
+		//--------------------------------------------------------------------------------
+		// Appends bytes available in the client (without waiting for new data) to the receive
+		// buffer so that the buffer contains at most limit bytes.
+		// Returns the number of received bytes or -1, if the client is in a wrong state.
+		int receiveAvailable(Client& client, RequestProcessingData& requestData, int limit) {
+			const int freeSize = limit - requestData.bufferedBytes;
+			if (freeSize <= 0) {
+				return 0;
+			}
+
+			int availableBytes = client.available();
+			if (availableBytes <= 0) {
+				return 0;
+			}
+
+			// Eliminate the buffer overflow
+			if (availableBytes > freeSize) {
+				availableBytes = freeSize;
+			}
+
+			const int receivedBytes = readBytes(client, requestData.buffer + requestData.bufferedBytes, availableBytes);
+			if ((receivedBytes < 0) || (receivedBytes > availableBytes)) {
+				return -1;
+			}
+
+			requestData.bufferedBytes += receivedBytes;
+			return receivedBytes;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Ensures that the connection has a request buffer. Returns false, if a pooled
+		// buffer is not available.
+		bool acquireRequestBuffer(ConnectionState& connection) {
+			if (POOLED_BUFFERS && (connection.requestBuffer == NULL) && (bufferPool != NULL)) {
+				connection.requestBuffer = bufferPool->lease(BUFFER_SIZE + 1);
+			}
+
+			return connection.requestBuffer != NULL;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns a pooled request buffer of the connection to the pool.
+		void releaseRequestBuffer(ConnectionState& connection) {
+			if (POOLED_BUFFERS && (connection.requestBuffer != NULL)) {
+				bufferPool->release(connection.requestBuffer);
+				connection.requestBuffer = NULL;
+			}
+		}
+
+		//--------------------------------------------------------------------------------
+		// Rejects a request that cannot be received due to lack of pooled buffers.
+		void rejectRequest(Client& client) {
+			ACP_TRACE(F("HTTP: 503 no free buffer."));
+			client.print(F("HTTP/1.1 503 Service Unavailable\r\nRetry-After: 1\r\nContent-Length: 0\r\nConnection: close\r\n\r\n"));
+			closeConnection(client);
+		}
+
+		//--------------------------------------------------------------------------------
+		// Closes the client
+		void closeConnection(Client& client) {
+			client.flush();
+			delay(1);
+			client.stop();
+		}
+
+		//--------------------------------------------------------------------------------
+		// Moves unprocessed data to the beginning of the receive buffer.
+		void compactBuffer(RequestProcessingData& requestData) {
+			uint8_t* target = requestData.buffer;
+			const uint8_t* dataPtr = requestData.buffer + requestData.readPosition;
+			const uint8_t* const dataEnd = requestData.buffer + requestData.bufferedBytes;
+			while (dataPtr != dataEnd) {
+				*target = *dataPtr;
+				target++;
+				dataPtr++;
+			}
+
+			requestData.bufferedBytes -= requestData.readPosition;
+			requestData.readPosition = 0;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Excludes given number of bytes at the beginning of the receive buffer from the
+		// buffer (the bytes store retained request data).
+		void retainBufferPrefix(RequestProcessingData& requestData, int prefixLength) {
+			requestData.buffer += prefixLength;
+			requestData.bufferSize -= prefixLength;
+			requestData.bufferedBytes -= prefixLength;
+			requestData.readPosition -= prefixLength;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Locates character in block of memory.
+		// Returns the index of the first occurrence or -1, if the character is not found.
+		int locateCharacter(const uint8_t* ptr, int value, int num) {
+			for (int i=0; i<num; i++) {
+				if (*ptr == value) {
+					return i;
+				}
+
+				ptr++;
+			}
+
+			return -1;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Checks whether the content of a buffer starts with a given string.
+		bool startsWithFString(const uint8_t* ptr, const __FlashStringHelper* ifsh) {
+			PGM_P p = reinterpret_cast<PGM_P>(ifsh);
+			while (true) {
+				const unsigned char c = pgm_read_byte(p);
+				if (c == 0) {
+					return true;
+				}
+
+				if (c != *ptr) {
+					return false;
+				}
+
+				ptr++;
+				p++;
+			}
+		}
+
+		//--------------------------------------------------------------------------------
+		// Handles an invalid state.
+		void handleInvalidState(Client& client, int errorCode, unsigned long requestStartTime) {
+			if (metrics != NULL) {
+				metrics->recordError(errorCode);
+			}
+
+			// Log error
+			if (errorCode == 0) {
+				ACP_TRACE(F("HTTP: client disconnected before request completed."));
+			} else if (errorCode == -1) {
+				ACP_TRACE(F("HTTP: request (receive) buffer congested."));
+			} else if (errorCode == -2) {
+				ACP_TRACE(F("HTTP: timeout."));
+			} else if (errorCode == -30) {
+				ACP_TRACE(F("HTTP: request content too large."));
+			} else {
+				ACP_TRACE(F("HTTP: unexpected error (%d)."), errorCode);
+			}
+
+			// If the client is not connected, it is not possible to inform the client
+			if (!client.connected()) {
+				return;
+			}
+
+			if (errorCode == -30) {
+				client.println(F("HTTP/1.1 413 Content Too Large"));
+			} else {
+				client.println(F("HTTP/1.1 500 Internal Error"));
+			}
+			client.println(F("Connection: close"));
+			closeConnection(client);
+		}
+
+		//--------------------------------------------------------------------------------
+		// Realizes basic http authentication (including the 401 response, if necessary)
+		// Returns true, if the user is authorized, false otherwise.
+		bool handleBasicAuthentication(const uint8_t* authHeaderField, const __FlashStringHelper* authSetting) {
+			if (authSetting == NULL) {
+				return true;
+			}
+
+			PGM_P settingPtr = reinterpret_cast<PGM_P>(authSetting);
+			bool authenticated = true;
+
+			// Check basic authentication method
+			while ((*authHeaderField != 0) && (*authHeaderField != ':')) {
+				authHeaderField++;
+			}
+
+			if (*authHeaderField != 0) {
+				authHeaderField++;
+			}
+
+			while (*authHeaderField == ' ') {
+				authHeaderField++;
+			}
+
+			if (startsWithFString((const uint8_t*)authHeaderField, F("Basic "))) {
+				authHeaderField += 6;
+			} else {
+				authenticated = false;
+			}
+
+			if (authenticated) {
+				// Check whether authorization data match content of the field
+				while (true) {
+					const char c = pgm_read_byte(settingPtr);
+					// Check whether authentication settings reached the end of login:password part
+					if ((c == 0) || (c == ':')) {
+						authenticated = (*authHeaderField == '\r') || (*authHeaderField == 0);
+						break;
+					}
+
+					// Check whether required and received authentication strings match
+					if (*authHeaderField != c) {
+						authenticated = false;
+						break;
+					}
+
+					settingPtr++;
+					authHeaderField++;
+				}
+			}
+
+			return authenticated;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Stores the value of a header field (the line at the read position) terminated with
+		// zero in front of the receive buffer. Only the value is copied, processed lines
+		// before the field are released. Returns the stored value and updates the end of line.
+		const char* retainHeaderValue(RequestProcessingData& requestData, const uint8_t* line, int colonPos, int& lineEnd) {
+			int valueStart = colonPos + 1;
+			while (line[valueStart] == ' ') {
+				valueStart++;
+			}
+
+			int valueEnd = valueStart;
+			while ((line[valueEnd] != '\r') && (line[valueEnd] != '\n')) {
+				valueEnd++;
+			}
+
+			const int valueLength = valueEnd - valueStart;
+			memmove(requestData.buffer, line + valueStart, valueLength);
+			requestData.buffer[valueLength] = 0;
+			const char* value = (const char*)(requestData.buffer);
+			retainBufferPrefix(requestData, valueLength + 1);
+			lineEnd -= valueLength + 1;
+			return value;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns character at given position of the path of a route.
+		uint8_t getRoutePathChar(int routeIdx, int position) {
+			const char* path;
+			memcpy_P(&path, &(routes[routeIdx].path), sizeof(path));
+			return pgm_read_byte(path + position);
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns the index of the first route in the range [from, to) whose path has
+		// a character greater than (or equal to, if orEqual is true) given character at
+		// given position. Paths of all routes in the range share the prefix before the position.
+		int findRouteBound(int from, int to, int position, uint8_t c, bool orEqual) {
+			while (from < to) {
+				const int middle = from + (to - from) / 2;
+				const uint8_t pathChar = getRoutePathChar(middle, position);
+				if ((pathChar > c) || (orEqual && (pathChar == c))) {
+					to = middle;
+				} else {
+					from = middle + 1;
+				}
+			}
+
+			return from;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns the index of the first route in the range [from, to) that accepts given
+		// method or -1, if there is no such route.
+		int findRouteWithMethod(int from, int to, HttpMethod method) {
+			// OPTIONS requests (CORS preflights) use features of a route with any method
+			uint8_t methodMask;
+			switch ((HttpMethod::Type)method) {
+			case HttpMethod::GET:
+				methodMask = HttpRoute::GET;
+				break;
+			case HttpMethod::POST:
+				methodMask = HttpRoute::POST;
+				break;
+			case HttpMethod::PUT:
+				methodMask = HttpRoute::PUT;
+				break;
+			case HttpMethod::DELETE:
+				methodMask = HttpRoute::DELETE;
+				break;
+			default:
+				methodMask = 0xFF;
+				break;
+			}
+
+			for (int i = from; i < to; i++) {
+				const uint8_t methods = pgm_read_byte(&(routes[i].methods));
+				if ((methods == HttpRoute::ANY_METHOD) || ((methods & methodMask) != 0)) {
+					return i;
+				}
+			}
+
+			return -1;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Finds the route for an url in a single pass over the url. For each character
+		// of the url, the range of routes sharing the url prefix is narrowed by binary search.
+		// Returns the index of the route or -1, if no route matches the url.
+		int findRoute(const char* url, HttpMethod method) {
+			int from = 0;
+			int to = routeCount;
+			int prefixRoute = -1;
+			for (int position = 0; from < to; position++) {
+				// Routes with a prefix pattern that ends at this position
+				const int wildcardFrom = findRouteBound(from, to, position, '*', true);
+				const int wildcardTo = findRouteBound(wildcardFrom, to, position, '*', false);
+				const int wildcardRoute = findRouteWithMethod(wildcardFrom, wildcardTo, method);
+				if (wildcardRoute >= 0) {
+					prefixRoute = wildcardRoute;
+				}
+
+				const uint8_t c = url[position];
+				if (c == 0) {
+					// Routes with an exact path are at the beginning of the range
+					const int exactRoute = findRouteWithMethod(from, findRouteBound(from, to, position, 0, false), method);
+					return (exactRoute >= 0) ? exactRoute : prefixRoute;
+				}
+
+				from = findRouteBound(from, to, position, c, true);
+				to = findRouteBound(from, to, position, c, false);
+			}
+
+			return prefixRoute;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Applies the route matching the requested url to request processing.
+		void applyRoute(ConnectionState& connection) {
+			connection.routeHandler = NULL;
+			if (routes == NULL) {
+				return;
+			}
+
+			const int routeIdx = findRoute(connection.requestData.url, connection.requestData.method);
+			if (routeIdx < 0) {
+				return;
+			}
+
+			HttpRoute route;
+			memcpy_P(&route, routes + routeIdx, sizeof(HttpRoute));
+			connection.routeHandler = route.handler;
+
+			// Update features with respect to the route
+			Features& features = connection.features;
+			if ((route.features & HttpRoute::NO_GET_PARAMETERS) != 0) {
+				features.storeGetParameters = false;
+			}
+
+			if ((route.features & HttpRoute::NO_POST_PARAMETERS) != 0) {
+				features.storePostParameters = false;
+			}
+
+			if ((route.features & HttpRoute::STREAM_BODY) != 0) {
+				features.streamBody = true;
+			}
+
+			if ((route.features & HttpRoute::ENABLE_CORS) != 0) {
+				features.enableCORS = true;
+			} else if ((route.features & HttpRoute::DISABLE_CORS) != 0) {
+				features.enableCORS = false;
+			}
+
+			if ((route.features & HttpRoute::NO_AUTHENTICATION) != 0) {
+				features.authentication = NULL;
+			} else if (route.authentication != NULL) {
+				features.authentication = route.authentication;
+			}
+		}
+
+		//--------------------------------------------------------------------------------
+		// Prepares a connection for receiving a new request.
+		void startRequest(ConnectionState& connection) {
+			// Bundle with data retrieved from the request
+			RequestProcessingData& requestData = connection.requestData;
+			requestData = RequestProcessingData();
+
+			// Initialized floating receive buffer inside request buffer
+			connection.requestBuffer[BUFFER_SIZE] = 0;
+			requestData.buffer = connection.requestBuffer;// start of receive buffer
+			requestData.bufferedBytes = 0;// number of received bytes in the buffer
+			requestData.readPosition = 0;// position of the first unprocessed byte in the buffer
+			requestData.bufferSize = BUFFER_SIZE;// size of the receive buffer
+			requestData.parameters = connection.parameterIndex;
+			requestData.parameterCapacity = MAX_PARAMETERS;
+
+			// Store start time
+			requestData.startTime = millis();
+
+			// Initialize features
+			Features& features = connection.features;
+			features.storeGetParameters = true;
+			features.storePostParameters = true;
+			features.enableCORS = ((state & B00000010) == B00000010);
+			features.authentication = authentication;
+			features.storeIfNoneMatch = true;
+			features.streamBody = false;
+
+			connection.authenticated = false;
+			connection.activityTime = requestData.startTime;
+			connection.phaseStartTime = micros();
+			connection.phase = ConnectionState::REQUEST_LINE;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Records duration of a completed phase of request processing (if metrics are
+		// collected) and starts the next phase.
+		void completePhase(ConnectionState& connection, uint8_t phase) {
+			const unsigned long now = micros();
+			if (metrics != NULL) {
+				metrics->recordPhase(phase, now - connection.phaseStartTime);
+			}
+
+			connection.phaseStartTime = now;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Processes the request line of length lineLength (including the LF character)
+		// located at the read position of the receive buffer. If lineLength is -1, the line
+		// does not fit into the buffer.
+		// Returns REQUEST_INCOMPLETE, if header fields are expected, or an error code.
+		int processRequestLine(ConnectionState& connection, int lineLength) {
+			RequestProcessingData& requestData = connection.requestData;
+			Features& features = connection.features;
+
+			if (lineLength <= 0) {
+				return lineLength;
+			}
+
+			uint8_t* const line = requestData.buffer + requestData.readPosition;
+			const int lineEnd = requestData.readPosition + lineLength;
+
+			int spaceIdx = locateCharacter(line, ' ', lineLength);
+			if (spaceIdx < 0) {
+				// Protocol error
+				return -10;
+			}
+
+			// Detect method
+			if ((spaceIdx == 3) && startsWithFString(line, F("GET"))) {
+				requestData.method = HttpMethod::GET;
+			} else if ((spaceIdx == 4) && startsWithFString(line, F("POST"))) {
+				requestData.method = HttpMethod::POST;
+			} else if ((spaceIdx == 7) && startsWithFString(line, F("OPTIONS"))) {
+				requestData.method = HttpMethod::OPTIONS;
+			} else if ((spaceIdx == 3) && startsWithFString(line, F("PUT"))) {
+				requestData.method = HttpMethod::PUT;
+			} else if ((spaceIdx == 6) && startsWithFString(line, F("DELETE"))) {
+				requestData.method = HttpMethod::DELETE;
 			} else {
-				authenticated = false;
+				return -20;
+			}
+
+			// URL follows the method in the line
+			uint8_t* const urlPtr = line + (spaceIdx + 1);
+			const int urlLineLength = lineLength - (spaceIdx + 1);
+			requestData.url = (const char*)urlPtr;
+
+			// Find space after URL with get parameters
+			spaceIdx = locateCharacter(urlPtr, ' ', urlLineLength);
+			if (spaceIdx < 0) {
+				// Protocol error
+				return -10;
+			}
+
+			// HTTP/1.1 clients use persistent connections by default
+			if ((urlLineLength >= spaceIdx + 9) && startsWithFString(urlPtr + spaceIdx + 1, F("HTTP/1.1"))) {
+				requestData.keepAlive = true;
+				requestData.http11 = true;
+			}
+
+			// Find question mark that delimits get parameters
+			int qmPos = locateCharacter(urlPtr, '?', spaceIdx);
+
+			// Ends URL string with null
+			int urlLength = spaceIdx;
+			urlPtr[spaceIdx] = 0;
+			if (qmPos >= 0) {
+				urlPtr[qmPos] = 0;
+				urlLength = qmPos;
+			}
+
+			// Update request processing features for requested URL
+			applyRoute(connection);
+			setFeatures(requestData.url, features);
+
+			// Disable some features for OPTIONS request (usually a CORS preflight request)
+			if (requestData.method == HttpMethod::OPTIONS) {
+				features.storeGetParameters = false;
+				features.storePostParameters = false;
+				features.streamBody = false;
+			}
+
+			// Disable processing of POST data for other request methods
+			if (requestData.method != HttpMethod::POST) {
+				features.storePostParameters = false;
+			}
+
+			// Process get parameters (if accepted and received)
+			int retainedUrlBytes;
+			if ((features.storeGetParameters) && (qmPos >= 0)) {
+				requestData.getParameters = (char*)(urlPtr + (qmPos+1));
+				retainedUrlBytes = spaceIdx + 1;
+			} else {
+				retainedUrlBytes = urlLength + 1;
+			}
+
+			// URL and get parameters remain in place, the rest of the line is skipped
+			const int retainedBytes = (urlPtr - requestData.buffer) + retainedUrlBytes;
+			retainBufferPrefix(requestData, retainedBytes);
+			requestData.readPosition = lineEnd - retainedBytes;
+
+			ACP_TRACE(F("HTTP: requested url %s"), requestData.url);
+
+			// Set initial authentication
+			connection.authenticated = (features.authentication == NULL);
+			completePhase(connection, HttpMetrics::REQUEST_LINE);
+			connection.phase = ConnectionState::HEADER_FIELDS;
+			return REQUEST_INCOMPLETE;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns whether the value (of given length) of the Accept-Encoding header accepts
+		// gzip content coding. The coding is accepted, if it is listed as gzip, x-gzip or
+		// matched by *, unless its quality value is 0 (e.g., "gzip;q=0").
+		bool parseAcceptsGzip(const uint8_t* value, int length) {
+			// Quality of gzip and of any other coding (-1 if not listed, 0 refused, 1 accepted)
+			int gzipQuality = -1;
+			int anyQuality = -1;
+
+			int i = 0;
+			while (i < length) {
+				// Skip separators and whitespaces before the coding
+				while ((i < length) && ((value[i] == ',') || (value[i] == ' ') || (value[i] == '\t'))) {
+					i++;
+				}
+
+				const int codingStart = i;
+				while ((i < length) && (value[i] != ',') && (value[i] != ';') && (value[i] > ' ')) {
+					i++;
+				}
+
+				const uint8_t* coding = value + codingStart;
+				const int codingLength = i - codingStart;
+
+				// Only the quality value (0 or 0.000 refuses the coding) matters in parameters
+				int quality = 1;
+				while ((i < length) && (value[i] != ',')) {
+					if ((value[i] == '=') && (i > 1) && ((value[i - 1] == 'q') || (value[i - 1] == 'Q'))
+							&& ((value[i - 2] == ';') || (value[i - 2] == ' ') || (value[i - 2] == '\t'))) {
+						i++;
+						if ((i < length) && (value[i] == '0')) {
+							quality = 0;
+							i++;
+							if ((i < length) && (value[i] == '.')) {
+								i++;
+								while ((i < length) && (value[i] >= '0') && (value[i] <= '9')) {
+									if (value[i] != '0') {
+										quality = 1;
+									}
+									i++;
+								}
+							}
+						}
+						continue;
+					}
+					i++;
+				}
+
+				if (((codingLength == 4) && startsWithFString(coding, F("gzip")))
+						|| ((codingLength == 6) && startsWithFString(coding, F("x-gzip")))) {
+					gzipQuality = quality;
+				} else if ((codingLength == 1) && (coding[0] == '*')) {
+					anyQuality = quality;
+				}
+			}
+
+			return (gzipQuality >= 0) ? (gzipQuality > 0) : (anyQuality > 0);
+		}
+
+		//--------------------------------------------------------------------------------
+		// Parses value of the Range header terminated by CR or LF. Only a single range of
+		// bytes is supported, other values are ignored (the whole content is sent).
+		void parseRange(RequestProcessingData& requestData, const uint8_t* value) {
+			while (*value == ' ') {
+				value++;
+			}
+
+			if (!startsWithFString(value, F("bytes="))) {
+				return;
+			}
+			value += 6;
+
+			// Decode first and last byte position (positions with more than 9 digits are not supported)
+			long positions[2] = {-1, -1};
+			for (int i = 0; i < 2; i++) {
+				int digits = 0;
+				while (('0' <= *value) && (*value <= '9')) {
+					if (digits == 9) {
+						return;
+					}
+
+					positions[i] = ((positions[i] < 0) ? 0 : positions[i] * 10) + (*value - '0');
+					digits++;
+					value++;
+				}
+
+				// Positions are separated by a dash
+				if (i == 0) {
+					if (*value != '-') {
+						return;
+					}
+					value++;
+				}
+			}
+
+			while (*value == ' ') {
+				value++;
+			}
+
+			if ((*value != '\r') && (*value != '\n')) {
+				return;
+			}
+
+			if (((positions[0] < 0) && (positions[1] < 0)) || ((positions[1] >= 0) && (positions[1] < positions[0]))) {
+				return;
+			}
+
+			requestData.rangeFirst = positions[0];
+			requestData.rangeLast = positions[1];
+		}
+
+		//--------------------------------------------------------------------------------
+		// Processes a header field line of length lineLength (including the LF character)
+		// located at the read position of the receive buffer. If lineLength is -1, the line
+		// does not fit into the buffer.
+		// Returns REQUEST_RECEIVED, if the request is complete, REQUEST_INCOMPLETE, if more
+		// data are expected, or an error code.
+		int processHeaderLine(ConnectionState& connection, int lineLength) {
+			RequestProcessingData& requestData = connection.requestData;
+			Features& features = connection.features;
+
+			// Check whether there is enough space to receive empty line indicating end of header fields
+			if (requestData.bufferSize < 2) {
+				return -1;
+			}
+
+			uint8_t* line = requestData.buffer + requestData.readPosition;
+			int lineEnd = requestData.readPosition + lineLength;
+
+			// Check presence of empty line indicating end of header fields
+			if ((lineLength == 2) && (line[0] == '\r')) {
+				requestData.readPosition = lineEnd;
+				completePhase(connection, HttpMetrics::HEADER_FIELDS);
+
+				// Continue with streaming of the body (if required)
+				if (features.streamBody && (requestData.contentLength > 0)) {
+					features.storePostParameters = false;
+					connection.remainingBodyBytes = requestData.contentLength;
+					connection.phase = ConnectionState::STREAMED_BODY;
+					return REQUEST_INCOMPLETE;
+				}
+
+				// Continue with post data (if expected)
+				if (features.storePostParameters && (requestData.contentLength > 0)) {
+					if (requestData.contentLength + 1 > requestData.bufferSize) {
+						return -30;
+					}
+
+					// Make space for the complete post data (including terminating zero)
+					if (requestData.readPosition + requestData.contentLength + 1 > requestData.bufferSize) {
+						compactBuffer(requestData);
+					}
+
+					connection.phase = ConnectionState::CONTENT;
+					return REQUEST_INCOMPLETE;
+				}
+
+				return REQUEST_RECEIVED;
+			}
+
+			// Check whether we have at least name of header field
+			int colonPos = locateCharacter(line, ':', (lineLength != -1) ? lineLength : requestData.bufferedBytes - requestData.readPosition);
+			if (colonPos < 0) {
+				// If the name is not fully received, we notify error (not to miss an important header field)
+				return -1;
+			}
+
+			bool importantHeaderMissed = false;
+
+			// Check basic authentication
+			if (features.authentication != NULL) {
+				if ((colonPos == 13) && startsWithFString(line, F("Authorization:"))) {
+					if (lineLength == -1) {
+						importantHeaderMissed = true;
+					} else {
+						// Ends the authentication header field with zero (replaces the LF character)
+						line[lineLength - 1] = 0;
+						// Check authentication data
+						connection.authenticated = handleBasicAuthentication(line, features.authentication);
+					}
+				}
+			}
+
+			// Check CORS-related headers
+			if (features.enableCORS) {
+				if ((colonPos == 6) && startsWithFString(line, F("Origin:"))) {
+					if (lineLength == -1) {
+						importantHeaderMissed = true;
+					} else {
+						// Store origin
+						requestData.originHeader = retainHeaderValue(requestData, line, colonPos, lineEnd);
+
+						// Set colonPos to an invalid value
+						colonPos = -1;
+					}
+				}
+			}
+
+			// Store entity tags for validation of cached content
+			if (features.storeIfNoneMatch) {
+				if ((colonPos == 13) && startsWithFString(line, F("If-None-Match:"))) {
+					// Too long list of entity tags is ignored (the content is sent)
+					if (lineLength != -1) {
+						requestData.ifNoneMatchHeader = retainHeaderValue(requestData, line, colonPos, lineEnd);
+						colonPos = -1;
+					}
+				}
+			}
+
+			// Check whether gzip content coding is accepted
+			if ((colonPos == 15) && startsWithFString(line, F("Accept-Encoding:"))) {
+				const int valueEnd = (lineLength != -1) ? lineLength : requestData.bufferedBytes - requestData.readPosition;
+				if (parseAcceptsGzip(line + colonPos + 1, valueEnd - colonPos - 1)) {
+					requestData.acceptsGzip = true;
+				}
+			}
+
+			// Store requested range of bytes (too long value is ignored and the whole content is sent)
+			if ((colonPos == 5) && (lineLength != -1) && (requestData.method == HttpMethod::GET) && startsWithFString(line, F("Range:"))) {
+				parseRange(requestData, line + colonPos + 1);
+			}
+
+			// Store content length if provided
+			if ((colonPos == 14) && (requestData.contentLength < 0) && startsWithFString(line, F("Content-Length:"))) {
+				if (lineLength == -1) {
+					importantHeaderMissed = true;
+				} else {
+					// Skip spaces
+					const char* readPtr = (const char*)(line + colonPos + 1);
+					while (*readPtr == ' ') {
+						readPtr++;
+					}
+
+					// Decode content length (a value that does not fit the long type is rejected)
+					requestData.contentLength = 0;
+					while (('0' <= *readPtr) && (*readPtr <= '9')) {
+						const int digit = *readPtr - '0';
+						if (requestData.contentLength > (LONG_MAX - digit) / 10) {
+							return -30;
+						}
+
+						requestData.contentLength = requestData.contentLength * 10 + digit;
+						readPtr++;
+					}
+				}
 			}
 
-			if (authenticated) {
-				// Check whether authorization data match content of the field
-				while (true) {
-					const char c = pgm_read_byte(settingPtr);
-					// Check whether authentication settings reached the end of login:password part
-					if ((c == 0) || (c == ':')) {
-						authenticated = (*authHeaderField == '\r') || (*authHeaderField == 0);
-						break;
+			// Check request for upgrade to the WebSocket protocol
+			if ((colonPos == 7) && startsWithFString(line, F("Upgrade:")) && (lineLength != -1)) {
+				const uint8_t* readPtr = line + colonPos + 1;
+				while (*readPtr == ' ') {
+					readPtr++;
+				}
+
+				requestData.webSocketUpgrade = startsWithFString(readPtr, F("websocket")) || startsWithFString(readPtr, F("WebSocket"));
+			}
+
+			// Store key of the WebSocket opening handshake
+			if ((colonPos == 17) && startsWithFString(line, F("Sec-WebSocket-Key:"))) {
+				if (lineLength == -1) {
+					importantHeaderMissed = true;
+				} else {
+					requestData.webSocketKey = retainHeaderValue(requestData, line, colonPos, lineEnd);
+					colonPos = -1;
+				}
+			}
+
+			// Check requested type of connection
+			if ((colonPos == 10) && startsWithFString(line, F("Connection:")) && (lineLength != -1)) {
+				const uint8_t* readPtr = line + colonPos + 1;
+				while (*readPtr == ' ') {
+					readPtr++;
+				}
+
+				if (startsWithFString(readPtr, F("close"))) {
+					requestData.keepAlive = false;
+				} else if (startsWithFString(readPtr, F("keep-alive"))) {
+					requestData.keepAlive = true;
+				}
+			}
+
+			// Check post data
+			if (features.storePostParameters && !features.streamBody) {
+				// Verify content type
+				if ((colonPos == 12) && startsWithFString(line, F("Content-Type:"))) {
+					if (lineLength == -1) {
+						importantHeaderMissed = true;
+					} else {
+						// Skip spaces
+						const uint8_t* readPtr = line + colonPos + 1;
+						while (*readPtr == ' ') {
+							readPtr++;
+						}
+
+						// Verify expected content format
+						if (!startsWithFString(readPtr, F("application/x-www-form-urlencoded"))) {
+							features.storePostParameters = false;
+						}
+					}
+				}
+			}
+
+			// If we missed an important header field, notify that buffer overflow
+			if (importantHeaderMissed) {
+				return -1;
+			}
+
+			// Move the read position behind the line
+			if (lineLength == -1) {
+				// The rest of the line is skipped when received
+				requestData.readPosition = requestData.bufferedBytes;
+				connection.phase = ConnectionState::SKIP_LINE;
+			} else {
+				requestData.readPosition = lineEnd;
+			}
+
+			return REQUEST_INCOMPLETE;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Processes data of a request received by a connection without waiting for new data.
+		// Returns REQUEST_RECEIVED, if the request is completely received, REQUEST_INCOMPLETE,
+		// if more data are expected, or an error code (see handleInvalidState).
+		int receiveRequest(Client& client, ConnectionState& connection) {
+			RequestProcessingData& requestData = connection.requestData;
+			while (true) {
+				if (connection.phase == ConnectionState::STREAMED_BODY) {
+					// Pass received part of the body to the application
+					const int bufferedBodyBytes = requestData.bufferedBytes - requestData.readPosition;
+					if (bufferedBodyBytes > 0) {
+						const int chunkLength = ((unsigned long)bufferedBodyBytes < connection.remainingBodyBytes) ? bufferedBodyBytes
+								: (int)connection.remainingBodyBytes;
+						HttpRequest request(requestData);
+						processBody(request, requestData.buffer + requestData.readPosition, chunkLength);
+						requestData.readPosition += chunkLength;
+						connection.remainingBodyBytes -= chunkLength;
+						connection.activityTime = millis();
+					}
+
+					if (connection.remainingBodyBytes == 0) {
+						return REQUEST_RECEIVED;
+					}
+
+					// Receive next part of the body to the whole buffer
+					requestData.readPosition = 0;
+					requestData.bufferedBytes = 0;
+					const int limit = (connection.remainingBodyBytes < (unsigned long)requestData.bufferSize) ? (int)connection.remainingBodyBytes
+							: requestData.bufferSize;
+					const int receivedBytes = receiveAvailable(client, requestData, limit);
+					if (receivedBytes < 0) {
+						// Something went wrong - disconnect client
+						closeConnection(client);
+						ACP_TRACE(F("HTTP: Wrong state."));
+						return 0;
+					}
+
+					if (receivedBytes == 0) {
+						break;
+					}
+
+					continue;
+				}
+
+				const bool contentPhase = (connection.phase == ConnectionState::CONTENT);
+
+				// Find the end of line in unprocessed data (the content is not line oriented)
+				int lineLength = 0;
+				if (!contentPhase) {
+					const int unreadBytes = requestData.bufferedBytes - requestData.readPosition;
+					lineLength = locateCharacter(requestData.buffer + requestData.readPosition, '\n', unreadBytes) + 1;
+					if ((connection.phase == ConnectionState::SKIP_LINE) && (lineLength == 0)) {
+						// Data of a skipped line are not stored
+						requestData.readPosition = requestData.bufferedBytes;
+					}
+				}
+
+				// Receive new data, if required
+				const bool dataRequired = contentPhase ? (requestData.bufferedBytes - requestData.readPosition < requestData.contentLength)
+						: (lineLength == 0);
+				if (dataRequired) {
+					// Processed data are released only when there is no free space in the buffer
+					if (requestData.readPosition == requestData.bufferedBytes) {
+						requestData.readPosition = 0;
+						requestData.bufferedBytes = 0;
+					} else if ((requestData.bufferedBytes == requestData.bufferSize) && (requestData.readPosition > 0)) {
+						compactBuffer(requestData);
+					}
+
+					const int limit = contentPhase ? requestData.readPosition + (int)requestData.contentLength : requestData.bufferSize;
+					if (requestData.bufferedBytes < limit) {
+						const int receivedBytes = receiveAvailable(client, requestData, limit);
+						if (receivedBytes < 0) {
+							// Something went wrong - disconnect client
+							closeConnection(client);
+							ACP_TRACE(F("HTTP: Wrong state."));
+							return 0;
+						}
+
+						if (receivedBytes == 0) {
+							break;
+						}
+
+						continue;
+					}
+				}
+
+				int result;
+				if (contentPhase) {
+					// Complete post data
+					requestData.postParameters = (char*)(requestData.buffer + requestData.readPosition);
+					requestData.readPosition += requestData.contentLength;
+					requestData.buffer[requestData.readPosition] = 0;
+					result = REQUEST_RECEIVED;
+				} else if (connection.phase == ConnectionState::SKIP_LINE) {
+					requestData.readPosition += lineLength;
+					connection.phase = ConnectionState::HEADER_FIELDS;
+					result = REQUEST_INCOMPLETE;
+				} else if (connection.phase == ConnectionState::REQUEST_LINE) {
+					result = processRequestLine(connection, (lineLength > 0) ? lineLength : -1);
+				} else {
+					result = processHeaderLine(connection, (lineLength > 0) ? lineLength : -1);
+				}
+
+				if (result != REQUEST_INCOMPLETE) {
+					return result;
+				}
+			}
+
+			// Check state of the client
+			if (!client.connected()) {
+				return 0;
+			}
+
+			// Streamed body can be received longer than the timeout, if it progresses
+			if (millis() - connection.activityTime > TIMEOUT) {
+				return -2;
+			}
+
+			return REQUEST_INCOMPLETE;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Handles a request that failed with given error code.
+		void failRequest(Client& client, ConnectionState& connection, int errorCode) {
+			// Notify the application that the streamed body is incomplete
+			if (connection.phase == ConnectionState::STREAMED_BODY) {
+				HttpRequest request(connection.requestData);
+				processBody(request, NULL, 0);
+			}
+
+			handleInvalidState(client, errorCode, connection.requestData.startTime);
+		}
+
+		//--------------------------------------------------------------------------------
+		// Produces response to a completely received request. If keepAliveAllowed is true,
+		// the connection can be left open after the response (persistent connection).
+		// If eventStreamAllowed is true, the response can start an event stream.
+		// Returns true, if the connection is kept open.
+		bool respond(Client& client, ConnectionState& connection, bool keepAliveAllowed, bool eventStreamAllowed) {
+			RequestProcessingData& requestData = connection.requestData;
+			Features& features = connection.features;
+
+			// Check whether the client is connected after processing the header of an http request
+			if (!client.connected()) {
+				handleInvalidState(client, 0, requestData.startTime);
+				return false;
+			}
+
+			// Time of receiving the body is measured only for requests with content
+			if (requestData.contentLength > 0) {
+				completePhase(connection, HttpMetrics::BODY);
+			} else {
+				connection.phaseStartTime = micros();
+			}
+
+			// The connection can be kept alive only if the whole request has been consumed
+			connection.servedRequests++;
+			bool keepAlive = keepAliveAllowed && requestData.keepAlive && (connection.servedRequests < maxKeepAliveRequests);
+			keepAlive = keepAlive && (requestData.readPosition == requestData.bufferedBytes);
+			if ((requestData.postParameters == NULL) && !features.streamBody) {
+				keepAlive = keepAlive && (requestData.contentLength <= 0);
+			}
+
+			// Buffer for coalescing small writes of the response
+			OutputBuffer outputBuffer(bufferPool);
+
+			HttpResponseOptions options;
+			options.corsAllowOrigin = requestData.originHeader;
+			options.corsAllowCredentials = (features.authentication != NULL);
+			options.keepAlive = keepAlive;
+			// Chunked transfer coding requires an output buffer (each flush of the buffer is a chunk)
+			options.chunkedAllowed = requestData.http11 && (outputBuffer.size() > 0);
+			options.eventStreamAllowed = eventStreamAllowed && (countEventStreams() < getEventStreamLimit());
+			HttpResponse response(&client, outputBuffer.get(), outputBuffer.size(), options);
+			if (requestData.isWebSocketUpgrade()) {
+				response.webSocketKey = requestData.webSocketKey;
+			}
+			response.rangeFirst = requestData.rangeFirst;
+			response.rangeLast = requestData.rangeLast;
+			if (!connection.authenticated) {
+				if (requestData.method != HttpMethod::OPTIONS) {
+					ACP_TRACE(F("HTTP: 401 Unauthorized"));
+					response.setStatus(401, F("Unauthorized"));
+				} else {
+					ACP_TRACE(F("HTTP: OPTIONS"));
+				}
+
+				Print* hp = response.getHeaderPrint();
+				hp->print(F("WWW-Authenticate: Basic realm=\""));
+
+				// Print realm
+				PGM_P authPtr = reinterpret_cast<PGM_P>(features.authentication);
+				bool colonFound = false;
+				char c;
+				while ((c = pgm_read_byte(authPtr)) != 0) {
+					if (colonFound) {
+						hp->print(c);
+					}
+
+					if (c == ':') {
+						colonFound = true;
+					}
+
+					authPtr++;
+				}
+
+				// If no realm is defined in setting, use realm "web"
+				if (!colonFound) {
+					hp->print(F("web"));
+				}
+
+				hp->println('\"');
+			} else {
+				if (requestData.method != HttpMethod::OPTIONS) {
+					// Construct bundle with request data
+					HttpRequest request(requestData);
+
+					// Invoke handler of the route or request processing method
+					if (connection.routeHandler != NULL) {
+						connection.routeHandler(request, response);
+					} else {
+						processRequest(request, response);
 					}
+				}
+			}
 
-					// Check whether required and received authentication strings match
-					if (*authHeaderField != c) {
-						authenticated = false;
-						break;
-					}
+			// Ensure that headers are sent and close the connection (if not persistent)
+			const bool kept = response.complete();
+			completePhase(connection, HttpMetrics::PROCESSING);
+			if (!kept) {
+				closeConnection(client);
+				completePhase(connection, HttpMetrics::CLOSING);
+			}
 
-					settingPtr++;
-					authHeaderField++;
-				}
+			// Register event stream
+			if (response.isEventStream()) {
+				ACP_TRACE(F("HTTP: event stream started."));
+				connection.phase = ConnectionState::EVENT_STREAM;
+				connection.eventSequence = eventSequence;
+				connection.idleStartTime = millis();
 			}
 
-			return authenticated;
+			// Register WebSocket connection, the current state is written in the next advance
+			if (response.isWebSocket()) {
+				ACP_TRACE(F("HTTP: WebSocket opened."));
+				compactBuffer(requestData);
+				connection.phase = ConnectionState::WEB_SOCKET;
+				connection.webSocketOpcode = 0;
+				connection.eventSequence = eventSequence - 1;
+				connection.idleStartTime = millis();
+			}
+
+			ACP_TRACE(F("HTTP: client processed."));
+			return kept;
 		}
 
 		//--------------------------------------------------------------------------------
-		// Handles a client.
-		void handle(Client& client) {
+		// Handles a request of a client and waits until the request is received. If
+		// keepAliveAllowed is true, the connection can be left open after the response
+		// (persistent connection).
+		void handle(Client& client, bool keepAliveAllowed) {
 			// Check whether the client object represents a valid client.
 			if (!client) {
 				return;
@@ -806,328 +3319,341 @@ namespace acp_network_simple_http_client_handler {
 
 			ACP_TRACE(F("HTTP: new client."));
 
-			// Buffer for storing all request related data (URL, parameters, etc.)
-			uint8_t requestBuffer[BUFFER_SIZE + 1];
-			requestBuffer[BUFFER_SIZE] = 0;
+			// Blocking handling uses the first connection slot
+			ConnectionState& connection = connections[0];
+			if (!acquireRequestBuffer(connection)) {
+				rejectRequest(client);
+				return;
+			}
+			startRequest(connection);
 
-			// Bundle with data retrieved from the request
-			RequestProcessingData requestData;
+			int result;
+			while ((result = receiveRequest(client, connection)) == REQUEST_INCOMPLETE) {
+				ACP_TRACE(F("HTTP: Waiting for data."));
+				delay(1);
+			}
 
-			// Initialized floating receive buffer inside request buffer
-			requestData.buffer = requestBuffer;// start of receive buffer
-			requestData.bufferedBytes = 0;// number of received bytes in the buffer
-			requestData.bufferSize = BUFFER_SIZE;// size of the receive buffer
+			if (result == REQUEST_RECEIVED) {
+				respond(client, connection, keepAliveAllowed, false);
+			} else {
+				failRequest(client, connection, result);
+			}
 
-			// Store start time
-			requestData.startTime = millis();
+			connection.phase = ConnectionState::IDLE;
+			releaseRequestBuffer(connection);
+		}
 
-			// Initialize features
-			Features features;
-			features.storeGetParameters = true;
-			features.storePostParameters = true;
-			features.enableCORS = ((state & B00000010) == B00000010);
-			features.authentication = authentication;
+		//--------------------------------------------------------------------------------
+		// Returns the maximal number of event streams and WebSockets. A stream is never
+		// idle, so at least one client slot of the server is left for requests (a single
+		// client server serves no streams, otherwise the stream would starve new clients).
+		int getEventStreamLimit() {
+			if (server == NULL) {
+				return maxEventStreams;
+			}
 
-			// Read the request line
-			{
-				int lineLength = readLine(client, requestData.buffer, requestData.bufferedBytes, requestData.bufferSize, requestData.startTime);
-				if (lineLength <= 0) {
-					handleInvalidState(client, lineLength, requestData.startTime);
-					return;
-				}
+			const int requestSlots = server->getClientSlots() - 1;
+			return (maxEventStreams < requestSlots) ? maxEventStreams : requestSlots;
+		}
 
-				int spaceIdx = locateCharacter(requestData.buffer, ' ', lineLength);
-				if (spaceIdx < 0) {
-					// Protocol error
-					handleInvalidState(client, -10, requestData.startTime);
-					return;
+		//--------------------------------------------------------------------------------
+		// Returns the number of connections that serve an event stream or a WebSocket.
+		int countEventStreams() {
+			int result = 0;
+			for (int i = 0; i < MAX_CONNECTIONS; i++) {
+				if ((connections[i].phase == ConnectionState::EVENT_STREAM) || (connections[i].phase == ConnectionState::WEB_SOCKET)) {
+					result++;
 				}
+			}
 
-				// Detect method
-				if ((spaceIdx == 3) && startsWithFString(requestData.buffer, F("GET"))) {
-					requestData.method = HttpMethod::GET;
-				} else if ((spaceIdx == 4) && startsWithFString(requestData.buffer, F("POST"))) {
-					requestData.method = HttpMethod::POST;
-				} else if ((spaceIdx == 7) && startsWithFString(requestData.buffer, F("OPTIONS"))) {
-					requestData.method = HttpMethod::OPTIONS;
-				} else {
-					handleInvalidState(client, -20, requestData.startTime);
-					return;
-				}
+			return result;
+		}
 
-				// Shift URL to the beginning of the buffer
-				removeBufferPrefix(requestData.buffer, requestData.bufferedBytes, spaceIdx+1);
-				lineLength -= spaceIdx+1;
-				requestData.url = (const char*)(requestData.buffer);
+		//--------------------------------------------------------------------------------
+		// Writes published events or a heartbeat to an event stream.
+		// Returns true, if the stream remains open.
+		bool advanceEventStream(Client& client, ConnectionState& connection) {
+			if (!client.connected()) {
+				ACP_TRACE(F("HTTP: event stream closed."));
+				connection.phase = ConnectionState::IDLE;
+				releaseRequestBuffer(connection);
+				client.stop();
+				return false;
+			}
 
-				// Find space after URL with get parameters
-				spaceIdx = locateCharacter(requestData.buffer, ' ', lineLength);
-				if (spaceIdx < 0) {
-					// Protocol error
-					handleInvalidState(client, -10, requestData.startTime);
-					return;
+			// Data received from the client are ignored (the buffer keeps the url of stream)
+			uint8_t ignoredData[16];
+			while (client.available() > 0) {
+				if (readBytes(client, ignoredData, sizeof(ignoredData)) <= 0) {
+					break;
 				}
+			}
 
-				// Find question mark that delimits get parameters
-				int qmPos = locateCharacter(requestData.buffer, '?', spaceIdx);
+			if (connection.eventSequence != eventSequence) {
+				// Write events published since the last write
+				OutputBuffer outputBuffer(bufferPool);
+				acp_network_libs_format_printers::BufferedPrint output(&client, outputBuffer.get(), outputBuffer.size());
+				HttpEventWriter writer(&output);
+				writeEvents(connection.requestData.url, writer);
+				output.flush();
+				connection.eventSequence = eventSequence;
+				connection.idleStartTime = millis();
+			} else if ((eventHeartbeat > 0) && (millis() - connection.idleStartTime >= eventHeartbeat)) {
+				// Comment line keeps the idle connection open
+				client.print(F(":\r\n\r\n"));
+				connection.idleStartTime = millis();
+			}
 
-				// Ends URL string with null
-				int urlLength = spaceIdx;
-				requestData.buffer[spaceIdx] = 0;
-				if (qmPos >= 0) {
-					requestData.buffer[qmPos] = 0;
-					urlLength = qmPos;
-				}
+			return true;
+		}
 
-				// Update request processing features for requested URL
-				setFeatures(requestData.url, features);
+		//--------------------------------------------------------------------------------
+		// Processes a WebSocket frame at the end of the received message in the receive
+		// buffer (the read position is the length of the received message content).
+		// Returns FRAME_PROCESSED, if a frame has been processed, FRAME_INCOMPLETE, if the
+		// frame is not completely received, or FRAME_CLOSED, if the connection is closed.
+		int processWebSocketFrame(ConnectionState& connection, WebSocket& socket) {
+			RequestProcessingData& requestData = connection.requestData;
+			uint8_t* const frame = requestData.buffer + requestData.readPosition;
+			const int frameBytes = requestData.bufferedBytes - requestData.readPosition;
+			if (frameBytes < 2) {
+				return FRAME_INCOMPLETE;
+			}
 
-				// Disable some features for OPTIONS request (usually a CORS preflight request)
-				if (requestData.method == HttpMethod::OPTIONS) {
-					features.storeGetParameters = false;
-					features.storePostParameters = false;
-				}
+			const bool final = ((frame[0] & 0x80) == 0x80);
+			const uint8_t opcode = frame[0] & 0x0F;
 
-				// Disable processing of POST data for other request methods
-				if (requestData.method != HttpMethod::POST) {
-					features.storePostParameters = false;
-				}
+			// Frames sent by a client must be masked
+			if ((frame[1] & 0x80) == 0) {
+				socket.close(1002);
+				return FRAME_CLOSED;
+			}
 
-				// Process get parameters (if accepted and received) and store required information in the buffer
-				int usedBufferBytes;
-				if ((features.storeGetParameters) && (qmPos >= 0)) {
-					requestData.getParameters = (char*)(requestData.buffer + (qmPos+1));
-					usedBufferBytes = spaceIdx + 1;
-				} else {
-					usedBufferBytes = urlLength + 1;
-				}
+			// Decode payload length
+			unsigned long payloadLength = frame[1] & 0x7F;
+			int headerLength = 2;
+			if (payloadLength == 126) {
+				headerLength = 4;
+			} else if (payloadLength == 127) {
+				headerLength = 10;
+			}
 
-				requestData.buffer += usedBufferBytes;
-				requestData.bufferSize -= usedBufferBytes;
-				requestData.bufferedBytes -= usedBufferBytes;
-				lineLength -= usedBufferBytes;
+			if (frameBytes < headerLength) {
+				return FRAME_INCOMPLETE;
+			}
 
-				// Move buffer content to the next line
-				removeBufferPrefix(requestData.buffer, requestData.bufferedBytes, lineLength);
+			if (headerLength == 4) {
+				payloadLength = ((unsigned long)frame[2] << 8) | frame[3];
+			} else if (headerLength == 10) {
+				payloadLength = 0;
+				for (int i = 2; i < 10; i++) {
+					if ((i < 6) && (frame[i] != 0)) {
+						socket.close(1009);
+						return FRAME_CLOSED;
+					}
+					payloadLength = (payloadLength << 8) | frame[i];
+				}
 			}
 
-			ACP_TRACE(F("HTTP: requested url %s"), requestData.url);
+			// Verify that the frame fits into the buffer together with the received message
+			headerLength += 4;
+			const int payloadSpace = requestData.bufferSize - requestData.readPosition - headerLength;
+			if ((payloadSpace < 0) || (payloadLength > (unsigned long)payloadSpace)) {
+				socket.close(((opcode & 0x08) == 0x08) ? 1002 : 1009);
+				return FRAME_CLOSED;
+			}
 
-			// Set initial authentication
-			bool authenticated = (features.authentication == NULL);
+			const int frameLength = headerLength + (int)payloadLength;
+			if (frameBytes < frameLength) {
+				return FRAME_INCOMPLETE;
+			}
 
-			// Process request header fields
-			while (client.connected()) {
-				// Check whether there is enough space to receive empty line indicating end of header fields
-				if (requestData.bufferSize < 2) {
-					handleInvalidState(client, -1, requestData.startTime);
-					return;
-				}
+			// Unmask the payload
+			uint8_t* const payload = frame + headerLength;
+			const uint8_t* const mask = payload - 4;
+			for (int i = 0; i < (int)payloadLength; i++) {
+				payload[i] ^= mask[i & 3];
+			}
 
-				// Read a single line of http request
-				int lineLength = readLine(client, requestData.buffer, requestData.bufferedBytes, requestData.bufferSize, requestData.startTime);
-				// Check presence of empty line indicating end of header fields
-				if ((lineLength == 2) && (requestData.buffer[0] == '\r')) {
-					removeBufferPrefix(requestData.buffer, requestData.bufferedBytes, lineLength);
-					break;
+			if ((opcode & 0x08) == 0x08) {
+				// Control frames can be interleaved with fragments of a message
+				if (!final || (payloadLength > 125)) {
+					socket.close(1002);
+					return FRAME_CLOSED;
 				}
 
-				// If there is an error other than the buffer is over-filled, handle invalid state
-				if ((lineLength <= 0) && (lineLength != -1)) {
-					handleInvalidState(client, lineLength, requestData.startTime);
-					return;
+				if (opcode == WebSocket::PING) {
+					socket.writeFrame(WebSocket::PONG, true, payload, payloadLength);
+				} else if (opcode == WebSocket::CLOSE) {
+					socket.close((payloadLength >= 2) ? (((uint16_t)payload[0] << 8) | payload[1]) : 1000);
+					return FRAME_CLOSED;
+				} else if (opcode != WebSocket::PONG) {
+					socket.close(1002);
+					return FRAME_CLOSED;
 				}
 
-				// Check whether we have at least name of header field
-				int colonPos = locateCharacter(requestData.buffer, ':', (lineLength != -1) ? lineLength : requestData.bufferSize);
-				if (colonPos < 0) {
-					// If the name is not fully received, we notify error (not to miss an important header field)
-					handleInvalidState(client, -1, requestData.startTime);
-					return;
+				memmove(frame, frame + frameLength, frameBytes - frameLength);
+				requestData.bufferedBytes -= frameLength;
+				return FRAME_PROCESSED;
+			}
+
+			// Verify the sequence of fragments
+			if (opcode == WebSocket::CONTINUATION) {
+				if (connection.webSocketOpcode == 0) {
+					socket.close(1002);
+					return FRAME_CLOSED;
 				}
+			} else if (((opcode == WebSocket::TEXT) || (opcode == WebSocket::BINARY)) && (connection.webSocketOpcode == 0)) {
+				connection.webSocketOpcode = opcode;
+			} else {
+				socket.close(1002);
+				return FRAME_CLOSED;
+			}
 
-				bool importantHeaderMissed = false;
+			// Append the payload to the received message content
+			memmove(frame, payload, frameBytes - headerLength);
+			requestData.bufferedBytes -= headerLength;
+			requestData.readPosition += payloadLength;
+			if (!final) {
+				return FRAME_PROCESSED;
+			}
 
-				// Check basic authentication
-				if (features.authentication != NULL) {
-					if ((colonPos == 13) && startsWithFString(requestData.buffer, F("Authorization:"))) {
-						if (lineLength == -1) {
-							importantHeaderMissed = true;
-						} else {
-							// Ends the line with authentication header field
-							requestData.buffer[lineLength] = 0;
-							// Check authentication data
-							authenticated = handleBasicAuthentication(client, requestData.buffer, features.authentication);
-						}
-					}
-				}
+			// Pass the message to the application (terminated with zero)
+			const int messageLength = requestData.readPosition;
+			const uint8_t nextByte = requestData.buffer[messageLength];
+			requestData.buffer[messageLength] = 0;
+			processWebSocketMessage(socket, requestData.buffer, messageLength, connection.webSocketOpcode == WebSocket::BINARY);
+			requestData.buffer[messageLength] = nextByte;
+			socket.endMessage();
+
+			compactBuffer(requestData);
+			connection.webSocketOpcode = 0;
+			return socket.isClosed() ? FRAME_CLOSED : FRAME_PROCESSED;
+		}
 
-				// Check CORS-related headers
-				if (features.enableCORS) {
-					if ((colonPos == 6) && startsWithFString(requestData.buffer, F("Origin:"))) {
-						if (lineLength == -1) {
-							importantHeaderMissed = true;
-						} else {
-							// Store origin
-							int skipChars = colonPos + 1;
-							while (requestData.buffer[skipChars] == ' ') {
-								skipChars++;
-							}
+		//--------------------------------------------------------------------------------
+		// Processes received WebSocket frames and writes published events or a ping.
+		// Returns true, if the connection remains open.
+		bool advanceWebSocket(Client& client, ConnectionState& connection) {
+			if (!client.connected()) {
+				ACP_TRACE(F("HTTP: WebSocket closed."));
+				connection.phase = ConnectionState::IDLE;
+				releaseRequestBuffer(connection);
+				client.stop();
+				return false;
+			}
 
-							removeBufferPrefix(requestData.buffer, requestData.bufferedBytes, skipChars);
-							lineLength -= skipChars;
+			// Buffer for content of sent messages
+			OutputBuffer outputBuffer(bufferPool);
+			WebSocket socket(&client, connection.requestData.url, outputBuffer.get(), outputBuffer.size());
 
-							requestData.originHeader = (const char*)(requestData.buffer);
-							while ((*(requestData.buffer) != '\r') && (*(requestData.buffer) != '\n')) {
-								requestData.buffer++;
-								requestData.bufferedBytes--;
-								requestData.bufferSize--;
-								lineLength--;
-							}
+			// Process received frames
+			int result = FRAME_PROCESSED;
+			if (receiveAvailable(client, connection.requestData, connection.requestData.bufferSize) < 0) {
+				result = FRAME_CLOSED;
+			}
 
-							// Terminate the origin string with zero
-							*(requestData.buffer) = 0;
-							// Move floating buffer behind this terminating character
-							requestData.buffer++;
-							requestData.bufferedBytes--;
-							requestData.bufferSize--;
-							lineLength--;
+			while (result == FRAME_PROCESSED) {
+				result = processWebSocketFrame(connection, socket);
+			}
 
-							// Set colonPos to an invalid value
-							colonPos = -1;
-						}
-					}
+			if (result != FRAME_CLOSED) {
+				if (connection.eventSequence != eventSequence) {
+					// Write events published since the last write
+					writeWebSocketEvents(socket);
+					socket.endMessage();
+					connection.eventSequence = eventSequence;
+					connection.idleStartTime = millis();
+				} else if ((eventHeartbeat > 0) && (millis() - connection.idleStartTime >= eventHeartbeat)) {
+					// Ping keeps the idle connection open
+					socket.writeFrame(WebSocket::PING, true, NULL, 0);
+					connection.idleStartTime = millis();
 				}
+			}
 
-				// Check post data
-				if (features.storePostParameters) {
-					// Store content length if provided
-					if ((colonPos == 14) && (requestData.contentLength < 0) && startsWithFString(requestData.buffer, F("Content-Length:"))) {
-						if (lineLength == -1) {
-							importantHeaderMissed = true;
-						} else {
-							// Skip spaces
-							const char* readPtr = (const char*)(requestData.buffer + colonPos + 1);
-							while (*readPtr == ' ') {
-								readPtr++;
-							}
-
-							// Decode content length
-							requestData.contentLength = 0;
-							while (('0' <= *readPtr) && (*readPtr <= '9')) {
-								requestData.contentLength = requestData.contentLength * 10 + (*readPtr - '0');
-								readPtr++;
-							}
-						}
-					}
+			if ((result == FRAME_CLOSED) || socket.isClosed()) {
+				ACP_TRACE(F("HTTP: WebSocket closed."));
+				connection.phase = ConnectionState::IDLE;
+				releaseRequestBuffer(connection);
+				closeConnection(client);
+				return false;
+			}
 
-					// Verify content type
-					if ((colonPos == 12) && startsWithFString(requestData.buffer, F("Content-Type:"))) {
-						if (lineLength == -1) {
-							importantHeaderMissed = true;
-						} else {
-							// Skip spaces
-							const uint8_t* readPtr = requestData.buffer + colonPos + 1;
-							while (*readPtr == ' ') {
-								readPtr++;
-							}
+			return true;
+		}
 
-							// Verify expected content format
-							if (!startsWithFString(readPtr, F("application/x-www-form-urlencoded"))) {
-								features.storePostParameters = false;
-							}
-						}
-					}
-				}
+		//--------------------------------------------------------------------------------
+		// Advances processing of a client in a connection slot using only the data that are
+		// already available (the method never waits for data).
+		// Returns true, if the client remains connected and should be advanced again.
+		bool advance(Client& client, ConnectionState& connection, bool isNew) {
+			// Check whether the client object represents a valid client.
+			if (!client) {
+				return false;
+			}
 
-				// If we missed an important header field, notify that buffer overflow
-				if (importantHeaderMissed) {
-					handleInvalidState(client, -1, requestData.startTime);
-					return;
+			if (isNew) {
+				ACP_TRACE(F("HTTP: new client."));
+				connection.servedRequests = 0;
+				if (!acquireRequestBuffer(connection)) {
+					rejectRequest(client);
+					return false;
 				}
-
-				// Remove the line from receive buffer
-				if (lineLength == -1) {
-					skipToLineEnd(client, requestData.buffer, requestData.bufferedBytes, requestData.bufferSize, requestData.startTime);
-				} else {
-					removeBufferPrefix(requestData.buffer, requestData.bufferedBytes, lineLength);
+				startRequest(connection);
+			} else if (connection.phase == ConnectionState::EVENT_STREAM) {
+				return advanceEventStream(client, connection);
+			} else if (connection.phase == ConnectionState::WEB_SOCKET) {
+				return advanceWebSocket(client, connection);
+			} else if (connection.phase == ConnectionState::IDLE) {
+				// Idle persistent connection
+				if (!client.connected()) {
+					client.stop();
+					return false;
 				}
-			}
 
-			// Read post data
-			if (features.storePostParameters && (requestData.contentLength > 0) && client.connected()) {
-				if (requestData.contentLength + 1 <= requestData.bufferSize) {
-					int dataLength = readLine(client, requestData.buffer, requestData.bufferedBytes, requestData.contentLength, requestData.startTime);
-					if (dataLength == -1) {
-						requestData.buffer[requestData.contentLength] = 0;
-						requestData.postParameters = (char*)(requestData.buffer);
+				if (client.available() <= 0) {
+					if (millis() - connection.idleStartTime > keepAliveTimeout) {
+						closeConnection(client);
+						return false;
 					}
+
+					return true;
 				}
 
-				if (requestData.postParameters == NULL) {
-					handleInvalidState(client, -30, requestData.startTime);
-					return;
+				if (!acquireRequestBuffer(connection)) {
+					rejectRequest(client);
+					return false;
 				}
+				startRequest(connection);
 			}
 
-			// Check whether the client is connected after processing the header of an http request
-			if (!client.connected()) {
-				handleInvalidState(client, 0, requestData.startTime);
-				return;
+			const int result = receiveRequest(client, connection);
+			if (result == REQUEST_INCOMPLETE) {
+				return true;
 			}
 
-			HttpResponse response(&client, requestData.originHeader, (features.authentication != NULL));
-			if (!authenticated) {
-				if (requestData.method != HttpMethod::OPTIONS) {
-					ACP_TRACE(F("HTTP: 401 Unauthorized"));
-					response.setStatus(401, F("Unauthorized"));
-				} else {
-					ACP_TRACE(F("HTTP: OPTIONS"));
-				}
-
-				Print* hp = response.getHeaderPrint();
-				hp->print(F("WWW-Authenticate: Basic realm=\""));
-
-				// Print realm
-				PGM_P authPtr = reinterpret_cast<PGM_P>(features.authentication);
-				bool colonFound = false;
-				char c;
-				while ((c = pgm_read_byte(authPtr)) != 0) {
-					if (colonFound) {
-						hp->print(c);
-					}
-
-					if (c == ':') {
-						colonFound = true;
-					}
-
-					authPtr++;
-				}
-
-				// If no realm is defined in setting, use realm "web"
-				if (!colonFound) {
-					hp->print(F("web"));
-				}
+			if (result != REQUEST_RECEIVED) {
+				failRequest(client, connection, result);
+				connection.phase = ConnectionState::IDLE;
+				releaseRequestBuffer(connection);
+				return false;
+			}
 
-				hp->println('\"');
-				response.startContent();
-			} else {
-				if (requestData.method != HttpMethod::OPTIONS) {
-					// Construct bundle with request data
-					HttpRequest request(requestData);
+			connection.phase = ConnectionState::IDLE;
 
-					// Invoke request processing method
-					processRequest(request, response);
-				}
+			const bool keepConnection = respond(client, connection, keepAliveTimeout > 0, true);
 
-				// Ensure that headers are sent
-				response.startContent();
+			// Event streams and WebSockets keep the request buffer (it stores the url)
+			if (connection.phase == ConnectionState::IDLE) {
+				releaseRequestBuffer(connection);
 			}
 
-			// Close the connection:
-			closeConnection(client);
+			if (keepConnection) {
+				connection.idleStartTime = millis();
+				return true;
+			}
 
-			ACP_TRACE(F("HTTP: client processed."));
+			return false;
 		}
 
 	protected:
@@ -1139,6 +3665,43 @@ namespace acp_network_simple_http_client_handler {
 			}
 		}
 
+		//--------------------------------------------------------------------------------
+		// Processes a chunk of a streamed request body. If the request fails before the
+		// body is complete, the method is invoked with data set to NULL. Get parameters
+		// should be read when the request is processed.
+		virtual void processBody(HttpRequest& request, const uint8_t* data, int length) {
+			if (processBodyEvent != NULL) {
+				processBodyEvent(request, data, length);
+			}
+		}
+
+		//--------------------------------------------------------------------------------
+		// Writes events published since the last write to an event stream started for
+		// given url.
+		virtual void writeEvents(const char* url, HttpEventWriter& writer) {
+			if (writeEventsEvent != NULL) {
+				writeEventsEvent(url, writer);
+			}
+		}
+
+		//--------------------------------------------------------------------------------
+		// Processes a complete message received by a WebSocket (text messages are
+		// terminated with zero).
+		virtual void processWebSocketMessage(WebSocket& socket, const uint8_t* data, int length, bool binary) {
+			if (processWebSocketMessageEvent != NULL) {
+				processWebSocketMessageEvent(socket, data, length, binary);
+			}
+		}
+
+		//--------------------------------------------------------------------------------
+		// Writes events published since the last write (or the current state, when the
+		// connection is opened) to a WebSocket.
+		virtual void writeWebSocketEvents(WebSocket& socket) {
+			if (writeWebSocketEventsEvent != NULL) {
+				writeWebSocketEventsEvent(socket);
+			}
+		}
+
 		//--------------------------------------------------------------------------------
 		// Processes an http request
 		virtual void processRequest(HttpRequest& request, HttpResponse& response) {
@@ -1154,18 +3717,49 @@ namespace acp_network_simple_http_client_handler {
 		// Event handler that processes the request
 		void (*processRequestEvent)(HttpRequest& request, HttpResponse& response);
 
+		// Event handler that processes a chunk of a streamed request body
+		void (*processBodyEvent)(HttpRequest& request, const uint8_t* data, int length);
+
+		// Event handler that writes published events to an event stream
+		void (*writeEventsEvent)(const char* url, HttpEventWriter& writer);
+
+		// Event handler that processes a message received by a WebSocket
+		void (*processWebSocketMessageEvent)(WebSocket& socket, const uint8_t* data, int length, bool binary);
+
+		// Event handler that writes published events to a WebSocket
+		void (*writeWebSocketEventsEvent)(WebSocket& socket);
+
 		//--------------------------------------------------------------------------------
 		// Constructs the client handler.
 		inline SimpleHttpHandlingController() {
 			server = NULL;
 			state = 0;
+			keepAliveTimeout = 0;
+			maxKeepAliveRequests = 1;
+			maxEventStreams = 0;
+			eventHeartbeat = 0;
+			eventSequence = 0;
+			routes = NULL;
+			routeCount = 0;
+			metrics = NULL;
+			bufferPool = NULL;
+			for (int i = 0; i < MAX_CONNECTIONS; i++) {
+				connections[i].requestBuffer = POOLED_BUFFERS ? NULL : requestBuffers[i];
+				connections[i].parameterIndex = parameterIndexes[i];
+			}
+
 			setFeaturesEvent = NULL;
 			processRequestEvent = NULL;
+			processBodyEvent = NULL;
+			writeEventsEvent = NULL;
+			processWebSocketMessageEvent = NULL;
+			writeWebSocketEventsEvent = NULL;
 		}
 
 		//--------------------------------------------------------------------------------
 		// Initializes the client handler.
-		void init(const __FlashStringHelper* authentication, bool enableCORS) {
+		void init(const __FlashStringHelper* authentication, bool enableCORS, unsigned long keepAliveTimeout, int maxKeepAliveRequests,
+				int maxEventStreams, unsigned long eventHeartbeat) {
 			// Set default authentication
 			this->authentication = authentication;
 			if (this->authentication != NULL) {
@@ -1180,6 +3774,45 @@ namespace acp_network_simple_http_client_handler {
 			} else {
 				state &= B11111101;
 			}
+
+			// Set persistent connection limits
+			this->keepAliveTimeout = keepAliveTimeout;
+			this->maxKeepAliveRequests = constrain(maxKeepAliveRequests, 1, 255);
+
+			// Set limits of event streams
+			this->maxEventStreams = constrain(maxEventStreams, 0, MAX_CONNECTIONS);
+			this->eventHeartbeat = eventHeartbeat;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Publishes new events. Events are written to all event streams by writeEventsEvent
+		// and to all WebSockets by writeWebSocketEventsEvent when the connections are
+		// advanced by the server.
+		inline void publishEvents() {
+			eventSequence++;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Sets the table of routes stored in flash memory. The routes must be sorted by
+		// paths (see HttpRoute). Requests that match no route are processed by
+		// processRequestEvent.
+		void setRoutes(const HttpRoute* routes, int routeCount) {
+			this->routes = routes;
+			this->routeCount = (routes != NULL) ? routeCount : 0;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Sets metrics that collect timing of request processing phases and counts of
+		// failed requests (NULL disables collecting of metrics).
+		inline void setMetrics(HttpMetrics* metrics) {
+			this->metrics = metrics;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Sets the pool for leasing request and output buffers (used only with pooled
+		// buffers, requests are rejected with 503 while no buffer is available).
+		inline void setBufferPool(acp_utils_buffer_pool::BufferPool* pool) {
+			this->bufferPool = pool;
 		}
 
 		//--------------------------------------------------------------------------------
@@ -1191,7 +3824,13 @@ namespace acp_network_simple_http_client_handler {
 					state |= B00000001;
 				}
 
-				server->loop();
+				if (metrics != NULL) {
+					const unsigned long startTime = micros();
+					server->loop();
+					metrics->recordHoldTime(micros() - startTime);
+				} else {
+					server->loop();
+				}
 			}
 		}
 	};
@@ -1199,23 +3838,52 @@ namespace acp_network_simple_http_client_handler {
 	/********************************************************************************
 	 * View for a simple http client handler.
 	 ********************************************************************************/
-	template<int BUFFER_SIZE, long TIMEOUT> class TSimpleHttpClientHandler: public acp_network_libs_handling_srv::ClientHandlerWithServerSupport {
+	template<int BUFFER_SIZE, long TIMEOUT, int OUTPUT_BUFFER_SIZE, int MAX_CONNECTIONS, bool POOLED_BUFFERS, int MAX_PARAMETERS>
+			class TSimpleHttpClientHandler:
+			public acp_network_libs_handling_srv::ClientHandlerWithServerSupport {
 		friend class acp_network_libs_handling_srv::ClientHandlerWithServerSupport;
 	private:
 		// The handling controller.
-		SimpleHttpHandlingController<BUFFER_SIZE, TIMEOUT> &controller;
+		SimpleHttpHandlingController<BUFFER_SIZE, TIMEOUT, OUTPUT_BUFFER_SIZE, MAX_CONNECTIONS, POOLED_BUFFERS, MAX_PARAMETERS> &controller;
 
 	public:
 		//--------------------------------------------------------------------------------
 		// Constructs view for the client handler.
-		TSimpleHttpClientHandler(SimpleHttpHandlingController<BUFFER_SIZE, TIMEOUT> &controller):controller(controller) {
+		TSimpleHttpClientHandler(SimpleHttpHandlingController<BUFFER_SIZE, TIMEOUT, OUTPUT_BUFFER_SIZE, MAX_CONNECTIONS, POOLED_BUFFERS,
+				MAX_PARAMETERS> &controller):
+				controller(controller) {
 			// Nothing to do
 		}
 
 		//--------------------------------------------------------------------------------
 		// Handles the client. The client is closed immediately after it has been handled.
 		void handle(Client& client) {
-			controller.handle(client);
+			controller.connections[0].servedRequests = 0;
+			controller.handle(client, false);
+		}
+
+		//--------------------------------------------------------------------------------
+		// Publishes new events to all event streams (see writeEventsEvent).
+		inline void publishEvents() {
+			controller.publishEvents();
+		}
+
+		//--------------------------------------------------------------------------------
+		// Sets the table of routes stored in flash memory (see HttpRoute).
+		inline void setRoutes(const HttpRoute* routes, int routeCount) {
+			controller.setRoutes(routes, routeCount);
+		}
+
+		//--------------------------------------------------------------------------------
+		// Sets metrics that collect timing of request processing phases (see HttpMetrics).
+		inline void setMetrics(HttpMetrics* metrics) {
+			controller.setMetrics(metrics);
+		}
+
+		//--------------------------------------------------------------------------------
+		// Sets the pool for leasing request and output buffers (see TBufferPool).
+		inline void setBufferPool(acp_utils_buffer_pool::BufferPool* pool) {
+			controller.setBufferPool(pool);
 		}
 
 		//--------------------------------------------------------------------------------
@@ -1240,14 +3908,47 @@ namespace acp_network_simple_http_client_handler {
 		}
 
 		//--------------------------------------------------------------------------------
-		// Handles a client - only new clients are accepted.
+		// Handles a client - a client that is not new continues a persistent connection.
 		virtual void handle(Client& client, bool isNew) {
-			if (!isNew) {
+			if (isNew) {
+				controller.connections[0].servedRequests = 0;
+			}
+
+			controller.handle(client, controller.keepAliveTimeout > 0);
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns the number of connections that can be served concurrently.
+		virtual uint8_t getConnectionSlots() {
+			return MAX_CONNECTIONS;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Advances processing of a client served in given connection slot without waiting
+		// for data. Returns true, if the client remains connected.
+		virtual bool advance(Client& client, uint8_t slot, bool isNew) {
+			if (slot >= MAX_CONNECTIONS) {
 				controller.closeConnection(client);
-				return;
+				return false;
+			}
+
+			return controller.advance(client, controller.connections[slot], isNew);
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns whether the client served in given connection slot waits for a new request.
+		virtual bool isIdle(uint8_t slot) {
+			if (slot >= MAX_CONNECTIONS) {
+				return true;
 			}
 
-			controller.handle(client);
+			return (controller.connections[slot].phase == ConnectionState::IDLE);
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns maximal idle time in milliseconds of a persistent connection.
+		virtual unsigned long getKeepAliveTimeout() {
+			return controller.keepAliveTimeout;
 		}
 	};
 }
@@ -0,0 +1,267 @@
+#ifndef MODULES_ACP_UTILS_BUFFER_POOL_INCLUDE_BUFFERPOOL_H_
+#define MODULES_ACP_UTILS_BUFFER_POOL_INCLUDE_BUFFERPOOL_H_
+
+#include <acp/core.h>
+
+namespace acp_utils_buffer_pool {
+
+	template<int BLOCK_SIZE, int BLOCK_COUNT> class TBufferPool;
+	template<int BLOCK_SIZE, int BLOCK_COUNT> class BufferPoolController;
+
+	/********************************************************************************
+	 * Pool of buffers leased from a shared static storage. The storage is divided
+	 * into blocks of equal size, a buffer occupies a run of consecutive blocks.
+	 * Buffers of components that are not used at the same time share the storage,
+	 * the high-water mark shows the peak number of blocks leased concurrently.
+	 ********************************************************************************/
+	class BufferPool {
+	private:
+		// Marks of blocks that continue a run started in a preceding block
+		static const uint8_t RUN_CONTINUATION = 0xFF;
+
+		// Storage of blocks
+		uint8_t* storage;
+
+		// Lengths of runs of leased blocks (0 for a free block, RUN_CONTINUATION for
+		// a block that is not the first block of a run)
+		uint8_t* runs;
+
+		// Size of a block in bytes
+		int blockSize;
+
+		// Number of blocks
+		uint8_t blockCount;
+
+		// Number of leased blocks
+		uint8_t leasedBlocks;
+
+		// Maximal number of blocks leased at the same time
+		uint8_t highWaterMark;
+
+		// Number of leases that failed due to lack of free blocks
+		unsigned long failedLeases;
+	public:
+		//--------------------------------------------------------------------------------
+		// Constructs the pool over given storage of blocks and array of run lengths.
+		BufferPool(uint8_t* storage, uint8_t* runs, int blockSize, int blockCount) :
+				storage(storage), runs(runs), blockSize(blockSize), blockCount(blockCount), leasedBlocks(0), highWaterMark(0), failedLeases(0) {
+			memset(runs, 0, blockCount);
+		}
+
+		//--------------------------------------------------------------------------------
+		// Leases a buffer of given size (in bytes). Returns NULL, if there is no run of
+		// free blocks that is large enough.
+		uint8_t* lease(int size) {
+			if (size <= 0) {
+				return NULL;
+			}
+
+			const int requiredBlocks = (size + blockSize - 1) / blockSize;
+			if (requiredBlocks < RUN_CONTINUATION) {
+				// First fit
+				int freeBlocks = 0;
+				for (int i = 0; i < blockCount; i++) {
+					if (runs[i] != 0) {
+						freeBlocks = 0;
+						continue;
+					}
+
+					freeBlocks++;
+					if (freeBlocks == requiredBlocks) {
+						const int firstBlock = i - requiredBlocks + 1;
+						runs[firstBlock] = requiredBlocks;
+						for (int j = firstBlock + 1; j <= i; j++) {
+							runs[j] = RUN_CONTINUATION;
+						}
+
+						leasedBlocks += requiredBlocks;
+						if (leasedBlocks > highWaterMark) {
+							highWaterMark = leasedBlocks;
+						}
+
+						return storage + firstBlock * blockSize;
+					}
+				}
+			}
+
+			failedLeases++;
+			return NULL;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns a leased buffer to the pool.
+		void release(uint8_t* buffer) {
+			if ((buffer == NULL) || (buffer < storage)) {
+				return;
+			}
+
+			const int firstBlock = (buffer - storage) / blockSize;
+			if ((firstBlock >= blockCount) || (runs[firstBlock] == 0) || (runs[firstBlock] == RUN_CONTINUATION)) {
+				return;
+			}
+
+			const int runLength = runs[firstBlock];
+			memset(runs + firstBlock, 0, runLength);
+			leasedBlocks -= runLength;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns the size of a block in bytes.
+		inline int getBlockSize() {
+			return blockSize;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns the number of blocks.
+		inline int getBlockCount() {
+			return blockCount;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns the number of leased blocks.
+		inline int getLeasedBlocks() {
+			return leasedBlocks;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns the maximal number of blocks leased at the same time.
+		inline int getHighWaterMark() {
+			return highWaterMark;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns the number of leases that failed due to lack of free blocks.
+		inline unsigned long getFailedLeases() {
+			return failedLeases;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Sets the high-water mark to the number of currently leased blocks.
+		inline void resetHighWaterMark() {
+			highWaterMark = leasedBlocks;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Prints the usage report of the pool in Prometheus text format.
+		void print(Print* out) {
+			out->println(F("# HELP buffer_pool_capacity_bytes Size of the storage of the buffer pool."));
+			out->println(F("# TYPE buffer_pool_capacity_bytes gauge"));
+			out->print(F("buffer_pool_capacity_bytes "));
+			out->println((long) blockSize * blockCount);
+
+			out->println(F("# HELP buffer_pool_leased_bytes Size of currently leased blocks."));
+			out->println(F("# TYPE buffer_pool_leased_bytes gauge"));
+			out->print(F("buffer_pool_leased_bytes "));
+			out->println((long) blockSize * leasedBlocks);
+
+			out->println(F("# HELP buffer_pool_high_water_mark_bytes Maximal size of blocks leased at the same time."));
+			out->println(F("# TYPE buffer_pool_high_water_mark_bytes gauge"));
+			out->print(F("buffer_pool_high_water_mark_bytes "));
+			out->println((long) blockSize * highWaterMark);
+
+			out->println(F("# HELP buffer_pool_failed_leases_total Leases that failed due to lack of free blocks."));
+			out->println(F("# TYPE buffer_pool_failed_leases_total counter"));
+			out->print(F("buffer_pool_failed_leases_total "));
+			out->println(failedLeases);
+		}
+	};
+
+	/********************************************************************************
+	 * Buffer leased from a pool for the lifetime of the lease object
+	 ********************************************************************************/
+	class BufferLease {
+	private:
+		// Pool of the buffer
+		BufferPool* pool;
+
+		// Leased buffer (NULL, if the lease failed)
+		uint8_t* buffer;
+
+		// A lease cannot be copied (the buffer would be released twice)
+		BufferLease(const BufferLease&);
+		BufferLease& operator=(const BufferLease&);
+	public:
+		//--------------------------------------------------------------------------------
+		// Leases a buffer of given size from the pool (the pool can be NULL).
+		BufferLease(BufferPool* pool, int size) :
+				pool(pool), buffer((pool != NULL) ? pool->lease(size) : NULL) {
+			// Nothing to do
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns the buffer to the pool.
+		~BufferLease() {
+			if (buffer != NULL) {
+				pool->release(buffer);
+			}
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns the leased buffer (NULL, if the lease failed).
+		inline uint8_t* get() {
+			return buffer;
+		}
+	};
+
+	/********************************************************************************
+	 * Controller of the buffer pool with static storage.
+	 ********************************************************************************/
+	template<int BLOCK_SIZE, int BLOCK_COUNT> class BufferPoolController: public BufferPool {
+		friend class TBufferPool<BLOCK_SIZE, BLOCK_COUNT>;
+	private:
+		// Storage of blocks
+		uint8_t blocks[BLOCK_SIZE * BLOCK_COUNT];
+
+		// Lengths of runs of leased blocks
+		uint8_t blockRuns[BLOCK_COUNT];
+	public:
+		//--------------------------------------------------------------------------------
+		// Constructs the controller.
+		BufferPoolController() :
+				BufferPool(blocks, blockRuns, BLOCK_SIZE, BLOCK_COUNT) {
+			// Nothing to do
+		}
+	};
+
+	/********************************************************************************
+	 * Buffer pool (view)
+	 ********************************************************************************/
+	template<int BLOCK_SIZE, int BLOCK_COUNT> class TBufferPool {
+	private:
+		// The controller
+		BufferPoolController<BLOCK_SIZE, BLOCK_COUNT>& controller;
+	public:
+		//--------------------------------------------------------------------------------
+		// Constructs view for the buffer pool.
+		TBufferPool(BufferPoolController<BLOCK_SIZE, BLOCK_COUNT>& controller) :
+				controller(controller) {
+			// Nothing to do
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns the pool (passed to components that lease buffers).
+		inline BufferPool* getPool() {
+			return &controller;
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns the maximal number of bytes leased at the same time.
+		inline long getHighWaterMark() {
+			return (long) BLOCK_SIZE * controller.getHighWaterMark();
+		}
+
+		//--------------------------------------------------------------------------------
+		// Returns the number of leases that failed due to lack of free blocks.
+		inline unsigned long getFailedLeases() {
+			return controller.getFailedLeases();
+		}
+
+		//--------------------------------------------------------------------------------
+		// Prints the usage report of the pool in Prometheus text format.
+		inline void print(Print* out) {
+			controller.print(out);
+		}
+	};
+}
+
+#endif /* MODULES_ACP_UTILS_BUFFER_POOL_INCLUDE_BUFFERPOOL_H_ */
@@ -0,0 +1,61 @@
+################################################################################
+# Common make rules for host (desktop) builds of ACP modules.
+#
+# A module harness sets HOST_TARGETS (and optionally ACP_SOURCES with module
+# sources to link) and includes this file. The ACP include layout
+# <acp/<category>/<module>/X.h> is created in $(BUILD_DIR)/include as
+# symbolic links to the include directories of the modules.
+#
+# Fuzz targets define LLVMFuzzerTestOneInput(). By default they are linked
+# with a standalone driver (corpus files, stdin for AFL, or random inputs);
+# with clang use FUZZ_ENGINE=-fsanitize=fuzzer to link them with libFuzzer.
+################################################################################
+
+REPO_ROOT := $(abspath $(dir $(lastword $(MAKEFILE_LIST)))/../..)
+HOST_DIR := $(REPO_ROOT)/extras/host
+
+BUILD_DIR ?= build
+CXX ?= g++
+OPTIMIZE ?= -O2
+CXXFLAGS ?= -std=gnu++11 $(OPTIMIZE) -g -Wall
+SANITIZE ?= -fsanitize=address,undefined -fno-omit-frame-pointer
+FUZZ_ENGINE ?=
+FUZZ_DRIVER := $(if $(FUZZ_ENGINE),,$(HOST_DIR)/src/FuzzDriver.cpp)
+
+HOST_CORE := $(HOST_DIR)/src/HostCore.cpp
+HOST_INCLUDES := -I$(HOST_DIR)/include -I$(BUILD_DIR)/include
+ACP_INCLUDE_STAMP := $(BUILD_DIR)/include/.acp
+
+# Writes dependencies of the harness source (the module headers) to $@.d
+DEPEND = $(CXX) $(CXXFLAGS) $(HOST_INCLUDES) -MM -MP -MT $@ -MF $@.d $<
+
+all: $(addprefix $(BUILD_DIR)/,$(HOST_TARGETS))
+
+# Links the module include directories (not the build trees in extras) into <acp/...>
+$(ACP_INCLUDE_STAMP):
+	@rm -rf $(BUILD_DIR)/include/acp
+	@cd $(REPO_ROOT) && for dir in `find acp -path '*/extras' -prune -o -type d -name include -print`; do \
+		link=$(abspath $(BUILD_DIR))/include/$${dir%/include}; \
+		mkdir -p `dirname $$link` && ln -sfn $(REPO_ROOT)/$$dir $$link; \
+	done
+	@touch $@
+
+# Benchmarks are built without sanitizers
+$(BUILD_DIR)/%Benchmark: %Benchmark.cpp $(ACP_INCLUDE_STAMP) $(HOST_CORE)
+	$(DEPEND)
+	$(CXX) $(CXXFLAGS) $(HOST_INCLUDES) -o $@ $< $(HOST_CORE) $(ACP_SOURCES) $(LDLIBS)
+
+$(BUILD_DIR)/%Fuzzer: %Fuzzer.cpp $(ACP_INCLUDE_STAMP) $(HOST_CORE)
+	$(DEPEND)
+	$(CXX) $(CXXFLAGS) $(SANITIZE) $(FUZZ_ENGINE) $(HOST_INCLUDES) -o $@ $< $(FUZZ_DRIVER) $(HOST_CORE) $(ACP_SOURCES) $(LDLIBS)
+
+$(BUILD_DIR)/%: %.cpp $(ACP_INCLUDE_STAMP) $(HOST_CORE)
+	$(DEPEND)
+	$(CXX) $(CXXFLAGS) $(HOST_INCLUDES) -o $@ $< $(HOST_CORE) $(ACP_SOURCES) $(LDLIBS)
+
+-include $(wildcard $(BUILD_DIR)/*.d)
+
+clean:
+	rm -rf $(BUILD_DIR)
+
+.PHONY: all clean
@@ -0,0 +1,91 @@
+#ifndef HOST_ARDUINO_H_
+#define HOST_ARDUINO_H_
+
+/********************************************************************************
+ * Minimal Arduino core for host (desktop) builds of ACP modules. It provides
+ * only what the modules use: basic types, PROGMEM access (flash strings are
+ * ordinary strings on the host), Print/Stream and the time functions driven
+ * by a simulated clock (see HostCore.h).
+ ********************************************************************************/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "binary.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+//--------------------------------------------------------------------------------
+// Flash memory access
+#define PROGMEM
+#define PSTR(s) (s)
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(PSTR(s)))
+typedef const char* PGM_P;
+
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define pgm_read_word(addr) (*(const uint16_t*)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t*)(addr))
+#define pgm_read_ptr(addr) (*(void* const*)(addr))
+
+#define memcpy_P memcpy
+#define strcpy_P strcpy
+#define strcmp_P strcmp
+#define strncmp_P strncmp
+#define strlen_P strlen
+#define strstr_P strstr
+
+//--------------------------------------------------------------------------------
+// Math functions (min and max are templates, macros would break C++ library headers)
+template<typename T, typename U> inline auto min(const T& a, const U& b) -> decltype(a < b ? a : b) {
+	return (b < a) ? b : a;
+}
+
+template<typename T, typename U> inline auto max(const T& a, const U& b) -> decltype(a < b ? a : b) {
+	return (a < b) ? b : a;
+}
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+//--------------------------------------------------------------------------------
+// Time (simulated clock)
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+class __FlashStringHelper;
+
+/********************************************************************************
+ * String (only as a type, the modules do not use its methods)
+ ********************************************************************************/
+class String {
+private:
+	const char* buffer;
+
+public:
+	String(const char* str = "") :
+			buffer(str) {
+	}
+
+	const char* c_str() const {
+		return buffer;
+	}
+
+	unsigned int length() const {
+		return strlen(buffer);
+	}
+};
+
+#include "Print.h"
+#include "Stream.h"
+
+#endif /* HOST_ARDUINO_H_ */
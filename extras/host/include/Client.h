@@ -0,0 +1,28 @@
+#ifndef HOST_CLIENT_H_
+#define HOST_CLIENT_H_
+
+#include <Arduino.h>
+#include <IPAddress.h>
+
+/********************************************************************************
+ * Network client interface of the Arduino core.
+ ********************************************************************************/
+class Client: public Stream {
+public:
+	virtual int connect(IPAddress ip, uint16_t port) = 0;
+	virtual int connect(const char* host, uint16_t port) = 0;
+	virtual size_t write(uint8_t) = 0;
+	virtual size_t write(const uint8_t* buf, size_t size) = 0;
+	virtual int available() = 0;
+	virtual int read() = 0;
+	virtual int read(uint8_t* buf, size_t size) = 0;
+	virtual int peek() = 0;
+	virtual void flush() = 0;
+	virtual void stop() = 0;
+	virtual uint8_t connected() = 0;
+	virtual operator bool() = 0;
+
+	using Print::write;
+};
+
+#endif /* HOST_CLIENT_H_ */
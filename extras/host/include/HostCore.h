@@ -0,0 +1,27 @@
+#ifndef HOST_HOSTCORE_H_
+#define HOST_HOSTCORE_H_
+
+/********************************************************************************
+ * Host-only control of the simulated Arduino clock.
+ *
+ * millis() and micros() return a virtual time that advances only when the
+ * harness asks for it, so that timeouts of the modules are deterministic and
+ * delay() does not sleep. Harnesses that talk to real sockets call
+ * hostSyncClock() to move the virtual time to the real elapsed time.
+ ********************************************************************************/
+
+#include <Arduino.h>
+
+//--------------------------------------------------------------------------------
+// Advances the simulated clock by given number of microseconds.
+void hostAdvanceMicros(unsigned long us);
+
+//--------------------------------------------------------------------------------
+// Advances the simulated clock to the real time elapsed since the start of program.
+void hostSyncClock();
+
+//--------------------------------------------------------------------------------
+// Returns real (monotonic) time in nanoseconds, for measurements.
+uint64_t hostNanos();
+
+#endif /* HOST_HOSTCORE_H_ */
@@ -0,0 +1,42 @@
+#ifndef HOST_IPADDRESS_H_
+#define HOST_IPADDRESS_H_
+
+#include <Arduino.h>
+
+/********************************************************************************
+ * IPv4 address.
+ ********************************************************************************/
+class IPAddress {
+private:
+	uint8_t bytes[4];
+
+public:
+	IPAddress() {
+		memset(bytes, 0, sizeof(bytes));
+	}
+
+	IPAddress(uint8_t b0, uint8_t b1, uint8_t b2, uint8_t b3) {
+		bytes[0] = b0;
+		bytes[1] = b1;
+		bytes[2] = b2;
+		bytes[3] = b3;
+	}
+
+	uint8_t operator[](int index) const {
+		return bytes[index];
+	}
+
+	uint8_t& operator[](int index) {
+		return bytes[index];
+	}
+
+	bool operator==(const IPAddress& addr) const {
+		return memcmp(bytes, addr.bytes, sizeof(bytes)) == 0;
+	}
+
+	bool operator!=(const IPAddress& addr) const {
+		return !(*this == addr);
+	}
+};
+
+#endif /* HOST_IPADDRESS_H_ */
@@ -0,0 +1,142 @@
+#ifndef HOST_MEMORYCLIENT_H_
+#define HOST_MEMORYCLIENT_H_
+
+#include <Client.h>
+
+/********************************************************************************
+ * Client that reads data received from a memory buffer and collects sent data
+ * (the last OUTPUT_SIZE bytes are kept).
+ ********************************************************************************/
+template<int OUTPUT_SIZE> class MemoryClient: public Client {
+private:
+	// Received data
+	const uint8_t* input;
+	size_t inputLength;
+	size_t inputPosition;
+
+	// Sent data (circular buffer)
+	char output[OUTPUT_SIZE + 1];
+	unsigned long sentBytes;
+
+	// Indicates whether the connection is open
+	bool open;
+
+public:
+	MemoryClient() {
+		reset(NULL, 0);
+	}
+
+	//--------------------------------------------------------------------------------
+	// Opens the connection and sets data that are received from the client.
+	void reset(const char* data, size_t length) {
+		input = (const uint8_t*) data;
+		inputLength = length;
+		inputPosition = 0;
+		sentBytes = 0;
+		output[0] = 0;
+		open = true;
+	}
+
+	//--------------------------------------------------------------------------------
+	// Makes more data available (data must continue the previous data).
+	void extend(const char* data, size_t length) {
+		input = (const uint8_t*) data;
+		inputLength = length;
+	}
+
+	//--------------------------------------------------------------------------------
+	// Returns the number of bytes sent to the client.
+	unsigned long getSentBytes() {
+		return sentBytes;
+	}
+
+	//--------------------------------------------------------------------------------
+	// Returns the sent data (as a string), if all of them are kept.
+	const char* getOutput() {
+		if (sentBytes > OUTPUT_SIZE) {
+			return NULL;
+		}
+
+		output[sentBytes] = 0;
+		return output;
+	}
+
+	int connect(IPAddress, uint16_t) {
+		return 0;
+	}
+
+	int connect(const char*, uint16_t) {
+		return 0;
+	}
+
+	size_t write(uint8_t data) {
+		if (!open) {
+			return 0;
+		}
+
+		output[sentBytes % OUTPUT_SIZE] = data;
+		sentBytes++;
+		return 1;
+	}
+
+	size_t write(const uint8_t* buffer, size_t size) {
+		for (size_t i = 0; i < size; i++) {
+			if (write(buffer[i]) == 0) {
+				return i;
+			}
+		}
+		return size;
+	}
+
+	int available() {
+		return open ? inputLength - inputPosition : 0;
+	}
+
+	int read() {
+		return (available() > 0) ? input[inputPosition++] : -1;
+	}
+
+	int read(uint8_t* buffer, size_t size) {
+		const size_t count = ((size_t) available() < size) ? available() : size;
+		if (count > 0) {
+			memcpy(buffer, input + inputPosition, count);
+		}
+		inputPosition += count;
+		return count;
+	}
+
+	int peek() {
+		return (available() > 0) ? input[inputPosition] : -1;
+	}
+
+	void flush() {
+	}
+
+	void stop() {
+		open = false;
+	}
+
+	uint8_t connected() {
+		return open;
+	}
+
+	operator bool() {
+		return open;
+	}
+
+	bool operator==(const MemoryClient& client) const {
+		return this == &client;
+	}
+
+	bool operator!=(const MemoryClient& client) const {
+		return this != &client;
+	}
+
+	IPAddress remoteIP() {
+		return IPAddress(127, 0, 0, 1);
+	}
+
+	using Print::write;
+};
+
+#endif /* HOST_MEMORYCLIENT_H_ */
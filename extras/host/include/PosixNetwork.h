@@ -0,0 +1,348 @@
+#ifndef HOST_POSIXNETWORK_H_
+#define HOST_POSIXNETWORK_H_
+
+/********************************************************************************
+ * Client and Server of the Arduino network API on top of POSIX TCP sockets.
+ *
+ * Like EthernetClient, a PosixClient is a handle of a connection (a socket
+ * descriptor) that can be copied and compared; stop() closes the connection.
+ * Like EthernetServer, PosixServer::available() accepts pending connections and
+ * returns a client that has data available (or an invalid client).
+ ********************************************************************************/
+
+#include <Client.h>
+#include <Server.h>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/********************************************************************************
+ * Client connected by a TCP socket.
+ ********************************************************************************/
+class PosixClient: public Client {
+private:
+	// Socket descriptor (-1, if not connected)
+	int fd;
+
+	//--------------------------------------------------------------------------------
+	// Connects to an address.
+	int connect(const struct sockaddr_in& address) {
+		stop();
+		fd = socket(AF_INET, SOCK_STREAM, 0);
+		if (fd < 0) {
+			return 0;
+		}
+
+		if (::connect(fd, (const struct sockaddr*) &address, sizeof(address)) != 0) {
+			stop();
+			return 0;
+		}
+
+		configure(fd);
+		return 1;
+	}
+
+public:
+	PosixClient() :
+			fd(-1) {
+	}
+
+	explicit PosixClient(int fd) :
+			fd(fd) {
+	}
+
+	//--------------------------------------------------------------------------------
+	// Configures a socket of a connection (small writes are sent without delay).
+	static void configure(int fd) {
+		int enabled = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enabled, sizeof(enabled));
+	}
+
+	//--------------------------------------------------------------------------------
+	// Returns the socket descriptor.
+	int getSocket() const {
+		return fd;
+	}
+
+	int connect(IPAddress ip, uint16_t port) {
+		struct sockaddr_in address;
+		memset(&address, 0, sizeof(address));
+		address.sin_family = AF_INET;
+		address.sin_port = htons(port);
+		address.sin_addr.s_addr = htonl(((uint32_t) ip[0] << 24) | ((uint32_t) ip[1] << 16)
+				| ((uint32_t) ip[2] << 8) | ip[3]);
+		return connect(address);
+	}
+
+	int connect(const char* host, uint16_t port) {
+		struct addrinfo hints;
+		memset(&hints, 0, sizeof(hints));
+		hints.ai_family = AF_INET;
+		hints.ai_socktype = SOCK_STREAM;
+		struct addrinfo* result;
+		if (getaddrinfo(host, NULL, &hints, &result) != 0) {
+			return 0;
+		}
+
+		struct sockaddr_in address = *(struct sockaddr_in*) result->ai_addr;
+		freeaddrinfo(result);
+		address.sin_port = htons(port);
+		return connect(address);
+	}
+
+	size_t write(uint8_t data) {
+		return write(&data, 1);
+	}
+
+	size_t write(const uint8_t* buffer, size_t size) {
+		size_t written = 0;
+		while ((fd >= 0) && (written < size)) {
+			const ssize_t result = send(fd, buffer + written, size - written, MSG_NOSIGNAL);
+			if (result < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				break;
+			}
+			written += result;
+		}
+		return written;
+	}
+
+	int available() {
+		int count = 0;
+		if ((fd < 0) || (ioctl(fd, FIONREAD, &count) != 0)) {
+			return 0;
+		}
+		return count;
+	}
+
+	int read() {
+		uint8_t data;
+		return (read(&data, 1) == 1) ? data : -1;
+	}
+
+	int read(uint8_t* buffer, size_t size) {
+		if (fd < 0) {
+			return -1;
+		}
+
+		const ssize_t result = recv(fd, buffer, size, MSG_DONTWAIT);
+		return (result > 0) ? result : -1;
+	}
+
+	int peek() {
+		uint8_t data;
+		if ((fd < 0) || (recv(fd, &data, 1, MSG_PEEK | MSG_DONTWAIT) != 1)) {
+			return -1;
+		}
+		return data;
+	}
+
+	void flush() {
+	}
+
+	void stop() {
+		if (fd >= 0) {
+			close(fd);
+			fd = -1;
+		}
+	}
+
+	uint8_t connected() {
+		if (fd < 0) {
+			return false;
+		}
+
+		// The connection is closed by the peer, if there are no data to read
+		uint8_t data;
+		const ssize_t result = recv(fd, &data, 1, MSG_PEEK | MSG_DONTWAIT);
+		if (result == 0) {
+			return false;
+		}
+
+		return (result > 0) || (errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR);
+	}
+
+	operator bool() {
+		return fd >= 0;
+	}
+
+	bool operator==(const PosixClient& client) const {
+		return fd == client.fd;
+	}
+
+	bool operator!=(const PosixClient& client) const {
+		return fd != client.fd;
+	}
+
+	IPAddress remoteIP() {
+		struct sockaddr_in address;
+		socklen_t length = sizeof(address);
+		if ((fd < 0) || (getpeername(fd, (struct sockaddr*) &address, &length) != 0)) {
+			return IPAddress();
+		}
+
+		const uint32_t ip = ntohl(address.sin_addr.s_addr);
+		return IPAddress(ip >> 24, ip >> 16, ip >> 8, ip);
+	}
+
+	using Print::write;
+};
+
+/********************************************************************************
+ * Server listening on a TCP port.
+ ********************************************************************************/
+class PosixServer: public Server {
+private:
+	// Maximal number of tracked connections
+	static const int MAX_CONNECTIONS = 64;
+
+	// Listening port
+	uint16_t port;
+
+	// Listening socket
+	int listenFd;
+
+	// Sockets of accepted connections
+	int connections[MAX_CONNECTIONS];
+	int connectionCount;
+
+	// Index of the next connection checked for available data (round robin)
+	int nextConnection;
+
+	//--------------------------------------------------------------------------------
+	// Removes connections closed by stop() of a client.
+	void removeClosedConnections() {
+		for (int i = 0; i < connectionCount; i++) {
+			if (fcntl(connections[i], F_GETFD) < 0) {
+				connections[i] = connections[--connectionCount];
+				i--;
+			}
+		}
+	}
+
+	//--------------------------------------------------------------------------------
+	// Accepts a pending connection and returns its socket (or -1).
+	int acceptConnection() {
+		if (listenFd < 0) {
+			return -1;
+		}
+
+		const int fd = ::accept(listenFd, NULL, NULL);
+		if (fd < 0) {
+			return -1;
+		}
+
+		PosixClient::configure(fd);
+		for (int i = 0; i < connectionCount; i++) {
+			if (connections[i] == fd) {
+				return fd;
+			}
+		}
+
+		if (connectionCount < MAX_CONNECTIONS) {
+			connections[connectionCount++] = fd;
+		}
+		return fd;
+	}
+
+public:
+	PosixServer(uint16_t port) :
+			port(port), listenFd(-1), connectionCount(0), nextConnection(0) {
+	}
+
+	void begin() {
+		listenFd = socket(AF_INET, SOCK_STREAM, 0);
+		if (listenFd < 0) {
+			return;
+		}
+
+		int enabled = 1;
+		setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &enabled, sizeof(enabled));
+
+		struct sockaddr_in address;
+		memset(&address, 0, sizeof(address));
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_ANY);
+		address.sin_port = htons(port);
+		if ((bind(listenFd, (struct sockaddr*) &address, sizeof(address)) != 0)
+				|| (listen(listenFd, 128) != 0)) {
+			close(listenFd);
+			listenFd = -1;
+			return;
+		}
+
+		fcntl(listenFd, F_SETFL, fcntl(listenFd, F_GETFL) | O_NONBLOCK);
+	}
+
+	//--------------------------------------------------------------------------------
+	// Returns whether the server listens.
+	bool listening() {
+		return listenFd >= 0;
+	}
+
+	//--------------------------------------------------------------------------------
+	// Returns a new connection (or an invalid client), without waiting for data.
+	PosixClient accept() {
+		removeClosedConnections();
+		return PosixClient(acceptConnection());
+	}
+
+	//--------------------------------------------------------------------------------
+	// Returns a client with data available or closed by the peer (so that the server
+	// stops it) or an invalid client.
+	PosixClient available() {
+		removeClosedConnections();
+		while (acceptConnection() >= 0) {
+		}
+
+		for (int i = 0; i < connectionCount; i++) {
+			const int idx = (nextConnection + i) % connectionCount;
+			PosixClient client(connections[idx]);
+			if ((client.available() > 0) || !client.connected()) {
+				nextConnection = idx + 1;
+				return client;
+			}
+		}
+
+		return PosixClient();
+	}
+
+	//--------------------------------------------------------------------------------
+	// Waits at most timeout milliseconds for a new connection or for data of a client
+	// (so that a looping harness does not keep the processor busy).
+	void wait(int timeout) {
+		struct pollfd pollFds[MAX_CONNECTIONS + 1];
+		pollFds[0].fd = listenFd;
+		pollFds[0].events = POLLIN;
+		for (int i = 0; i < connectionCount; i++) {
+			pollFds[i + 1].fd = connections[i];
+			pollFds[i + 1].events = POLLIN;
+		}
+		poll(pollFds, connectionCount + 1, timeout);
+	}
+
+	size_t write(uint8_t data) {
+		return write(&data, 1);
+	}
+
+	size_t write(const uint8_t* buffer, size_t size) {
+		for (int i = 0; i < connectionCount; i++) {
+			PosixClient(connections[i]).write(buffer, size);
+		}
+		return size;
+	}
+
+	using Print::write;
+};
+
+#endif /* HOST_POSIXNETWORK_H_ */
@@ -0,0 +1,77 @@
+// Arduino.h includes this header after its own declarations
+#include <Arduino.h>
+
+#ifndef HOST_PRINT_H_
+#define HOST_PRINT_H_
+
+class Print;
+
+/********************************************************************************
+ * Object that can print itself to a Print.
+ ********************************************************************************/
+class Printable {
+public:
+	virtual ~Printable() {
+	}
+
+	virtual size_t printTo(Print& p) const = 0;
+};
+
+/********************************************************************************
+ * Print with the formatting of the Arduino core.
+ ********************************************************************************/
+class Print {
+private:
+	size_t printNumber(unsigned long n, uint8_t base);
+	size_t printFloat(double number, uint8_t digits);
+
+public:
+	virtual ~Print() {
+	}
+
+	virtual size_t write(uint8_t) = 0;
+
+	virtual size_t write(const uint8_t* buffer, size_t size);
+
+	size_t write(const char* str) {
+		return (str == NULL) ? 0 : write((const uint8_t*) str, strlen(str));
+	}
+
+	size_t write(const char* buffer, size_t size) {
+		return write((const uint8_t*) buffer, size);
+	}
+
+	virtual int availableForWrite() {
+		return 0;
+	}
+
+	virtual void flush() {
+	}
+
+	size_t print(const __FlashStringHelper* str);
+	size_t print(const String& str);
+	size_t print(const char str[]);
+	size_t print(char c);
+	size_t print(unsigned char n, int base = DEC);
+	size_t print(int n, int base = DEC);
+	size_t print(unsigned int n, int base = DEC);
+	size_t print(long n, int base = DEC);
+	size_t print(unsigned long n, int base = DEC);
+	size_t print(double n, int digits = 2);
+	size_t print(const Printable& x);
+
+	size_t println(const __FlashStringHelper* str);
+	size_t println(const String& str);
+	size_t println(const char str[]);
+	size_t println(char c);
+	size_t println(unsigned char n, int base = DEC);
+	size_t println(int n, int base = DEC);
+	size_t println(unsigned int n, int base = DEC);
+	size_t println(long n, int base = DEC);
+	size_t println(unsigned long n, int base = DEC);
+	size_t println(double n, int digits = 2);
+	size_t println(const Printable& x);
+	size_t println();
+};
+
+#endif /* HOST_PRINT_H_ */
@@ -0,0 +1,14 @@
+#ifndef HOST_SERVER_H_
+#define HOST_SERVER_H_
+
+#include <Arduino.h>
+
+/********************************************************************************
+ * Network server interface of the Arduino core.
+ ********************************************************************************/
+class Server: public Print {
+public:
+	virtual void begin() = 0;
+};
+
+#endif /* HOST_SERVER_H_ */
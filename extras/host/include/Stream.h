@@ -0,0 +1,38 @@
+// Arduino.h includes this header after its own declarations
+#include <Arduino.h>
+
+#ifndef HOST_STREAM_H_
+#define HOST_STREAM_H_
+
+/********************************************************************************
+ * Stream of the Arduino core (without the parsing methods).
+ ********************************************************************************/
+class Stream: public Print {
+protected:
+	unsigned long timeout;
+
+public:
+	Stream() :
+			timeout(1000) {
+	}
+
+	virtual int available() = 0;
+	virtual int read() = 0;
+	virtual int peek() = 0;
+
+	void setTimeout(unsigned long timeout) {
+		this->timeout = timeout;
+	}
+
+	unsigned long getTimeout() {
+		return timeout;
+	}
+
+	size_t readBytes(char* buffer, size_t length);
+
+	size_t readBytes(uint8_t* buffer, size_t length) {
+		return readBytes((char*) buffer, length);
+	}
+};
+
+#endif /* HOST_STREAM_H_ */
@@ -0,0 +1,30 @@
+#ifndef HOST_ACP_CORE_H_
+#define HOST_ACP_CORE_H_
+
+/********************************************************************************
+ * Host replacement of the core header generated by the ACP build tool.
+ ********************************************************************************/
+
+#include <Arduino.h>
+
+#ifndef ACP_DEBUG
+#define ACP_DEBUG false
+#endif
+
+// Tracing is compiled out in host builds (the tracer module is not linked).
+#ifndef ACP_TRACE
+#define ACP_TRACE(...)
+#endif
+
+// Handler of an event without parameters.
+typedef void (*ACPEventHandler)();
+
+namespace acp {
+	// Enables a looper (no looper scheduler runs in host builds).
+	void enableLooper(int looperId);
+
+	// Disables a looper.
+	void disableLooper(int looperId);
+}
+
+#endif /* HOST_ACP_CORE_H_ */
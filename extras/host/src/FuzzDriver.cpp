@@ -0,0 +1,81 @@
+/********************************************************************************
+ * Standalone driver for fuzz targets (used when libFuzzer is not available).
+ *
+ * Usage:
+ *   fuzzer FILE...                    runs the target on each file (corpus replay)
+ *   fuzzer -runs=N [-seed=S] [-max_len=L]  runs the target on N random inputs
+ *   fuzzer < FILE                     runs the target on stdin (AFL)
+ ********************************************************************************/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+//--------------------------------------------------------------------------------
+// Runs the target on content of a file.
+static void runFile(FILE* file) {
+	static uint8_t data[1 << 20];
+	const size_t size = fread(data, 1, sizeof(data), file);
+	LLVMFuzzerTestOneInput(data, size);
+}
+
+//--------------------------------------------------------------------------------
+// Returns value of an option in form -name=value, or NULL.
+static const char* optionValue(const char* arg, const char* name) {
+	const size_t length = strlen(name);
+	if ((arg[0] == '-') && (strncmp(arg + 1, name, length) == 0) && (arg[length + 1] == '=')) {
+		return arg + length + 2;
+	}
+	return NULL;
+}
+
+int main(int argc, char** argv) {
+	long runs = -1;
+	unsigned long seed = 1;
+	size_t maxLength = 64;
+	int files = 0;
+
+	for (int i = 1; i < argc; i++) {
+		const char* value;
+		if ((value = optionValue(argv[i], "runs")) != NULL) {
+			runs = atol(value);
+		} else if ((value = optionValue(argv[i], "seed")) != NULL) {
+			seed = strtoul(value, NULL, 10);
+		} else if ((value = optionValue(argv[i], "max_len")) != NULL) {
+			maxLength = strtoul(value, NULL, 10);
+		} else {
+			FILE* file = fopen(argv[i], "rb");
+			if (file == NULL) {
+				fprintf(stderr, "Cannot open %s\n", argv[i]);
+				return 1;
+			}
+			runFile(file);
+			fclose(file);
+			files++;
+		}
+	}
+
+	if (runs < 0) {
+		if (files == 0) {
+			runFile(stdin);
+		}
+		return 0;
+	}
+
+	// Random inputs biased towards small byte values (request codes, short lengths)
+	srand(seed);
+	uint8_t* data = new uint8_t[maxLength + 1];
+	for (long run = 0; run < runs; run++) {
+		const size_t size = rand() % (maxLength + 1);
+		for (size_t i = 0; i < size; i++) {
+			data[i] = (rand() % 4 != 0) ? rand() % 16 : rand();
+		}
+		LLVMFuzzerTestOneInput(data, size);
+	}
+	delete[] data;
+	printf("Done %ld runs\n", runs);
+	return 0;
+}
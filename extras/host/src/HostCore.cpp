@@ -0,0 +1,269 @@
+#include <HostCore.h>
+#include <acp/core.h>
+#include <time.h>
+
+//--------------------------------------------------------------------------------
+// Simulated clock
+
+// Virtual time in microseconds
+static uint64_t virtualMicros = 0;
+
+// Real time of the first call of hostNanos()
+static uint64_t startNanos = 0;
+
+uint64_t hostNanos() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	const uint64_t nanos = (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+	if (startNanos == 0) {
+		startNanos = nanos;
+	}
+	return nanos;
+}
+
+void hostAdvanceMicros(unsigned long us) {
+	virtualMicros += us;
+}
+
+void hostSyncClock() {
+	const uint64_t nanos = hostNanos();
+	const uint64_t realMicros = (nanos - startNanos) / 1000;
+	if (realMicros > virtualMicros) {
+		virtualMicros = realMicros;
+	}
+}
+
+unsigned long millis() {
+	return (unsigned long) (virtualMicros / 1000);
+}
+
+unsigned long micros() {
+	return (unsigned long) virtualMicros;
+}
+
+void delay(unsigned long ms) {
+	virtualMicros += (uint64_t) ms * 1000;
+}
+
+void delayMicroseconds(unsigned int us) {
+	virtualMicros += us;
+}
+
+void yield() {
+}
+
+namespace acp {
+	void enableLooper(int) {
+	}
+
+	void disableLooper(int) {
+	}
+}
+
+//--------------------------------------------------------------------------------
+// Print
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+	size_t n = 0;
+	while (size--) {
+		if (write(*buffer++)) {
+			n++;
+		} else {
+			break;
+		}
+	}
+	return n;
+}
+
+size_t Print::printNumber(unsigned long n, uint8_t base) {
+	char buf[8 * sizeof(long) + 1];
+	char* str = &buf[sizeof(buf) - 1];
+	*str = '\0';
+
+	if (base < 2) {
+		base = 10;
+	}
+
+	do {
+		const char c = n % base;
+		n /= base;
+		*--str = (c < 10) ? c + '0' : c + 'A' - 10;
+	} while (n);
+
+	return write(str);
+}
+
+size_t Print::printFloat(double number, uint8_t digits) {
+	if (isnan(number)) {
+		return print("nan");
+	}
+
+	if (isinf(number)) {
+		return print("inf");
+	}
+
+	if ((number > 4294967040.0) || (number < -4294967040.0)) {
+		return print("ovf");
+	}
+
+	size_t n = 0;
+	if (number < 0.0) {
+		n += print('-');
+		number = -number;
+	}
+
+	double rounding = 0.5;
+	for (uint8_t i = 0; i < digits; ++i) {
+		rounding /= 10.0;
+	}
+	number += rounding;
+
+	unsigned long intPart = (unsigned long) number;
+	double remainder = number - (double) intPart;
+	n += print(intPart);
+
+	if (digits > 0) {
+		n += print('.');
+	}
+
+	while (digits-- > 0) {
+		remainder *= 10.0;
+		const unsigned int toPrint = (unsigned int) remainder;
+		n += print(toPrint);
+		remainder -= toPrint;
+	}
+
+	return n;
+}
+
+size_t Print::print(const __FlashStringHelper* str) {
+	return write((const char*) str);
+}
+
+size_t Print::print(const String& str) {
+	return write(str.c_str());
+}
+
+size_t Print::print(const char str[]) {
+	return write(str);
+}
+
+size_t Print::print(char c) {
+	return write((uint8_t) c);
+}
+
+size_t Print::print(unsigned char n, int base) {
+	return print((unsigned long) n, base);
+}
+
+size_t Print::print(int n, int base) {
+	return print((long) n, base);
+}
+
+size_t Print::print(unsigned int n, int base) {
+	return print((unsigned long) n, base);
+}
+
+size_t Print::print(long n, int base) {
+	if (base == 0) {
+		return write((uint8_t) n);
+	}
+
+	if ((base == 10) && (n < 0)) {
+		const size_t t = print('-');
+		return printNumber(-(unsigned long) n, 10) + t;
+	}
+
+	return printNumber(n, base);
+}
+
+size_t Print::print(unsigned long n, int base) {
+	if (base == 0) {
+		return write((uint8_t) n);
+	}
+
+	return printNumber(n, base);
+}
+
+size_t Print::print(double n, int digits) {
+	return printFloat(n, digits);
+}
+
+size_t Print::print(const Printable& x) {
+	return x.printTo(*this);
+}
+
+size_t Print::println() {
+	return write("\r\n");
+}
+
+size_t Print::println(const __FlashStringHelper* str) {
+	const size_t n = print(str);
+	return n + println();
+}
+
+size_t Print::println(const String& str) {
+	const size_t n = print(str);
+	return n + println();
+}
+
+size_t Print::println(const char str[]) {
+	const size_t n = print(str);
+	return n + println();
+}
+
+size_t Print::println(char c) {
+	const size_t n = print(c);
+	return n + println();
+}
+
+size_t Print::println(unsigned char n, int base) {
+	const size_t r = print(n, base);
+	return r + println();
+}
+
+size_t Print::println(int n, int base) {
+	const size_t r = print(n, base);
+	return r + println();
+}
+
+size_t Print::println(unsigned int n, int base) {
+	const size_t r = print(n, base);
+	return r + println();
+}
+
+size_t Print::println(long n, int base) {
+	const size_t r = print(n, base);
+	return r + println();
+}
+
+size_t Print::println(unsigned long n, int base) {
+	const size_t r = print(n, base);
+	return r + println();
+}
+
+size_t Print::println(double n, int digits) {
+	const size_t r = print(n, digits);
+	return r + println();
+}
+
+size_t Print::println(const Printable& x) {
+	const size_t n = print(x);
+	return n + println();
+}
+
+//--------------------------------------------------------------------------------
+// Stream
+
+size_t Stream::readBytes(char* buffer, size_t length) {
+	size_t count = 0;
+	while (count < length) {
+		const int c = read();
+		if (c < 0) {
+			break;
+		}
+		*buffer++ = (char) c;
+		count++;
+	}
+	return count;
+}